@@ -27,6 +27,13 @@ template<typename T>
 struct target
 {
 	virtual void send(const T&) = 0;
+
+	// Targets that queue the value override this to take it over instead of
+	// copying it.
+	virtual void send(T&& value)
+	{
+		send(static_cast<const T&>(value));
+	}
 };
 
 }
\ No newline at end of file
@@ -55,35 +55,299 @@
 #include <boost/bind.hpp>
 #include <boost/lexical_cast.hpp>
 
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
 #include <tbb/atomic.h>
 
+#include <cstdint>
+#include <cwchar>
+#include <vector>
+
 namespace caspar { namespace log {
 
 using namespace boost;
 
-template<typename Stream>
-void append_timestamp(Stream& stream)
+tbb::atomic<int64_t>& dropped_records_counter()
+{
+	static tbb::atomic<int64_t> counter;
+	return counter;
+}
+
+std::wstring format_timestamp(const boost::posix_time::ptime& timestamp)
 {
-	auto timestamp = boost::posix_time::microsec_clock::local_time();
 	auto date = timestamp.date();
 	auto time = timestamp.time_of_day();
 	auto milliseconds = time.fractional_seconds() / 1000; // microseconds to milliseconds
 
-	std::wstringstream buffer;
+	wchar_t buffer[32];
+
+	swprintf_s(
+			buffer,
+			L"[%04d-%02d-%02d %02d:%02d:%02d.%03d] ",
+			static_cast<int>(date.year()),
+			static_cast<int>(date.month().as_number()),
+			static_cast<int>(date.day().as_number()),
+			static_cast<int>(time.hours()),
+			static_cast<int>(time.minutes()),
+			static_cast<int>(time.seconds()),
+			static_cast<int>(milliseconds));
 
-	buffer
-		<< std::setfill(L'0')
-		<< L"["
-		<< std::setw(4) << date.year() << L"-" << std::setw(2) << date.month().as_number() << "-" << std::setw(2) << date.day().as_number()
-		<< L" "
-		<< std::setw(2) << time.hours() << L":" << std::setw(2) << time.minutes() << L":" << std::setw(2) << time.seconds()
-		<< L"."
-		<< std::setw(3) << milliseconds
-		<< L"] ";
+	return buffer;
+}
+
+template<typename Stream>
+void append_timestamp(Stream& stream, const boost::log::record_view& rec)
+{
+	// Records are formatted on the sink thread, possibly long after they were
+	// logged, so use the time stamp captured by the logging thread.
+	auto timestamp = boost::log::extract<boost::posix_time::ptime>("TimeStamp", rec);
 
-	stream << buffer.str();
+	stream << format_timestamp(timestamp ? timestamp.get() : boost::posix_time::microsec_clock::local_time());
 }
 
+// Log record queueing strategy for boost::log::sinks::asynchronous_sink.
+// Records are kept in a fixed size lock-free ring buffer (Dmitry Vyukov's
+// bounded MPMC queue) so that the logging thread never waits for the sink
+// thread nor for disk I/O. Records that do not fit are dropped and counted.
+template<std::size_t CapacityV>
+class ring_buffer_queue
+{
+	static_assert((CapacityV & (CapacityV - 1)) == 0, "capacity must be a power of two");
+
+	struct cell
+	{
+		tbb::atomic<std::size_t>	sequence;
+		boost::log::record_view		rec;
+	};
+
+	std::vector<cell>			buffer_;
+	tbb::atomic<std::size_t>	enqueue_pos_;
+	tbb::atomic<std::size_t>	dequeue_pos_;
+	tbb::atomic<bool>			consumer_waiting_;
+	tbb::atomic<bool>			interruption_requested_;
+	boost::mutex				mutex_;
+	boost::condition_variable	cond_;
+protected:
+	ring_buffer_queue()
+		: buffer_(CapacityV)
+	{
+		init();
+	}
+
+	template<typename ArgsT>
+	explicit ring_buffer_queue(const ArgsT&)
+		: buffer_(CapacityV)
+	{
+		init();
+	}
+
+	void enqueue(const boost::log::record_view& rec)
+	{
+		if (try_enqueue(rec))
+			return;
+
+		++dropped_records_counter();
+	}
+
+	bool try_enqueue(const boost::log::record_view& rec)
+	{
+		std::size_t pos = enqueue_pos_;
+		cell* target;
+
+		for (;;)
+		{
+			target = &buffer_[pos & (CapacityV - 1)];
+			auto diff = static_cast<std::ptrdiff_t>(target->sequence) - static_cast<std::ptrdiff_t>(pos);
+
+			if (diff == 0)
+			{
+				if (enqueue_pos_.compare_and_swap(pos + 1, pos) == pos)
+					break;
+			}
+			else if (diff < 0)
+				return false; // Full.
+			else
+				pos = enqueue_pos_;
+		}
+
+		target->rec = rec;
+		target->sequence = pos + 1;
+
+		if (consumer_waiting_)
+		{
+			boost::lock_guard<boost::mutex> lock(mutex_);
+			cond_.notify_one();
+		}
+
+		return true;
+	}
+
+	bool try_dequeue_ready(boost::log::record_view& rec)
+	{
+		return try_dequeue(rec);
+	}
+
+	bool try_dequeue(boost::log::record_view& rec)
+	{
+		std::size_t pos = dequeue_pos_;
+		cell* source;
+
+		for (;;)
+		{
+			source = &buffer_[pos & (CapacityV - 1)];
+			auto diff = static_cast<std::ptrdiff_t>(source->sequence) - static_cast<std::ptrdiff_t>(pos + 1);
+
+			if (diff == 0)
+			{
+				if (dequeue_pos_.compare_and_swap(pos + 1, pos) == pos)
+					break;
+			}
+			else if (diff < 0)
+				return false; // Empty.
+			else
+				pos = dequeue_pos_;
+		}
+
+		rec = boost::log::record_view();
+		rec.swap(source->rec);
+		source->sequence = pos + CapacityV;
+
+		return true;
+	}
+
+	bool dequeue_ready(boost::log::record_view& rec)
+	{
+		while (!interruption_requested_)
+		{
+			if (try_dequeue(rec))
+				return true;
+
+			boost::unique_lock<boost::mutex> lock(mutex_);
+			consumer_waiting_ = true;
+
+			// The timeout covers a producer that checked the flag just before
+			// it was set.
+			if (!try_dequeue(rec))
+				cond_.timed_wait(lock, boost::posix_time::milliseconds(100));
+			else
+			{
+				consumer_waiting_ = false;
+				return true;
+			}
+
+			consumer_waiting_ = false;
+		}
+
+		interruption_requested_ = false;
+
+		return false;
+	}
+
+	void interrupt_dequeue()
+	{
+		boost::lock_guard<boost::mutex> lock(mutex_);
+		interruption_requested_ = true;
+		cond_.notify_one();
+	}
+private:
+	void init()
+	{
+		for (std::size_t n = 0; n < CapacityV; ++n)
+			buffer_[n].sequence = n;
+
+		enqueue_pos_ = 0;
+		dequeue_pos_ = 0;
+		consumer_waiting_ = false;
+		interruption_requested_ = false;
+	}
+};
+
+// Sink backend that collapses repetitions of the same message, which are
+// common during warning storms, into a single "repeated" line, and reports
+// records dropped by the ring buffer queue.
+template<typename BackendT>
+class rate_limiting_backend
+	: public boost::log::sinks::basic_formatted_sink_backend<
+			typename BackendT::char_type,
+			boost::log::sinks::combine_requirements<
+					boost::log::sinks::synchronized_feeding,
+					boost::log::sinks::flushing>::type>
+{
+	typedef typename BackendT::char_type	char_type;
+	typedef std::basic_string<char_type>	string_type;
+
+	boost::shared_ptr<BackendT>			backend_;
+	std::wstring						last_message_;
+	boost::log::trivial::severity_level	last_severity_;
+	boost::posix_time::ptime			last_time_;
+	int									repetitions_;
+	int64_t								reported_drops_;
+public:
+	rate_limiting_backend(const boost::shared_ptr<BackendT>& backend)
+		: backend_(backend)
+		, last_severity_(boost::log::trivial::trace)
+		, repetitions_(0)
+		, reported_drops_(0)
+	{
+	}
+
+	void consume(const boost::log::record_view& rec, const string_type& formatted)
+	{
+		auto message = rec[boost::log::expressions::message].get<std::wstring>();
+		auto severity = boost::log::extract<boost::log::trivial::severity_level>("Severity", rec);
+		auto timestamp = boost::log::extract<boost::posix_time::ptime>("TimeStamp", rec);
+		auto now = timestamp ? timestamp.get() : boost::posix_time::microsec_clock::local_time();
+
+		if (severity && severity.get() == last_severity_ && message == last_message_ && now - last_time_ < boost::posix_time::seconds(1))
+		{
+			++repetitions_;
+			return;
+		}
+
+		report_repetitions(rec);
+		report_drops(rec);
+
+		last_message_	= std::move(message);
+		last_severity_	= severity ? severity.get() : boost::log::trivial::trace;
+		last_time_		= now;
+
+		backend_->consume(rec, formatted);
+	}
+
+	void flush()
+	{
+		backend_->flush();
+	}
+private:
+	void report_repetitions(const boost::log::record_view& rec)
+	{
+		if (repetitions_ == 0)
+			return;
+
+		write(rec, L"Previous message repeated " + boost::lexical_cast<std::wstring>(repetitions_) + L" times.");
+		repetitions_ = 0;
+	}
+
+	void report_drops(const boost::log::record_view& rec)
+	{
+		int64_t dropped = dropped_records_counter();
+
+		if (dropped == reported_drops_)
+			return;
+
+		write(rec, L"Log queue overflow, " + boost::lexical_cast<std::wstring>(dropped - reported_drops_) + L" records dropped.");
+		reported_drops_ = dropped;
+	}
+
+	void write(const boost::log::record_view& rec, const std::wstring& text)
+	{
+		std::wstring line = format_timestamp(boost::posix_time::microsec_clock::local_time()) + text;
+
+		backend_->consume(rec, string_type(line.begin(), line.end()));
+	}
+};
+
 class column_writer
 {
 	tbb::atomic<int> column_width_;
@@ -117,7 +381,7 @@ void my_formatter(bool print_all_characters, const boost::log::record_view& rec,
 	static column_writer severity_column(7);
 	namespace expr = boost::log::expressions;
 	
-	append_timestamp(strm);
+	append_timestamp(strm, rec);
 
 	thread_id_column.write(strm, boost::log::extract<boost::log::attributes::current_thread_id::value_type>("ThreadID", rec).get().native_id());
 	severity_column.write(strm, boost::log::extract<boost::log::trivial::severity_level>("Severity", rec));
@@ -133,17 +397,20 @@ void my_formatter(bool print_all_characters, const boost::log::record_view& rec,
 }
 
 namespace internal{
+
+const std::size_t RING_BUFFER_CAPACITY = 8192;
 	
 void init()
 {	
 	boost::log::add_common_attributes();
-	typedef boost::log::sinks::asynchronous_sink<boost::log::sinks::wtext_ostream_backend> stream_sink_type;
+	typedef rate_limiting_backend<boost::log::sinks::wtext_ostream_backend> stream_backend_type;
+	typedef boost::log::sinks::asynchronous_sink<stream_backend_type, ring_buffer_queue<RING_BUFFER_CAPACITY>> stream_sink_type;
 
 	auto stream_backend = boost::make_shared<boost::log::sinks::wtext_ostream_backend>();
 	stream_backend->add_stream(boost::shared_ptr<std::wostream>(&std::wcout, boost::null_deleter()));
 	stream_backend->auto_flush(true);
 
-	auto stream_sink = boost::make_shared<stream_sink_type>(stream_backend);
+	auto stream_sink = boost::make_shared<stream_sink_type>(boost::make_shared<stream_backend_type>(stream_backend));
 
 	bool print_all_characters = false;
 	stream_sink->set_formatter(boost::bind(&my_formatter<boost::log::wformatting_ostream>, print_all_characters, _1, _2));
@@ -155,20 +422,23 @@ void init()
 
 void add_file_sink(const std::wstring& folder)
 {	
-	typedef boost::log::sinks::synchronous_sink<boost::log::sinks::text_file_backend> file_sink_type;
+	typedef rate_limiting_backend<boost::log::sinks::text_file_backend> file_backend_type;
+	typedef boost::log::sinks::asynchronous_sink<file_backend_type, ring_buffer_queue<internal::RING_BUFFER_CAPACITY>> file_sink_type;
 
 	try
 	{
 		if(!boost::filesystem::is_directory(folder))
 			BOOST_THROW_EXCEPTION(directory_not_found());
 
-		auto file_sink = boost::make_shared<file_sink_type>(
+		auto file_backend = boost::make_shared<boost::log::sinks::text_file_backend>(
 			boost::log::keywords::file_name = (folder + L"caspar_%Y-%m-%d.log"),
 			boost::log::keywords::time_based_rotation = boost::log::sinks::file::rotation_at_time_point(0, 0, 0),
 			boost::log::keywords::auto_flush = true,
 			boost::log::keywords::open_mode = std::ios::app
 		);
 
+		auto file_sink = boost::make_shared<file_sink_type>(boost::make_shared<file_backend_type>(file_backend));
+
 		bool print_all_characters = true;
 
 		file_sink->set_formatter(boost::bind(&my_formatter<boost::log::formatting_ostream>, print_all_characters, _1, _2));
@@ -180,6 +450,16 @@ void add_file_sink(const std::wstring& folder)
 	}
 }
 
+void flush()
+{
+	boost::log::core::get()->flush();
+}
+
+int64_t dropped_records()
+{
+	return dropped_records_counter();
+}
+
 void set_log_level(const std::wstring& lvl)
 {	
 	if(boost::iequals(lvl, L"trace"))
@@ -24,6 +24,7 @@
 #include <boost/log/trivial.hpp>
 #include <boost/log/sources/global_logger_storage.hpp>
 
+#include <cstdint>
 #include <string>
 #include <locale>
 
@@ -35,6 +36,12 @@ void init();
 
 void add_file_sink(const std::wstring& folder);
 
+// Blocks until every queued record has been written by the sinks.
+void flush();
+
+// Number of records dropped because a sink could not keep up.
+int64_t dropped_records();
+
 typedef boost::log::sources::wseverity_logger_mt<boost::log::trivial::severity_level> caspar_logger;
 
 BOOST_LOG_INLINE_GLOBAL_LOGGER_INIT(logger, caspar_logger)
@@ -0,0 +1,357 @@
+/*
+* Copyright 2026 Sveriges Television AB http://casparcg.com/
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../stdafx.h"
+
+#include "bgra_to_yuv.h"
+
+#include "../exception/exceptions.h"
+
+#include <intrin.h>
+
+#include <tbb/parallel_for.h>
+#include <tbb/cache_aligned_allocator.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace caspar {
+
+namespace {
+
+// Limited range coefficients in 2.14 fixed point, in BGRA order. The 219/255
+// and 224/255 range scaling is folded in, so the chroma rows sum to zero.
+struct coefficients
+{
+	std::int16_t y[3];
+	std::int16_t u[3];
+	std::int16_t v[3];
+};
+
+const coefficients& get_coefficients(yuv_matrix::type matrix)
+{
+	static const coefficients bt601 = {{1604, 8260, 4207}, {7196, -4768, -2428}, {-1170, -6026, 7196}};
+	static const coefficients bt709 = {{1016, 10064, 2991}, {7196, -5547, -1649}, {-660, -6536, 7196}};
+
+	return matrix == yuv_matrix::bt709 ? bt709 : bt601;
+}
+
+// Alpha 0-255 to key luma 64-940, in 22.10 fixed point.
+const int KEY_SCALE = 3518;
+
+typedef std::vector<std::uint16_t, tbb::cache_aligned_allocator<std::uint16_t>> sample_row;
+
+// Converts one pair of pixels to 10 bit U Y V Y. Used for the pixels that do
+// not fill a whole SIMD block.
+void convert_pair(
+		const std::uint8_t* source, 
+		const coefficients& c, 
+		std::uint16_t* fill, 
+		std::uint16_t* key)
+{
+	const std::uint8_t* p0 = source;
+	const std::uint8_t* p1 = source + 4;
+
+	if(fill)
+	{
+		const int y0 = c.y[0]*p0[0] + c.y[1]*p0[1] + c.y[2]*p0[2];
+		const int y1 = c.y[0]*p1[0] + c.y[1]*p1[1] + c.y[2]*p1[2];
+		const int u  = c.u[0]*(p0[0] + p1[0]) + c.u[1]*(p0[1] + p1[1]) + c.u[2]*(p0[2] + p1[2]);
+		const int v  = c.v[0]*(p0[0] + p1[0]) + c.v[1]*(p0[1] + p1[1]) + c.v[2]*(p0[2] + p1[2]);
+
+		fill[0] = static_cast<std::uint16_t>(((u  + (1 << 12)) >> 13) + 512);
+		fill[1] = static_cast<std::uint16_t>(((y0 + (1 << 11)) >> 12) + 64);
+		fill[2] = static_cast<std::uint16_t>(((v  + (1 << 12)) >> 13) + 512);
+		fill[3] = static_cast<std::uint16_t>(((y1 + (1 << 11)) >> 12) + 64);
+	}
+
+	if(key)
+	{
+		key[0] = 512;
+		key[1] = static_cast<std::uint16_t>(((p0[3]*KEY_SCALE + (1 << 9)) >> 10) + 64);
+		key[2] = 512;
+		key[3] = static_cast<std::uint16_t>(((p1[3]*KEY_SCALE + (1 << 9)) >> 10) + 64);
+	}
+}
+
+// Interleaves four chroma pairs [u0..u3 v0..v3] with eight luma samples into
+// U Y V Y order and stores 16 samples.
+void store_uyvy(std::uint16_t* dest, __m128i uv, __m128i y)
+{
+	const __m128i uvi = _mm_unpacklo_epi16(uv, _mm_srli_si128(uv, 8));
+
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(dest),		_mm_unpacklo_epi16(uvi, y));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(dest + 8),	_mm_unpackhi_epi16(uvi, y));
+}
+
+// Converts one row of BGRA to 10 bit U Y V Y samples, eight pixels at a time.
+// Fill and key are computed from the same loads.
+void convert_row(
+		const std::uint8_t* source, 
+		int width, 
+		const coefficients& c, 
+		std::uint16_t* fill, 
+		std::uint16_t* key)
+{
+	const __m128i zero	= _mm_setzero_si128();
+	const __m128i cy	= _mm_setr_epi16(c.y[0], c.y[1], c.y[2], 0, c.y[0], c.y[1], c.y[2], 0);
+	const __m128i cu	= _mm_setr_epi16(c.u[0], c.u[1], c.u[2], 0, c.u[0], c.u[1], c.u[2], 0);
+	const __m128i cv	= _mm_setr_epi16(c.v[0], c.v[1], c.v[2], 0, c.v[0], c.v[1], c.v[2], 0);
+	const __m128i ck	= _mm_setr_epi16(0, 0, 0, KEY_SCALE, 0, 0, 0, KEY_SCALE);
+
+	const __m128i y_round	= _mm_set1_epi32(1 << 11);
+	const __m128i c_round	= _mm_set1_epi32(1 << 12);
+	const __m128i k_round	= _mm_set1_epi32(1 << 9);
+	const __m128i y_offset	= _mm_set1_epi16(64);
+	const __m128i c_offset	= _mm_set1_epi16(512);
+
+	int x = 0;
+
+	for(; x + 8 <= width; x += 8, source += 32)
+	{
+		const __m128i p0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source));
+		const __m128i p1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 16));
+
+		// Two pixels per register as 16 bit B G R A B G R A.
+		const __m128i a = _mm_unpacklo_epi8(p0, zero);
+		const __m128i b = _mm_unpackhi_epi8(p0, zero);
+		const __m128i d = _mm_unpacklo_epi8(p1, zero);
+		const __m128i e = _mm_unpackhi_epi8(p1, zero);
+
+		if(fill)
+		{
+			auto y03 = _mm_hadd_epi32(_mm_madd_epi16(a, cy), _mm_madd_epi16(b, cy));
+			auto y47 = _mm_hadd_epi32(_mm_madd_epi16(d, cy), _mm_madd_epi16(e, cy));
+
+			// The second horizontal add sums neighbouring pixels for 4:2:2 chroma.
+			auto u = _mm_hadd_epi32(
+					_mm_hadd_epi32(_mm_madd_epi16(a, cu), _mm_madd_epi16(b, cu)), 
+					_mm_hadd_epi32(_mm_madd_epi16(d, cu), _mm_madd_epi16(e, cu)));
+			auto v = _mm_hadd_epi32(
+					_mm_hadd_epi32(_mm_madd_epi16(a, cv), _mm_madd_epi16(b, cv)), 
+					_mm_hadd_epi32(_mm_madd_epi16(d, cv), _mm_madd_epi16(e, cv)));
+
+			y03 = _mm_srai_epi32(_mm_add_epi32(y03, y_round), 12);
+			y47 = _mm_srai_epi32(_mm_add_epi32(y47, y_round), 12);
+			u	= _mm_srai_epi32(_mm_add_epi32(u, c_round), 13);
+			v	= _mm_srai_epi32(_mm_add_epi32(v, c_round), 13);
+
+			store_uyvy(
+					fill + x*2, 
+					_mm_add_epi16(_mm_packs_epi32(u, v), c_offset), 
+					_mm_add_epi16(_mm_packs_epi32(y03, y47), y_offset));
+		}
+
+		if(key)
+		{
+			auto k03 = _mm_hadd_epi32(_mm_madd_epi16(a, ck), _mm_madd_epi16(b, ck));
+			auto k47 = _mm_hadd_epi32(_mm_madd_epi16(d, ck), _mm_madd_epi16(e, ck));
+
+			k03 = _mm_srai_epi32(_mm_add_epi32(k03, k_round), 10);
+			k47 = _mm_srai_epi32(_mm_add_epi32(k47, k_round), 10);
+
+			store_uyvy(
+					key + x*2, 
+					c_offset, 
+					_mm_add_epi16(_mm_packs_epi32(k03, k47), y_offset));
+		}
+	}
+
+	for(; x < width; x += 2, source += 8)
+		convert_pair(source, c, fill ? fill + x*2 : nullptr, key ? key + x*2 : nullptr);
+}
+
+void pack_uyvy(const std::uint16_t* row, int width, std::uint8_t* dest)
+{
+	const __m128i round = _mm_set1_epi16(2);
+
+	int n = 0;
+	const int count = width*2;
+
+	for(; n + 16 <= count; n += 16)
+	{
+		const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + n));
+		const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + n + 8));
+
+		_mm_storeu_si128(
+				reinterpret_cast<__m128i*>(dest + n), 
+				_mm_packus_epi16(
+						_mm_srli_epi16(_mm_add_epi16(lo, round), 2), 
+						_mm_srli_epi16(_mm_add_epi16(hi, round), 2)));
+	}
+
+	for(; n < count; ++n)
+		dest[n] = static_cast<std::uint8_t>(std::min(255, (row[n] + 2) >> 2));
+}
+
+// v210 stores the U Y V Y sequence three samples per 32 bit word, padded to
+// whole groups of six pixels.
+void pack_v210(const std::uint16_t* row, int width, std::uint8_t* dest)
+{
+	auto words = reinterpret_cast<std::uint32_t*>(dest);
+
+	const int count = width*2;
+	const int padded = (width + 5) / 6 * 12;
+
+	for(int n = 0; n < padded; n += 3)
+	{
+		const std::uint32_t s0 = n		< count ? row[n]	 : 0;
+		const std::uint32_t s1 = n + 1	< count ? row[n + 1] : 0;
+		const std::uint32_t s2 = n + 2	< count ? row[n + 2] : 0;
+
+		*words++ = s0 | (s1 << 10) | (s2 << 20);
+	}
+}
+
+void pack_luma8(const std::uint16_t* row, int width, std::uint8_t* dest)
+{
+	for(int x = 0; x < width; ++x)
+		dest[x] = static_cast<std::uint8_t>(std::min(255, (row[x*2 + 1] + 2) >> 2));
+}
+
+void pack_yuv422p10(const std::uint16_t* row, int width, const yuv_image& image, int y)
+{
+	auto dest_y = reinterpret_cast<std::uint16_t*>(image.data[0] + y*image.linesize[0]);
+	auto dest_u = reinterpret_cast<std::uint16_t*>(image.data[1] + y*image.linesize[1]);
+	auto dest_v = reinterpret_cast<std::uint16_t*>(image.data[2] + y*image.linesize[2]);
+
+	for(int x = 0; x < width; x += 2, row += 4)
+	{
+		*dest_u++ = row[0];
+		*dest_y++ = row[1];
+		*dest_v++ = row[2];
+		*dest_y++ = row[3];
+	}
+}
+
+// Averages the chroma of rows y0 and y1 into one 4:2:0 chroma row.
+void pack_yuv420p(const std::uint16_t* row0, const std::uint16_t* row1, int width, const yuv_image& image, int y0, int y1)
+{
+	auto dest_u	= image.data[1] + (y0/2)*image.linesize[1];
+	auto dest_v	= image.data[2] + (y0/2)*image.linesize[2];
+
+	for(int x = 0; x < width; x += 2)
+	{
+		*dest_u++ = static_cast<std::uint8_t>(std::min(255, (row0[x*2] + row1[x*2] + 4) >> 3));
+		*dest_v++ = static_cast<std::uint8_t>(std::min(255, (row0[x*2 + 2] + row1[x*2 + 2] + 4) >> 3));
+	}
+
+	pack_luma8(row0, width, image.data[0] + y0*image.linesize[0]);
+
+	if(y1 != y0)
+		pack_luma8(row1, width, image.data[0] + y1*image.linesize[0]);
+}
+
+void pack_row(yuv_format::type format, const std::uint16_t* row, int width, const yuv_image& image, int y)
+{
+	switch(format)
+	{
+	case yuv_format::uyvy:
+		pack_uyvy(row, width, image.data[0] + y*image.linesize[0]);
+		break;
+	case yuv_format::v210:
+		pack_v210(row, width, image.data[0] + y*image.linesize[0]);
+		break;
+	case yuv_format::yuv422p10:
+		pack_yuv422p10(row, width, image, y);
+		break;
+	default:
+		break;
+	}
+}
+
+}
+
+int v210_linesize(int width)
+{
+	return (width + 47) / 48 * 128;
+}
+
+void bgra_to_yuv(
+		const std::uint8_t* source, 
+		int width, 
+		int height, 
+		yuv_format::type format, 
+		yuv_matrix::type matrix,
+		const yuv_image* fill,
+		const yuv_image* key)
+{
+	if(width % 2 != 0)
+		BOOST_THROW_EXCEPTION(invalid_argument() << arg_name_info("width") << msg_info("Width must be even."));
+
+	if(!fill && !key)
+		return;
+
+	const auto& c			= get_coefficients(matrix);
+	const int	linesize	= width*4;
+
+	if(format == yuv_format::yuv420p)
+	{
+		// 4:2:0 needs two source rows per chroma row, so the work is split on
+		// row pairs. An odd last row is paired with itself.
+		tbb::parallel_for(tbb::blocked_range<int>(0, (height + 1) / 2), [&](const tbb::blocked_range<int>& r)
+		{
+			sample_row fill0(fill ? width*2 : 0), fill1(fill ? width*2 : 0);
+			sample_row key0(key ? width*2 : 0), key1(key ? width*2 : 0);
+
+			for(int n = r.begin(); n < r.end(); ++n)
+			{
+				const int y0 = n*2;
+				const int y1 = std::min(y0 + 1, height - 1);
+
+				convert_row(source + y0*linesize, width, c, fill ? fill0.data() : nullptr, key ? key0.data() : nullptr);
+
+				if(y1 != y0)
+					convert_row(source + y1*linesize, width, c, fill ? fill1.data() : nullptr, key ? key1.data() : nullptr);
+				else
+				{
+					fill1 = fill0;
+					key1  = key0;
+				}
+
+				if(fill)
+					pack_yuv420p(fill0.data(), fill1.data(), width, *fill, y0, y1);
+
+				if(key)
+					pack_yuv420p(key0.data(), key1.data(), width, *key, y0, y1);
+			}
+		});
+	}
+	else
+	{
+		tbb::parallel_for(tbb::blocked_range<int>(0, height), [&](const tbb::blocked_range<int>& r)
+		{
+			sample_row fill_row(fill ? width*2 : 0);
+			sample_row key_row(key ? width*2 : 0);
+
+			for(int y = r.begin(); y < r.end(); ++y)
+			{
+				convert_row(source + y*linesize, width, c, fill ? fill_row.data() : nullptr, key ? key_row.data() : nullptr);
+
+				if(fill)
+					pack_row(format, fill_row.data(), width, *fill, y);
+
+				if(key)
+					pack_row(format, key_row.data(), width, *key, y);
+			}
+		});
+	}
+}
+
+}
@@ -0,0 +1,93 @@
+/*
+* Copyright 2026 Sveriges Television AB http://casparcg.com/
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+namespace caspar {
+
+struct yuv_format
+{
+	enum type
+	{
+		uyvy,		// 8 bit 4:2:2, packed.
+		v210,		// 10 bit 4:2:2, packed, six pixels in 16 bytes.
+		yuv420p,	// 8 bit 4:2:0, planar.
+		yuv422p10	// 10 bit 4:2:2, planar, little endian 16 bit samples.
+	};
+};
+
+struct yuv_matrix
+{
+	enum type
+	{
+		bt601,
+		bt709
+	};
+};
+
+// Destination planes of a converted image. Packed formats only use the first
+// plane.
+struct yuv_image
+{
+	std::uint8_t*	data[3];
+	int				linesize[3];
+
+	yuv_image()
+	{
+		for(int n = 0; n < 3; ++n)
+		{
+			data[n]		= nullptr;
+			linesize[n] = 0;
+		}
+	}
+
+	yuv_image(std::uint8_t* const data[], const int linesize[], int planes = 3)
+	{
+		for(int n = 0; n < 3; ++n)
+		{
+			this->data[n]		= n < planes ? data[n] : nullptr;
+			this->linesize[n]	= n < planes ? linesize[n] : 0;
+		}
+	}
+};
+
+// Smallest line size of a v210 image, which is padded to groups of 48 pixels.
+int v210_linesize(int width);
+
+// Converts a tightly packed BGRA image to limited range YUV in a single pass
+// over the source. The rows are split over the available cores.
+//
+// The key is the alpha channel as luma with neutral chroma, in the same format
+// as the fill. Either fill or key may be null, so key only outputs do not have
+// to shuffle the alpha channel into a temporary BGRA image first.
+//
+// Chroma is taken from the average of each horizontal pixel pair. Every
+// sample is within one code value of the floating point formulas.
+void bgra_to_yuv(
+		const std::uint8_t* source, 
+		int width, 
+		int height, 
+		yuv_format::type format, 
+		yuv_matrix::type matrix,
+		const yuv_image* fill,
+		const yuv_image* key);
+
+}
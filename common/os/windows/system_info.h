@@ -25,10 +25,15 @@
 #define WIN32_LEAN_AND_MEAN
 
 #include <windows.h>
+#include <psapi.h>
 
 #include <string>
 #include <sstream>
 
+#include <stdint.h>
+
+#pragma comment(lib, "psapi.lib")
+
 namespace caspar {
 	
 static std::wstring get_cpu_info()
@@ -81,5 +86,32 @@ static std::wstring get_system_product_name()
 	return system_product_name;
 }
 
+static int64_t get_process_cpu_time_millis()
+{
+	FILETIME creation_time, exit_time, kernel_time, user_time;
+
+	if(!GetProcessTimes(GetCurrentProcess(), &creation_time, &exit_time, &kernel_time, &user_time))
+		return 0;
+
+	ULARGE_INTEGER kernel, user;
+	kernel.LowPart	= kernel_time.dwLowDateTime;
+	kernel.HighPart	= kernel_time.dwHighDateTime;
+	user.LowPart	= user_time.dwLowDateTime;
+	user.HighPart	= user_time.dwHighDateTime;
+
+	// 100 nanosecond intervals.
+	return static_cast<int64_t>((kernel.QuadPart + user.QuadPart) / 10000);
+}
+
+static int64_t get_process_memory_bytes()
+{
+	PROCESS_MEMORY_COUNTERS counters;
+
+	if(!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return 0;
+
+	return static_cast<int64_t>(counters.WorkingSetSize);
+}
+
 
 }
\ No newline at end of file
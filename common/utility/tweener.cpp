@@ -42,6 +42,8 @@
 
 #include "tweener.h"
 
+#include <emmintrin.h>
+
 #include <boost/assign/list_of.hpp>
 #include <boost/regex.hpp>
 #include <boost/lexical_cast.hpp>
@@ -49,12 +51,9 @@
 #include <unordered_map>
 #include <string>
 #include <locale>
-#include <functional>
 #include <vector>
 
 namespace caspar {
-
-typedef std::function<double(double, double, double, double)> tweener_t;
 			
 static const double PI = std::atan(1.0)*4.0;
 static const double H_PI = std::atan(1.0)*2.0;
@@ -377,14 +376,18 @@ double ease_out_in_bounce (double t, double b, double c, double d, const std::ve
 	return ease_in_bounce((t*2)-d, b+c/2, c/2, d, params);
 }
 
-tweener_t get_tweener(std::wstring name)
+compiled_tweener::compiled_tweener()
+	: function_(ease_none)
+{
+}
+
+compiled_tweener::compiled_tweener(std::wstring name)
+	: function_(ease_none)
 {
 	std::transform(name.begin(), name.end(), name.begin(), std::tolower);
 
 	if(name == L"linear")
-		return [](double t, double b, double c, double d){return ease_none(t, b, c, d, std::vector<double>());};
-	
-	std::vector<double> params;
+		return;
 	
 	static const boost::wregex expr(L"(?<NAME>\\w*)(:(?<V0>\\d+\\.?\\d?))?(:(?<V1>\\d+\\.?\\d?))?"); // boost::regex has no repeated captures?
 	boost::wsmatch what;
@@ -392,13 +395,12 @@ tweener_t get_tweener(std::wstring name)
 	{
 		name = what["NAME"].str();
 		if(what["V0"].matched)
-			params.push_back(boost::lexical_cast<double>(what["V0"].str()));
+			params_.push_back(boost::lexical_cast<double>(what["V0"].str()));
 		if(what["V1"].matched)
-			params.push_back(boost::lexical_cast<double>(what["V1"].str()));
+			params_.push_back(boost::lexical_cast<double>(what["V1"].str()));
 	}
 		
-	typedef std::function<double(double, double, double, double, const std::vector<double>&)> tween_t;	
-	static const std::unordered_map<std::wstring, tween_t> tweens = boost::assign::map_list_of	
+	static const std::unordered_map<std::wstring, function_t> tweens = boost::assign::map_list_of	
 		(L"",					ease_none		   )	
 		(L"linear",				ease_none		   )	
 		(L"easenone",			ease_none		   )
@@ -444,13 +446,37 @@ tweener_t get_tweener(std::wstring name)
 		(L"easeoutinbounce",	ease_out_in_bounce );
 
 	auto it = tweens.find(name);
-	if(it == tweens.end())
-		it = tweens.find(L"linear");
-	
-	return [=](double t, double b, double c, double d)
+	if(it != tweens.end())
+		function_ = it->second;
+}
+
+void compiled_tweener::operator()(double t, const double* source, const double* dest, double* result, size_t count, double d) const
+{
+	size_t n = 0;
+
+	// Linear is by far the most common tween, two values at a time with the
+	// same operations as ease_none.
+	if(function_ == ease_none)
 	{
-		return it->second(t, b, c, d, params);
-	};
-};
+		const __m128d time		= _mm_set1_pd(t);
+		const __m128d duration	= _mm_set1_pd(d);
+
+		for(; n + 2 <= count; n += 2)
+		{
+			__m128d b = _mm_loadu_pd(source + n);
+			__m128d c = _mm_sub_pd(_mm_loadu_pd(dest + n), b);
+
+			_mm_storeu_pd(result + n, _mm_add_pd(_mm_div_pd(_mm_mul_pd(c, time), duration), b));
+		}
+	}
+
+	for(; n < count; ++n)
+		result[n] = function_(t, source[n], dest[n] - source[n], d, params_);
+}
+
+tweener_t get_tweener(std::wstring name)
+{
+	return compiled_tweener(std::move(name));
+}
 
 }
\ No newline at end of file
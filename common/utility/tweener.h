@@ -21,11 +21,35 @@
 
 #pragma once
 
-#include <functional>
+#include <string>
+#include <vector>
 
 namespace caspar {
 
-typedef std::function<double(double, double, double, double)> tweener_t;
+// An easing function resolved by name once, and then called directly through
+// a function pointer.
+class compiled_tweener
+{
+public:
+	typedef double (*function_t)(double t, double b, double c, double d, const std::vector<double>& params);
+
+	compiled_tweener();
+	explicit compiled_tweener(std::wstring name);
+
+	double operator()(double t, double b, double c, double d) const
+	{
+		return function_(t, b, c, d, params_);
+	}
+
+	// Tweens count values at once, result[n] is the same as
+	// (*this)(t, source[n], dest[n] - source[n], d).
+	void operator()(double t, const double* source, const double* dest, double* result, size_t count, double d) const;
+private:
+	function_t			function_;
+	std::vector<double>	params_;
+};
+
+typedef compiled_tweener tweener_t;
 tweener_t get_tweener(std::wstring name = L"linear");
 
 }
\ No newline at end of file
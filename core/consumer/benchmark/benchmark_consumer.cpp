@@ -0,0 +1,436 @@
+/*
+* Copyright 2026 Sveriges Television AB http://casparcg.com/
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "../../StdAfx.h"
+
+#include "benchmark_consumer.h"
+
+#include "../frame_consumer.h"
+
+#include "../../parameters/parameters.h"
+#include "../../video_format.h"
+#include "../../mixer/read_frame.h"
+
+#include <common/concurrency/executor.h>
+#include <common/env.h>
+#include <common/exception/exceptions.h>
+#include <common/log/log.h>
+
+#include <boost/lexical_cast.hpp>
+
+#include <boost/chrono.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <tbb/atomic.h>
+#include <tbb/spin_mutex.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+
+namespace caspar { namespace core {
+
+struct running_statistics
+{
+	int64_t	count;
+	double	sum;
+	double	sum_squares;
+	double	min;
+	double	max;
+
+	running_statistics()
+		: count(0)
+		, sum(0.0)
+		, sum_squares(0.0)
+		, min(std::numeric_limits<double>::max())
+		, max(-std::numeric_limits<double>::max())
+	{
+	}
+
+	void add(double value)
+	{
+		++count;
+		sum			+= value;
+		sum_squares	+= value * value;
+		min			= std::min(min, value);
+		max			= std::max(max, value);
+	}
+
+	double mean() const
+	{
+		return count > 0 ? sum / count : 0.0;
+	}
+
+	double stddev() const
+	{
+		if (count < 2)
+			return 0.0;
+
+		auto m = mean();
+
+		return std::sqrt(std::max(0.0, sum_squares / count - m * m));
+	}
+
+	void describe(boost::property_tree::wptree& info) const
+	{
+		info.add(L"mean", mean());
+		info.add(L"stddev", stddev());
+		info.add(L"min", count > 0 ? min : 0.0);
+		info.add(L"max", count > 0 ? max : 0.0);
+	}
+};
+
+uint64_t checksum(const boost::iterator_range<const uint8_t*>& data)
+{
+	// FNV-1a over 64 bit words, the tail is folded in byte by byte.
+	uint64_t hash = 14695981039346656037ULL;
+
+	auto words = reinterpret_cast<const uint64_t*>(data.begin());
+	auto num_words = data.size() / sizeof(uint64_t);
+
+	for (size_t n = 0; n < num_words; ++n)
+		hash = (hash ^ words[n]) * 1099511628211ULL;
+
+	for (auto it = data.begin() + num_words * sizeof(uint64_t); it != data.end(); ++it)
+		hash = (hash ^ *it) * 1099511628211ULL;
+
+	return hash;
+}
+
+// Statistics files are only written below the log folder, so a client can
+// not overwrite arbitrary files through the FILE parameter.
+boost::filesystem::path statistics_file_path(const std::wstring& filename)
+{
+	auto relative_path = boost::filesystem::path(filename);
+
+	if (relative_path.empty() || relative_path.has_root_path() || std::find(relative_path.begin(), relative_path.end(), boost::filesystem::path(L"..")) != relative_path.end())
+		BOOST_THROW_EXCEPTION(invalid_argument() << arg_name_info("FILE") << arg_value_info(narrow(filename)) << msg_info("Expected a path relative to the log folder."));
+
+	return boost::filesystem::path(env::log_folder()) / relative_path;
+}
+
+// Consumer without any hardware or display dependencies, used to measure a
+// channel's throughput. In clock mode it paces the channel at the exact
+// frame rate of the video format, otherwise the channel runs as fast as
+// stage, mixer and output allow.
+struct benchmark_consumer : public frame_consumer
+{
+	typedef boost::chrono::high_resolution_clock clock;
+
+	const bool						clock_;
+	const bool						checksums_;
+	const int64_t					max_frames_;
+	const boost::filesystem::path	path_;
+
+	video_format_desc				format_desc_;
+	int								channel_index_;
+
+	std::wofstream					file_;
+
+	// Guards the statistics against info(), which reads them on the calling
+	// thread. They are only written on the executor.
+	mutable tbb::spin_mutex			stats_mutex_;
+	int64_t							frames_;
+	clock::time_point				start_time_;
+	clock::time_point				last_arrival_;
+	clock::time_point				next_tick_;
+	int64_t							late_ticks_;
+	running_statistics				intervals_;
+	running_statistics				jitter_;
+	running_statistics				ages_;
+	uint64_t						combined_checksum_;
+	uint64_t						last_checksum_;
+	tbb::atomic<int64_t>			last_age_;
+
+	executor						executor_;
+public:
+
+	// frame_consumer
+
+	benchmark_consumer(bool paced, bool checksums, int64_t max_frames, const std::wstring& filename)
+		: clock_(paced)
+		, checksums_(checksums)
+		, max_frames_(max_frames)
+		, path_(filename.empty() ? boost::filesystem::path() : statistics_file_path(filename))
+		, channel_index_(-1)
+		, frames_(0)
+		, late_ticks_(0)
+		, combined_checksum_(0)
+		, last_checksum_(0)
+		, executor_(L"benchmark_consumer")
+	{
+		last_age_ = 0;
+	}
+
+	~benchmark_consumer()
+	{
+		executor_.invoke([this]
+		{
+			summarize();
+		});
+	}
+
+	virtual void initialize(const video_format_desc& format_desc, const channel_layout&, int channel_index) override
+	{
+		executor_.invoke([=]
+		{
+			if (frames_ > 0)
+				summarize();
+
+			format_desc_	= format_desc;
+			channel_index_	= channel_index;
+
+			tbb::spin_mutex::scoped_lock lock(stats_mutex_);
+			frames_			= 0;
+			late_ticks_		= 0;
+			intervals_		= running_statistics();
+			jitter_			= running_statistics();
+			ages_			= running_statistics();
+			combined_checksum_ = 0;
+			last_checksum_	= 0;
+			lock.release();
+
+			if (!path_.empty() && !file_.is_open())
+			{
+				boost::system::error_code ec;
+				boost::filesystem::create_directories(path_.parent_path(), ec);
+
+				file_.open(path_.wstring().c_str());
+
+				if (!file_.is_open())
+					CASPAR_LOG(warning) << print() << L" Failed to open " << path_.wstring();
+			}
+
+			if (file_.is_open())
+			{
+				file_ << L"# " << print() << L"\n";
+				file_ << L"frame,arrival_ms,interval_ms,jitter_ms,age_ms,checksum\n";
+			}
+		});
+	}
+
+	virtual int64_t presentation_frame_age_millis() const override
+	{
+		return last_age_;
+	}
+	
+	virtual boost::unique_future<bool> send(const safe_ptr<read_frame>& frame) override
+	{
+		auto arrival = clock::now();
+
+		return executor_.begin_invoke([=]() -> bool
+		{
+			auto frames = record(frame, arrival);
+
+			if (clock_)
+				wait_for_next_tick(frames);
+
+			return max_frames_ <= 0 || frames < max_frames_;
+		});
+	}
+
+	virtual std::wstring print() const override
+	{
+		return L"benchmark[" + boost::lexical_cast<std::wstring>(channel_index_) + L"|" + format_desc_.name + L"]";
+	}
+
+	virtual boost::property_tree::wptree info() const override
+	{
+		tbb::spin_mutex::scoped_lock lock(stats_mutex_);
+
+		boost::property_tree::wptree info;
+		info.add(L"type", L"benchmark-consumer");
+		info.add(L"clock", clock_);
+		info.add(L"frames", frames_);
+		info.add(L"late-ticks", late_ticks_);
+		info.add(L"fps", fps());
+		intervals_.describe(info.add_child(L"interval-millis", boost::property_tree::wptree()));
+		jitter_.describe(info.add_child(L"jitter-millis", boost::property_tree::wptree()));
+		ages_.describe(info.add_child(L"age-millis", boost::property_tree::wptree()));
+
+		if (checksums_)
+			info.add(L"checksum", combined_checksum_);
+
+		return info;
+	}
+
+	virtual bool has_synchronization_clock() const override
+	{
+		return true;
+	}
+
+	virtual int buffer_depth() const override
+	{
+		return 1;
+	}
+
+	virtual int index() const override
+	{
+		return 1000;
+	}
+
+	// benchmark_consumer
+
+	double fps() const
+	{
+		if (frames_ < 2)
+			return 0.0;
+
+		auto elapsed = boost::chrono::duration_cast<boost::chrono::duration<double>>(last_arrival_ - start_time_).count();
+
+		return elapsed > 0.0 ? (frames_ - 1) / elapsed : 0.0;
+	}
+
+	// Returns the number of frames recorded so far.
+	int64_t record(const safe_ptr<read_frame>& frame, const clock::time_point& arrival)
+	{
+		using namespace boost::chrono;
+
+		auto age		= frame->get_age_millis();
+		auto interval	= 0.0;
+		auto jitter		= 0.0;
+		auto hash		= checksums_ ? checksum(frame->image_data()) : 0;
+
+		tbb::spin_mutex::scoped_lock lock(stats_mutex_);
+
+		if (frames_ == 0)
+			start_time_ = arrival;
+		else
+		{
+			interval	= duration_cast<duration<double, boost::milli>>(arrival - last_arrival_).count();
+			// Jitter is the deviation of the interval from the nominal frame
+			// period, its statistics are over the absolute deviation.
+			jitter		= interval - 1000.0 / format_desc_.fps;
+
+			intervals_.add(interval);
+			jitter_.add(std::abs(jitter));
+		}
+
+		ages_.add(static_cast<double>(age));
+		last_age_		= age;
+		last_arrival_	= arrival;
+		++frames_;
+
+		if (checksums_)
+		{
+			last_checksum_		= hash;
+			combined_checksum_	= (combined_checksum_ ^ last_checksum_) * 1099511628211ULL;
+		}
+
+		auto frames		= frames_;
+		auto elapsed	= duration_cast<duration<double, boost::milli>>(arrival - start_time_).count();
+
+		lock.release();
+
+		if (file_.is_open())
+		{
+			file_	<< frames << L","
+					<< elapsed << L","
+					<< interval << L","
+					<< jitter << L","
+					<< age << L","
+					<< std::hex << hash << std::dec << L"\n";
+		}
+
+		return frames;
+	}
+
+	void wait_for_next_tick(int64_t frames)
+	{
+		auto period = boost::chrono::duration_cast<clock::duration>(boost::chrono::duration<double>(1.0 / format_desc_.fps));
+		auto now	= clock::now();
+
+		// Ticks are scheduled from the previous tick and not from the time
+		// the frame arrived, so the cadence does not drift.
+		next_tick_ = frames == 1 ? now + period : next_tick_ + period;
+
+		if (next_tick_ < now)
+		{
+			tbb::spin_mutex::scoped_lock lock(stats_mutex_);
+			++late_ticks_;
+			next_tick_ = now;
+			return;
+		}
+
+		boost::this_thread::sleep(boost::posix_time::microseconds(
+				boost::chrono::duration_cast<boost::chrono::microseconds>(next_tick_ - now).count()));
+	}
+
+	void summarize()
+	{
+		if (frames_ == 0)
+			return;
+
+		CASPAR_LOG(info) << print() 
+				<< L" Frames: "		<< frames_
+				<< L" Fps: "		<< fps()
+				<< L" Interval: "	<< intervals_.mean() << L" ms (stddev " << intervals_.stddev() << L", min " << intervals_.min << L", max " << intervals_.max << L")"
+				<< L" Jitter: "		<< jitter_.mean() << L" ms (max " << jitter_.max << L")"
+				<< L" Age: "		<< ages_.mean() << L" ms (max " << ages_.max << L")"
+				<< L" Late ticks: "	<< late_ticks_;
+
+		if (file_.is_open())
+		{
+			file_	<< L"# frames: "		<< frames_ << L"\n"
+					<< L"# fps: "			<< fps() << L"\n"
+					<< L"# interval-ms: "	<< intervals_.mean() << L" " << intervals_.stddev() << L" " << intervals_.min << L" " << intervals_.max << L"\n"
+					<< L"# jitter-ms: "		<< jitter_.mean() << L" " << jitter_.max << L"\n"
+					<< L"# age-ms: "		<< ages_.mean() << L" " << ages_.max << L"\n"
+					<< L"# late-ticks: "	<< late_ticks_ << L"\n";
+
+			if (checksums_)
+				file_ << L"# checksum: " << std::hex << combined_checksum_ << std::dec << L"\n";
+
+			file_.flush();
+		}
+	}
+};
+
+safe_ptr<frame_consumer> create_benchmark_consumer(const parameters& params)
+{
+	if (params.size() < 1 || params[0] != L"BENCHMARK")
+		return frame_consumer::empty();
+
+	bool clock			= !params.has(L"FREE");
+	bool checksums		= params.has(L"CHECKSUM");
+	int64_t max_frames	= params.get(L"FRAMES", static_cast<int64_t>(0));
+	std::wstring filename;
+
+	auto file_it = std::find(params.begin(), params.end(), L"FILE");
+	if (file_it != params.end() && file_it + 1 != params.end())
+		filename = params.at_original(file_it - params.begin() + 1);
+
+	return make_safe<benchmark_consumer>(clock, checksums, max_frames, filename);
+}
+
+safe_ptr<frame_consumer> create_benchmark_consumer(const boost::property_tree::wptree& ptree)
+{
+	bool clock			= ptree.get(L"clock", true);
+	bool checksums		= ptree.get(L"checksum", false);
+	int64_t max_frames	= ptree.get(L"frames", static_cast<int64_t>(0));
+	auto filename		= ptree.get(L"file", L"");
+
+	return make_safe<benchmark_consumer>(clock, checksums, max_frames, filename);
+}
+
+}}
@@ -28,6 +28,7 @@
 #include "output.h"
 
 #include "../video_format.h"
+#include "../frame_trace.h"
 #include "../mixer/gpu/ogl_device.h"
 #include "../mixer/read_frame.h"
 
@@ -42,10 +43,86 @@
 #include <boost/range/algorithm.hpp>
 #include <boost/range/adaptors.hpp>
 #include <boost/property_tree/ptree.hpp>
+#include <boost/thread/thread_time.hpp>
 
 namespace caspar { namespace core {
 
 const long SEND_TIMEOUT_MILLIS = 10000L;
+
+// Number of consecutive frame deadlines a consumer without a synchronization
+// clock may miss before it is quarantined.
+const int MAX_MISSED_DEADLINES = 10;
+
+// Number of frames a consumer without a synchronization clock may fall behind
+// before frames are dropped for it.
+const size_t MAX_QUEUED_FRAMES = 3;
+
+// Consumers without a synchronization clock are never waited on past their
+// frame deadline. Frames arriving while such a consumer is still busy with an
+// earlier send are put in its own queue, and only dropped once that queue is
+// full, so a stalled file or stream consumer can not hold back the channel or
+// the other consumers.
+//
+// Each consumer also has its own delay line. By default no consumer is delayed,
+// so the latency of a consumer does not depend on the other consumers. With
+// configuration.align-consumers set, consumers that report a buffer depth are
+// delayed by the difference between their depth and the deepest consumer's,
+// which aligns their presentation at the cost of that extra latency.
+struct consumer_state
+{
+	boost::circular_buffer<safe_ptr<read_frame>>	delay_line;
+	boost::circular_buffer<safe_ptr<read_frame>>	queued_frames;
+	std::shared_ptr<boost::unique_future<bool>>	pending;
+	std::shared_ptr<read_frame>					pending_frame;
+	boost::posix_time::ptime					sent_time;
+	boost::posix_time::ptime					deadline;
+	bool										deadline_missed;
+	bool										retried;
+	int											missed_deadlines;
+	boost::posix_time::ptime					quarantined_until;
+	int64_t										dropped_frames;
+
+	consumer_state()
+		: queued_frames(MAX_QUEUED_FRAMES)
+		, deadline_missed(false)
+		, retried(false)
+		, missed_deadlines(0)
+		, dropped_frames(0)
+	{
+	}
+
+	bool quarantined(const boost::posix_time::ptime& now) const
+	{
+		return !quarantined_until.is_not_a_date_time() && now < quarantined_until;
+	}
+
+	// Returns the frame pushed the given number of ticks ago. While the line
+	// is filling up the oldest frame is repeated, so that a consumer is never
+	// starved while another consumer is being added.
+	safe_ptr<read_frame> delay(const safe_ptr<read_frame>& frame, int frames)
+	{
+		if (delay_line.capacity() != static_cast<size_t>(frames + 1))
+			delay_line.rset_capacity(frames + 1); // Drops the oldest frames when shrinking.
+
+		delay_line.push_back(frame);
+
+		return delay_line.front();
+	}
+
+	// Queues a frame while the previous send is in flight. Returns false if the
+	// queue was full and its oldest frame had to be dropped.
+	bool enqueue(const safe_ptr<read_frame>& frame)
+	{
+		bool full = queued_frames.full();
+		queued_frames.push_back(frame);
+		return !full;
+	}
+
+	int delay_frames() const
+	{
+		return delay_line.empty() ? 0 : static_cast<int>(delay_line.size()) - 1;
+	}
+};
 	
 struct output::implementation
 {		
@@ -61,8 +138,9 @@ struct output::implementation
 	
 	high_prec_timer									sync_timer_;
 
-	boost::circular_buffer<safe_ptr<read_frame>>	frames_;
 	std::map<int, int64_t>							send_to_consumers_delays_;
+	std::map<int, consumer_state>					consumer_states_;
+	const bool										align_consumers_;
 
 	executor										executor_;
 		
@@ -77,9 +155,11 @@ public:
 		, monitor_subject_("/output")
 		, format_desc_(format_desc)
 		, audio_channel_layout_(audio_channel_layout)
+		, align_consumers_(env::properties().get(L"configuration.align-consumers", false))
 		, executor_(L"output " + boost::lexical_cast<std::wstring>(channel_index))
 	{
 		graph_->set_color("consume-time", diagnostics::color(1.0f, 0.4f, 0.0f, 0.8));
+		graph_->set_color("late-consumer", diagnostics::color(0.9f, 0.6f, 0.9f));
 	}
 
 	void add(int index, safe_ptr<frame_consumer> consumer)
@@ -112,8 +192,7 @@ public:
 			if(it != consumers_.end())
 			{
 				old_consumer = it->second;
-				send_to_consumers_delays_.erase(it->first);
-				consumers_.erase(it);
+				erase_consumer(index);
 			}
 		}, high_priority);
 
@@ -146,13 +225,17 @@ public:
 				{
 					CASPAR_LOG_CURRENT_EXCEPTION();
 					CASPAR_LOG(info) << print() << L" " << it->second->print() << L" Removed.";
-					send_to_consumers_delays_.erase(it->first);
-					consumers_.erase(it++);
+					erase_consumer((it++)->first);
 				}
 			}
 			
 			format_desc_ = format_desc;
-			frames_.clear();
+
+			BOOST_FOREACH(auto& state, consumer_states_)
+			{
+				state.second.delay_line.clear();
+				state.second.queued_frames.clear();
+			}
 		});
 	}
 	
@@ -199,6 +282,11 @@ public:
 			{
 				consume_timer_.restart();
 
+				auto trace = get_frame_trace(packet.second);
+
+				if(trace)
+					trace->stamp(frame_trace::output_begin);
+
 				auto input_frame = packet.first;
 
 				if(!has_synchronization_clock())
@@ -210,29 +298,64 @@ public:
 					return;
 				}
 				
-				auto buffer_depths = buffer_depths_snapshot();
-				auto minmax = minmax_buffer_depth(buffer_depths);
+				// Sends that completed since the previous frame free their consumers
+				// before it is decided whether this frame has to be queued.
+				for (auto it = consumers_.begin(); it != consumers_.end();)
+				{
+					auto index = (it++)->first;
+					auto state = consumer_states_.find(index);
 
-				frames_.set_capacity(minmax.second - minmax.first + 1);
-				frames_.push_back(input_frame);
+					if (state != consumer_states_.end() && state->second.pending && state->second.pending->is_ready())
+						collect(index);
+				}
 
-				if(!frames_.full())
-					return;
+				auto buffer_depths = buffer_depths_snapshot();
+				auto minmax = minmax_buffer_depth(buffer_depths);
 
-				std::map<int, boost::unique_future<bool>> send_results;
+				const auto now			= boost::get_system_time();
+				const auto frame_period	= boost::posix_time::microseconds(static_cast<int64_t>(1000000.0 / format_desc_.fps));
 
 				// Start invocations
 				for (auto it = consumers_.begin(); it != consumers_.end();)
 				{
 					auto consumer	= it->second;
 					auto depth		= buffer_depths[it->first];
-					auto frame		= depth < 0 ? frames_.back() : frames_.at(depth - minmax.first);
+					auto& state		= consumer_states_[it->first];
+					auto frame		= state.delay(input_frame, align_consumers_ && depth >= 0 ? minmax.second - depth : 0);
+
+					if (state.quarantined(now))
+					{
+						state.queued_frames.clear();
+						++state.dropped_frames;
+						graph_->set_tag("late-consumer");
+						++it;
+						continue;
+					}
+
+					if (state.pending)
+					{
+						// Still busy with an earlier frame.
+						if (!state.enqueue(frame))
+						{
+							++state.dropped_frames;
+							graph_->set_tag("late-consumer");
+						}
+						++it;
+						continue;
+					}
+
+					if (!state.queued_frames.empty())
+					{
+						state.enqueue(frame);
+						frame = state.queued_frames.front();
+						state.queued_frames.pop_front();
+					}
 
 					send_to_consumers_delays_[it->first] = frame->get_age_millis();
 						
 					try
 					{
-						send_results.insert(std::make_pair(it->first, consumer->send(frame)));
+						dispatch(state, consumer, frame, now, frame_period);
 						++it;
 					}
 					catch(...)
@@ -240,73 +363,40 @@ public:
 						CASPAR_LOG_CURRENT_EXCEPTION();
 						try
 						{
-							send_results.insert(std::make_pair(it->first, consumer->send(frame)));
+							dispatch(state, consumer, frame, now, frame_period);
 							++it;
 						}
 						catch(...)
 						{
 							CASPAR_LOG_CURRENT_EXCEPTION();
 							CASPAR_LOG(error) << "Failed to recover consumer: " << consumer->print() << L". Removing it.";
-							send_to_consumers_delays_.erase(it->first);
-							it = consumers_.erase(it);
+							erase_consumer((it++)->first);
 						}
 					}
 				}
 
-				// Retrieve results
-				for (auto result_it = send_results.begin(); result_it != send_results.end(); ++result_it)
+				if(trace)
+					trace->stamp(frame_trace::output_dispatched);
+
+				// Retrieve results. Consumers with a synchronization clock pace the
+				// channel and are waited for first, the rest only until their deadline.
+				for (int pass = 0; pass < 2; ++pass)
 				{
-					auto consumer		= consumers_.at(result_it->first);
-					auto depth			= buffer_depths[result_it->first];
-					auto frame			= depth < 0 ? frames_.back() : frames_.at(depth - minmax.first);
-					auto& result_future	= result_it->second;
-						
-					try
+					for (auto it = consumers_.begin(); it != consumers_.end();)
 					{
-						if (!result_future.timed_wait(boost::posix_time::seconds(SEND_TIMEOUT_MILLIS)))
-						{
-							BOOST_THROW_EXCEPTION(timed_out() << msg_info(narrow(print()) + " " + narrow(consumer->print()) + " Timed out during send"));
-						}
+						auto index = (it++)->first;
 
-						if (!result_future.get())
-						{
-							CASPAR_LOG(info) << print() << L" " << consumer->print() << L" Removed.";
-							send_to_consumers_delays_.erase(result_it->first);
-							consumers_.erase(result_it->first);
-						}
-					}
-					catch (...)
-					{
-						CASPAR_LOG_CURRENT_EXCEPTION();
-						try
-						{
-							consumer->initialize(format_desc_, audio_channel_layout_, channel_index_);
-							auto retry_future = consumer->send(frame);
-
-							if (!retry_future.timed_wait(boost::posix_time::seconds(SEND_TIMEOUT_MILLIS)))
-							{
-								BOOST_THROW_EXCEPTION(timed_out() << msg_info(narrow(print()) + " " + narrow(consumer->print()) + " Timed out during retry"));
-							}
-
-							if (!retry_future.get())
-							{
-								CASPAR_LOG(info) << print() << L" " << consumer->print() << L" Removed.";
-								send_to_consumers_delays_.erase(result_it->first);
-								consumers_.erase(result_it->first);
-							}
-						}
-						catch (...)
-						{
-							CASPAR_LOG_CURRENT_EXCEPTION();
-							CASPAR_LOG(error) << "Failed to recover consumer: " << consumer->print() << L". Removing it.";
-							send_to_consumers_delays_.erase(result_it->first);
-							consumers_.erase(result_it->first);
-						}
+						if (consumers_.at(index)->has_synchronization_clock() == (pass == 0))
+							collect(index);
 					}
 				}
+
+				if(trace)
+					trace->stamp(frame_trace::output_end);
 						
 				graph_->set_value("consume-time", consume_timer_.elapsed()*format_desc_.fps*0.5);
-				monitor_subject_ << monitor::message("/consume_time") % (consume_timer_.elapsed());
+				if (monitor_subject_.is_subscribed("/consume_time"))
+					monitor_subject_ << monitor::message("/consume_time") % (consume_timer_.elapsed());
 			}
 			catch(...)
 			{
@@ -315,6 +405,121 @@ public:
 		});
 	}
 
+	void dispatch(
+			consumer_state& state,
+			const safe_ptr<frame_consumer>& consumer,
+			const safe_ptr<read_frame>& frame,
+			const boost::posix_time::ptime& now,
+			const boost::posix_time::time_duration& frame_period)
+	{
+		state.pending			= std::make_shared<boost::unique_future<bool>>(consumer->send(frame));
+		state.pending_frame		= frame;
+		state.sent_time			= now;
+		state.deadline			= consumer->has_synchronization_clock()
+				? now + boost::posix_time::milliseconds(SEND_TIMEOUT_MILLIS)
+				: now + frame_period;
+		state.deadline_missed	= false;
+	}
+
+	void collect(int index)
+	{
+		auto consumer	= consumers_.at(index);
+		auto& state		= consumer_states_[index];
+
+		if (!state.pending)
+			return;
+
+		auto now		= boost::get_system_time();
+		auto remaining	= state.deadline > now ? state.deadline - now : boost::posix_time::time_duration(0, 0, 0);
+
+		try
+		{
+			if (!state.pending->timed_wait(remaining))
+			{
+				if (consumer->has_synchronization_clock() || now - state.sent_time > boost::posix_time::milliseconds(SEND_TIMEOUT_MILLIS))
+					BOOST_THROW_EXCEPTION(timed_out() << msg_info(narrow(print()) + " " + narrow(consumer->print()) + " Timed out during send"));
+
+				if (!state.deadline_missed)
+				{
+					state.deadline_missed = true;
+
+					if (++state.missed_deadlines == MAX_MISSED_DEADLINES)
+					{
+						state.quarantined_until = now + boost::posix_time::seconds(1);
+						state.missed_deadlines	= 0;
+						CASPAR_LOG(warning) << print() << L" " << consumer->print() << L" Missed " << MAX_MISSED_DEADLINES << L" frame deadlines. Quarantined.";
+					}
+				}
+
+				return;
+			}
+
+			if (!state.deadline_missed)
+				state.missed_deadlines = 0;
+
+			auto result = state.pending->get();
+			
+			state.pending.reset();
+			state.pending_frame.reset();
+			state.retried = false;
+
+			if (!result)
+			{
+				CASPAR_LOG(info) << print() << L" " << consumer->print() << L" Removed.";
+				erase_consumer(index);
+				return;
+			}
+
+			// Let a consumer that fell behind catch up without waiting for the
+			// next frame. The queued send is collected on a later frame.
+			if (!state.queued_frames.empty())
+			{
+				auto frame = state.queued_frames.front();
+				state.queued_frames.pop_front();
+				state.pending_frame = frame; // Retried like any other send if it throws.
+				dispatch(state, consumer, frame, now, boost::posix_time::microseconds(static_cast<int64_t>(1000000.0 / format_desc_.fps)));
+			}
+		}
+		catch (...)
+		{
+			CASPAR_LOG_CURRENT_EXCEPTION();
+
+			auto frame = state.pending_frame;
+			state.pending.reset();
+			state.pending_frame.reset();
+
+			if (state.retried || !frame)
+			{
+				CASPAR_LOG(error) << "Failed to recover consumer: " << consumer->print() << L". Removing it.";
+				erase_consumer(index);
+				return;
+			}
+
+			try
+			{
+				state.retried = true;
+				consumer->initialize(format_desc_, audio_channel_layout_, channel_index_);
+				dispatch(state, consumer, make_safe_ptr(frame), now, boost::posix_time::microseconds(static_cast<int64_t>(1000000.0 / format_desc_.fps)));
+
+				if (consumer->has_synchronization_clock())
+					collect(index);
+			}
+			catch (...)
+			{
+				CASPAR_LOG_CURRENT_EXCEPTION();
+				CASPAR_LOG(error) << "Failed to recover consumer: " << consumer->print() << L". Removing it.";
+				erase_consumer(index);
+			}
+		}
+	}
+
+	void erase_consumer(int index)
+	{
+		send_to_consumers_delays_.erase(index);
+		consumer_states_.erase(index);
+		consumers_.erase(index);
+	}
+
 	std::wstring print() const
 	{
 		return L"output[" + boost::lexical_cast<std::wstring>(channel_index_) + L"]";
@@ -327,8 +532,12 @@ public:
 			boost::property_tree::wptree info;
 			BOOST_FOREACH(auto& consumer, consumers_)
 			{
-				info.add_child(L"consumers.consumer", consumer.second->info())
-					.add(L"index", consumer.first); 
+				auto& state = consumer_states_[consumer.first];
+				auto& child = info.add_child(L"consumers.consumer", consumer.second->info());
+				child.add(L"index", consumer.first); 
+				child.add(L"dropped-frames", state.dropped_frames);
+				child.add(L"queued-frames", state.queued_frames.size());
+				child.add(L"quarantined", state.quarantined(boost::get_system_time()));
 			}
 			return info;
 		}, high_priority));
@@ -346,8 +555,12 @@ public:
 				auto sendoff_age = send_to_consumers_delays_[consumer.first];
 				auto presentation_time = total_age - sendoff_age;
 
+				auto delay_frames = consumer_states_[consumer.first].delay_frames();
+
 				boost::property_tree::wptree child;
 				child.add(L"name", consumer.second->print());
+				child.add(L"delay-frames", delay_frames);
+				child.add(L"delay-millis", static_cast<int64_t>(delay_frames * 1000.0 / format_desc_.fps));
 				child.add(L"age-at-arrival", sendoff_age);
 				child.add(L"presentation-time", presentation_time);
 				child.add(L"age-at-presentation", total_age);
@@ -0,0 +1,369 @@
+/*
+* Copyright 2026 Sveriges Television AB http://casparcg.com/
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "StdAfx.h"
+
+#include "frame_trace.h"
+
+#include <common/env.h>
+#include <common/exception/exceptions.h>
+#include <common/log/log.h>
+
+#include <boost/chrono.hpp>
+#include <boost/circular_buffer.hpp>
+#include <boost/exception/errinfo_file_name.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/foreach.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include <tbb/atomic.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+namespace caspar { namespace core {
+
+int64_t frame_trace::now()
+{
+	using namespace boost::chrono;
+
+	return duration_cast<microseconds>(high_resolution_clock::now().time_since_epoch()).count();
+}
+
+frame_trace::frame_trace(int64_t frame_number)
+	: frame_number_(frame_number)
+{
+	std::fill(timestamps_, timestamps_ + num_hops, 0);
+}
+
+void frame_trace::stamp(hop h)
+{
+	timestamps_[h] = now();
+}
+
+void frame_trace::add_layer(int index, int64_t begin, int64_t end)
+{
+	layer_span span = { index, begin, end };
+
+	tbb::spin_mutex::scoped_lock lock(layers_mutex_);
+	layers_.push_back(span);
+}
+
+int64_t frame_trace::frame_number() const
+{
+	return frame_number_;
+}
+
+int64_t frame_trace::timestamp(hop h) const
+{
+	return timestamps_[h];
+}
+
+std::vector<frame_trace::layer_span> frame_trace::layers() const
+{
+	tbb::spin_mutex::scoped_lock lock(layers_mutex_);
+	return layers_;
+}
+
+// Buckets grow by a factor of 2^(1/4) starting at 1 microsecond, which keeps
+// the relative error of the reported percentiles below 20%.
+class latency_histogram
+{
+	enum { NUM_BUCKETS = 128 };
+
+	int64_t	buckets_[NUM_BUCKETS];
+	int64_t	count_;
+	int64_t	sum_;
+	int64_t	max_;
+public:
+	latency_histogram()
+	{
+		reset();
+	}
+
+	void reset()
+	{
+		std::fill(buckets_, buckets_ + NUM_BUCKETS, 0);
+		count_	= 0;
+		sum_	= 0;
+		max_	= 0;
+	}
+
+	void add(int64_t micros)
+	{
+		micros = std::max<int64_t>(micros, 0);
+
+		int bucket = micros < 1 ? 0 : static_cast<int>(std::log(static_cast<double>(micros)) / std::log(2.0) * 4.0);
+
+		++buckets_[std::min<int>(bucket, NUM_BUCKETS - 1)];
+		++count_;
+		sum_ += micros;
+		max_ = std::max(max_, micros);
+	}
+
+	double percentile(double p) const
+	{
+		if (count_ == 0)
+			return 0.0;
+
+		auto target = static_cast<int64_t>(std::ceil(p * count_));
+		int64_t seen = 0;
+
+		for (int n = 0; n < NUM_BUCKETS; ++n)
+		{
+			seen += buckets_[n];
+
+			if (seen >= target)
+				return std::min(std::pow(2.0, (n + 1) / 4.0), static_cast<double>(max_));
+		}
+
+		return static_cast<double>(max_);
+	}
+
+	boost::property_tree::wptree info() const
+	{
+		boost::property_tree::wptree info;
+		info.add(L"count", count_);
+		info.add(L"mean-millis", count_ > 0 ? sum_ / 1000.0 / count_ : 0.0);
+		info.add(L"p50-millis", percentile(0.50) / 1000.0);
+		info.add(L"p90-millis", percentile(0.90) / 1000.0);
+		info.add(L"p99-millis", percentile(0.99) / 1000.0);
+		info.add(L"max-millis", max_ / 1000.0);
+		return info;
+	}
+};
+
+struct span_desc
+{
+	const wchar_t*		name;
+	frame_trace::hop	begin;
+	frame_trace::hop	end;
+};
+
+const span_desc SPANS[] =
+{
+	{ L"stage",				frame_trace::stage_begin,		frame_trace::stage_end },
+	{ L"stage-to-mixer",	frame_trace::stage_end,			frame_trace::mixer_begin },
+	{ L"mixer",				frame_trace::mixer_begin,		frame_trace::mixer_end },
+	{ L"mixer-to-output",	frame_trace::mixer_end,			frame_trace::output_begin },
+	{ L"dispatch",			frame_trace::output_begin,		frame_trace::output_dispatched },
+	{ L"consumers",			frame_trace::output_dispatched,	frame_trace::output_end },
+	{ L"total",				frame_trace::stage_begin,		frame_trace::output_end }
+};
+
+const int NUM_SPANS = sizeof(SPANS) / sizeof(SPANS[0]);
+
+struct frame_tracer::implementation : boost::noncopyable
+{
+	const int											channel_index_;
+	tbb::atomic<bool>									enabled_;
+	tbb::atomic<int64_t>								frame_number_;
+
+	mutable tbb::spin_mutex								mutex_;
+	latency_histogram									spans_[NUM_SPANS];
+	latency_histogram									producers_;
+	boost::circular_buffer<std::shared_ptr<frame_trace>> recent_;
+
+	implementation(int channel_index)
+		: channel_index_(channel_index)
+		, recent_(1024)
+	{
+		enabled_		= false;
+		frame_number_	= 0;
+	}
+
+	void complete(const std::shared_ptr<frame_trace>& trace)
+	{
+		// A tick that was dropped on its way to the output has nothing to report.
+		if (trace->timestamp(frame_trace::output_end) == 0)
+			return;
+
+		auto layers = trace->layers();
+
+		tbb::spin_mutex::scoped_lock lock(mutex_);
+
+		for (int n = 0; n < NUM_SPANS; ++n)
+			spans_[n].add(trace->timestamp(SPANS[n].end) - trace->timestamp(SPANS[n].begin));
+
+		BOOST_FOREACH(auto& layer, layers)
+			producers_.add(layer.end - layer.begin);
+
+		recent_.push_back(trace);
+	}
+};
+
+struct traced_ticket_deleter
+{
+	std::shared_ptr<frame_trace>						trace;
+	std::weak_ptr<frame_tracer::implementation>			tracer;
+	std::function<void()>								on_release;
+
+	void operator()(void*)
+	{
+		auto impl = tracer.lock();
+
+		if (impl)
+			impl->complete(trace);
+
+		on_release();
+	}
+};
+
+frame_trace* get_frame_trace(const std::shared_ptr<void>& ticket)
+{
+	auto deleter = std::get_deleter<traced_ticket_deleter>(ticket);
+
+	return deleter ? deleter->trace.get() : nullptr;
+}
+
+frame_tracer::frame_tracer(int channel_index) 
+	: impl_(new implementation(channel_index))
+{
+}
+
+std::shared_ptr<void> frame_tracer::create_ticket(const std::function<void()>& on_release)
+{
+	if (!impl_->enabled_)
+		return std::shared_ptr<void>(nullptr, [on_release](void*) { on_release(); });
+
+	traced_ticket_deleter deleter;
+	deleter.trace		= std::make_shared<frame_trace>(impl_->frame_number_++);
+	deleter.tracer		= impl_;
+	deleter.on_release	= on_release;
+
+	auto trace = deleter.trace.get();
+	trace->stamp(frame_trace::stage_begin);
+
+	return std::shared_ptr<void>(trace, deleter);
+}
+
+void frame_tracer::reset()
+{
+	tbb::spin_mutex::scoped_lock lock(impl_->mutex_);
+
+	for (int n = 0; n < NUM_SPANS; ++n)
+		impl_->spans_[n].reset();
+
+	impl_->producers_.reset();
+	impl_->recent_.clear();
+}
+
+void frame_tracer::write_chrome_trace(const std::wstring& filename) const
+{
+	std::vector<std::shared_ptr<frame_trace>> traces;
+
+	{
+		tbb::spin_mutex::scoped_lock lock(impl_->mutex_);
+		traces.assign(impl_->recent_.begin(), impl_->recent_.end());
+	}
+
+	// Traces are only written below the log folder.
+	auto relative_path = boost::filesystem::path(filename);
+
+	if (relative_path.empty() || relative_path.has_root_path() || std::find(relative_path.begin(), relative_path.end(), boost::filesystem::path(L"..")) != relative_path.end())
+		BOOST_THROW_EXCEPTION(invalid_argument() << arg_name_info("filename") << arg_value_info(narrow(filename)) << msg_info("Expected a path relative to the log folder."));
+
+	auto path = boost::filesystem::path(env::log_folder()) / relative_path;
+
+	if (!boost::filesystem::exists(path.parent_path()))
+		boost::filesystem::create_directories(path.parent_path());
+
+	std::ofstream file(path.wstring().c_str());
+
+	if (!file.is_open())
+		BOOST_THROW_EXCEPTION(file_not_found() << msg_info("Could not open trace file.") << boost::errinfo_file_name(path.string()));
+
+	// Chrome's trace event format, readable by chrome://tracing and Perfetto.
+	auto pid	= impl_->channel_index_;
+	bool first	= true;
+
+	auto write_event = [&](const char* name, int tid, int64_t begin, int64_t end, int64_t frame_number)
+	{
+		if (begin == 0 || end == 0)
+			return;
+
+		file	<< (first ? "\n" : ",\n")
+				<< "{\"name\":\"" << name << "\",\"cat\":\"channel\",\"ph\":\"X\""
+				<< ",\"ts\":" << begin << ",\"dur\":" << std::max<int64_t>(end - begin, 0)
+				<< ",\"pid\":" << pid << ",\"tid\":" << tid
+				<< ",\"args\":{\"frame\":" << frame_number << "}}";
+
+		first = false;
+	};
+
+	auto write_thread_name = [&](int tid, const std::string& name)
+	{
+		file	<< (first ? "\n" : ",\n")
+				<< "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << tid
+				<< ",\"args\":{\"name\":\"" << name << "\"}}";
+
+		first = false;
+	};
+
+	file << "{\"traceEvents\":[";
+
+	write_thread_name(1, "stage");
+	write_thread_name(2, "mixer");
+	write_thread_name(3, "output");
+
+	BOOST_FOREACH(auto& trace, traces)
+	{
+		auto frame = trace->frame_number();
+
+		write_event("stage",		1, trace->timestamp(frame_trace::stage_begin),			trace->timestamp(frame_trace::stage_end),			frame);
+		write_event("mix",			2, trace->timestamp(frame_trace::mixer_begin),			trace->timestamp(frame_trace::mixer_end),			frame);
+		write_event("dispatch",		3, trace->timestamp(frame_trace::output_begin),		trace->timestamp(frame_trace::output_dispatched),	frame);
+		write_event("consumers",	3, trace->timestamp(frame_trace::output_dispatched),	trace->timestamp(frame_trace::output_end),			frame);
+
+		BOOST_FOREACH(auto& layer, trace->layers())
+			write_event(("layer " + boost::lexical_cast<std::string>(layer.index)).c_str(), 100 + layer.index, layer.begin, layer.end, frame);
+	}
+
+	file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+void frame_tracer::enable(bool value)
+{
+	impl_->enabled_ = value;
+}
+
+bool frame_tracer::enabled() const
+{
+	return impl_->enabled_;
+}
+
+boost::property_tree::wptree frame_tracer::info() const
+{
+	boost::property_tree::wptree info;
+	info.add(L"enabled", enabled());
+
+	tbb::spin_mutex::scoped_lock lock(impl_->mutex_);
+
+	for (int n = 0; n < NUM_SPANS; ++n)
+		info.add_child(std::wstring(L"latency.") + SPANS[n].name, impl_->spans_[n].info());
+
+	info.add_child(L"latency.producer", impl_->producers_.info());
+
+	return info;
+}
+
+}}
@@ -0,0 +1,128 @@
+/*
+* Copyright 2026 Sveriges Television AB http://casparcg.com/
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <common/memory/safe_ptr.h>
+
+#include <boost/noncopyable.hpp>
+#include <boost/property_tree/ptree_fwd.hpp>
+
+#include <tbb/spin_mutex.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+namespace caspar { namespace core {
+
+// Timestamps of a single channel tick on its way from the stage, through the
+// mixer to the output and its consumers.
+class frame_trace : boost::noncopyable
+{
+public:
+
+	// Static Members
+
+	enum hop
+	{
+		stage_begin = 0,
+		stage_end,
+		mixer_begin,
+		mixer_end,
+		output_begin,
+		output_dispatched,
+		output_end,
+		num_hops
+	};
+
+	struct layer_span
+	{
+		int		index;
+		int64_t	begin;
+		int64_t	end;
+	};
+
+	// Microseconds since an arbitrary epoch.
+	static int64_t now();
+
+	// Constructors
+
+	explicit frame_trace(int64_t frame_number);
+
+	// Methods
+
+	void stamp(hop h);
+	void add_layer(int index, int64_t begin, int64_t end);
+
+	// Properties
+
+	int64_t frame_number() const;
+	int64_t timestamp(hop h) const; // 0 if the hop was never reached
+	std::vector<layer_span> layers() const;
+private:
+	const int64_t			frame_number_;
+	int64_t					timestamps_[num_hops];
+	std::vector<layer_span>	layers_;
+	mutable tbb::spin_mutex	layers_mutex_;
+};
+
+// Returns the trace carried by a pipeline ticket, or nullptr if the ticket was
+// created while tracing was disabled.
+frame_trace* get_frame_trace(const std::shared_ptr<void>& ticket);
+
+// Creates traces for a channel and aggregates the completed ones into latency
+// histograms.
+class frame_tracer : boost::noncopyable
+{
+public:
+
+	// Constructors
+
+	explicit frame_tracer(int channel_index);
+
+	// Methods
+
+	// on_release is invoked when the last copy of the ticket is destroyed.
+	std::shared_ptr<void> create_ticket(const std::function<void()>& on_release);
+
+	void reset();
+
+	// filename is relative to the log folder, absolute paths and paths with
+	// ".." components are rejected with invalid_argument.
+	void write_chrome_trace(const std::wstring& filename) const;
+
+	// Properties
+
+	void enable(bool value);
+	bool enabled() const;
+
+	boost::property_tree::wptree info() const;
+private:
+	friend struct traced_ticket_deleter;
+
+	struct implementation;
+	std::shared_ptr<implementation> impl_;
+};
+
+}}
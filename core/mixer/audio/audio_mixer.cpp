@@ -69,7 +69,7 @@ struct audio_stream
 struct audio_mixer::implementation
 {
 	safe_ptr<diagnostics::graph>		graph_;
-	std::stack<core::frame_transform>	transform_stack_;
+	std::stack<core::frame_transform, std::vector<core::frame_transform>>	transform_stack_;
 	std::map<const void*, audio_stream>	audio_streams_;
 	std::vector<audio_item>				items_;
 	std::vector<size_t>					audio_cadence_;
@@ -78,6 +78,7 @@ struct audio_mixer::implementation
 	float								master_volume_;
 	float								previous_master_volume_;
 	monitor::subject					monitor_subject_;
+	std::vector<std::pair<monitor::interned_path, monitor::interned_path>> level_paths_;
 	/**/
 	double								volume_;
 	std::wstring						audioinfo;
@@ -299,7 +300,10 @@ public:
 		boost::range::transform(result_ps, std::back_inserter(result), [](double sample){return static_cast<int32_t>(sample);});		
 		
 		const int num_channels = channel_layout_.num_channels;
-		monitor_subject_ << monitor::message("/nb_channels") % num_channels;
+		const bool monitor_levels = monitor_subject_.is_subscribed("");
+
+		if (monitor_levels)
+			monitor_subject_ << monitor::message("/nb_channels") % num_channels;
 
 		auto max = std::vector<int32_t>(num_channels, std::numeric_limits<int32_t>::min());
 
@@ -311,15 +315,25 @@ public:
 		// Otherwise it would be -infinity
 		static const auto MIN_PFS = 0.5f / static_cast<float>(std::numeric_limits<int32_t>::max());
 
-		for (int i = 0; i < num_channels; ++i)
+		if (monitor_levels)
 		{
-			const auto pFS  = max[i] / static_cast<float>(std::numeric_limits<int32_t>::max());
-			const auto dBFS = 20.0f * std::log10(std::max(MIN_PFS, pFS));
-			
-			auto chan_str = boost::lexical_cast<std::string>(i + 1);
+			while (level_paths_.size() < static_cast<size_t>(num_channels))
+			{
+				auto chan_str = boost::lexical_cast<std::string>(level_paths_.size() + 1);
+
+				level_paths_.push_back(std::make_pair(
+						monitor::interned_path("/" + chan_str + "/pFS"),
+						monitor::interned_path("/" + chan_str + "/dBFS")));
+			}
+
+			for (int i = 0; i < num_channels; ++i)
+			{
+				const auto pFS  = max[i] / static_cast<float>(std::numeric_limits<int32_t>::max());
+				const auto dBFS = 20.0f * std::log10(std::max(MIN_PFS, pFS));
 
-			monitor_subject_ << monitor::message("/" + chan_str + "/pFS") % pFS;
-			monitor_subject_ << monitor::message("/" + chan_str + "/dBFS") % dBFS;
+				monitor_subject_ << monitor::message(level_paths_[i].first) % pFS;
+				monitor_subject_ << monitor::message(level_paths_[i].second) % dBFS;
+			}
 		}
 
 		graph_->set_value("volume", static_cast<double>(*boost::max_element(max)) / std::numeric_limits<int32_t>::max());
@@ -329,7 +343,8 @@ public:
 
 		audioinfo = audio_string.str();
 		std::string str( audioinfo.begin(), audioinfo.end() );
-		monitor_subject_ << monitor::message("/audio_info") % str;
+		if (monitor_levels)
+			monitor_subject_ << monitor::message("/audio_info") % str;
 		return result;
 	}
 
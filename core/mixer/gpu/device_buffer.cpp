@@ -25,6 +25,8 @@
 
 #include "fence.h"
 
+#include "../../producer/frame/dirty_region.h"
+
 #include <common/exception/exceptions.h>
 #include <common/gl/gl_check.h>
 
@@ -32,6 +34,8 @@
 
 #include <tbb/atomic.h>
 
+#include <boost/foreach.hpp>
+
 #include <boost/property_tree/ptree.hpp>
 
 namespace caspar { namespace core {
@@ -138,10 +142,30 @@ public:
 		GL(glBindTexture(GL_TEXTURE_2D, 0));
 	}
 
-	void begin_read()
+	void begin_read(const void* data)
+	{
+		bind();
+		GL(glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width_, height_, FORMAT[stride_], GL_UNSIGNED_BYTE, data));
+
+		if (mipmapped_)
+			GL(glGenerateMipmap(GL_TEXTURE_2D));
+
+		unbind();
+		fence_.set();
+	}
+
+	void begin_read(const std::vector<pixel_rect>& regions)
 	{
 		bind();
-		GL(glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width_, height_, FORMAT[stride_], GL_UNSIGNED_BYTE, NULL));
+		GL(glPixelStorei(GL_UNPACK_ROW_LENGTH, width_));
+
+		BOOST_FOREACH(auto& rect, regions)
+		{
+			auto offset = (static_cast<size_t>(rect.y) * width_ + rect.x) * stride_;
+			GL(glTexSubImage2D(GL_TEXTURE_2D, 0, rect.x, rect.y, rect.width, rect.height, FORMAT[stride_], GL_UNSIGNED_BYTE, reinterpret_cast<const void*>(offset)));
+		}
+
+		GL(glPixelStorei(GL_UNPACK_ROW_LENGTH, 0));
 
 		if (mipmapped_)
 			GL(glGenerateMipmap(GL_TEXTURE_2D));
@@ -163,7 +187,8 @@ size_t device_buffer::height() const { return impl_->height_; }
 size_t device_buffer::size() const { return impl_->size_; }
 void device_buffer::bind(int index){impl_->bind(index);}
 void device_buffer::unbind(){impl_->unbind();}
-void device_buffer::begin_read(){impl_->begin_read();}
+void device_buffer::begin_read(const void* data){impl_->begin_read(data);}
+void device_buffer::begin_read(const std::vector<pixel_rect>& regions){impl_->begin_read(regions);}
 bool device_buffer::ready() const{return impl_->ready();}
 int device_buffer::id() const{ return impl_->id_;}
 
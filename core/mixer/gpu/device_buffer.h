@@ -27,8 +27,11 @@
 #include <boost/property_tree/ptree_fwd.hpp>
 
 #include <memory>
+#include <vector>
 
 namespace caspar { namespace core {
+
+struct pixel_rect;
 		
 class device_buffer : boost::noncopyable
 {
@@ -43,7 +46,13 @@ public:
 	void bind(int index);
 	void unbind();
 		
-	void begin_read();
+	// Uploads from the bound pixel unpack buffer, or from client memory if data
+	// is given.
+	void begin_read(const void* data = nullptr);
+
+	// Uploads parts of the image from the bound pixel unpack buffer, which
+	// holds the whole image.
+	void begin_read(const std::vector<pixel_rect>& regions);
 	bool ready() const;
 
 	static boost::property_tree::wptree info();
@@ -148,6 +148,21 @@ public:
 	{
 		return fence_.ready();
 	}
+
+	void upload(device_buffer& texture)
+	{
+		// A mapped buffer can not be sourced by OpenGL, let the driver read
+		// the mapping instead.
+		if(data_)
+		{
+			texture.begin_read(data_);
+			return;
+		}
+
+		GL(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo_));
+		texture.begin_read();
+		GL(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+	}
 };
 
 host_buffer::host_buffer(size_t size, usage_t usage) : impl_(new implementation(size, usage)){}
@@ -161,6 +176,7 @@ void host_buffer::begin_read(size_t width, size_t height, GLuint format){impl_->
 size_t host_buffer::size() const { return impl_->size_; }
 bool host_buffer::ready() const{return impl_->ready();}
 void host_buffer::wait(ogl_device& ogl){impl_->wait(ogl);}
+void host_buffer::upload(device_buffer& texture){impl_->upload(texture);}
 
 boost::property_tree::wptree host_buffer::info()
 {
@@ -29,6 +29,7 @@
 namespace caspar { namespace core {
 
 class ogl_device;
+class device_buffer;
 		
 class host_buffer : boost::noncopyable
 {
@@ -53,6 +54,10 @@ public:
 	bool ready() const;
 	void wait(ogl_device& ogl);
 
+	// Uploads the contents to a texture of the same size without going through
+	// the CPU. Must be called on the ogl_device thread.
+	void upload(device_buffer& texture);
+
 	static boost::property_tree::wptree info();
 private:
 	friend class ogl_device;
@@ -34,6 +34,7 @@
 #include <common/concurrency/future_util.h>
 #include <common/exception/exceptions.h>
 #include <common/gl/gl_check.h>
+#include <common/utility/move_on_copy.h>
 #include <common/utility/tweener.h>
 #include <common/memory/safe_ptr.h>
 
@@ -46,6 +47,7 @@
 #include <core/producer/frame/pixel_format.h>
 
 #include <core/monitor/monitor.h>
+#include <core/frame_trace.h>
 
 #include <core/video_format.h>
 
@@ -100,6 +102,24 @@ public:
 				ogl_, tag, desc, audio_channel_layout, mipmapping_);
 	}
 
+	safe_ptr<core::write_frame> create_frame(
+			const void* tag,
+			const safe_ptr<read_frame>& source,
+			const core::pixel_format_desc& desc) override
+	{
+		return make_safe<write_frame>(
+				ogl_, tag, source, desc, mipmapping_);
+	}
+
+	safe_ptr<core::write_frame> create_frame(
+			const void* tag,
+			const safe_ptr<write_frame>& previous,
+			const std::vector<pixel_rect>& regions) override
+	{
+		return make_safe<write_frame>(
+				ogl_, tag, previous, regions);
+	}
+
 	video_format_desc get_video_format_desc() const override
 	{
 		tbb::spin_mutex::scoped_lock lock(format_desc_mutex_);
@@ -159,17 +179,26 @@ public:
 		audio_mixer_.monitor_output().attach_parent(monitor_subject_);
 	}
 	
-	void send(const std::pair<std::map<int, safe_ptr<core::basic_frame>>, std::shared_ptr<void>>& packet)
+	void send(std::pair<std::vector<std::pair<int, safe_ptr<core::basic_frame>>>, std::shared_ptr<void>>&& packet)
 	{			
+		// Moved into the task, the frames are not copied on their way to the
+		// mixer thread.
+		auto packet2 = make_move_on_copy(std::move(packet));
+
 		executor_.begin_invoke([=]
 		{		
+			auto& packet = packet2.value;
+
 			try
 			{
 				mix_timer_.restart();
 
-				auto frames = packet.first;
-				
-				BOOST_FOREACH(auto& frame, frames)
+				auto trace = get_frame_trace(packet.second);
+
+				if(trace)
+					trace->stamp(frame_trace::mixer_begin);
+
+				BOOST_FOREACH(auto& frame, packet.first)
 				{
 					auto blend_it = blend_modes_.find(frame.first);
 					image_mixer_.begin_layer(blend_it != blend_modes_.end() ? blend_it->second : blend_mode::normal);
@@ -188,6 +217,9 @@ public:
 				graph_->set_value("mix-time", mix_time*format_desc_.fps*0.5);
 				current_mix_time_ = static_cast<int64_t>(mix_time * 1000.0);
 
+				if(trace)
+					trace->stamp(frame_trace::mixer_end);
+
 				target_->send(std::make_pair(make_safe<read_frame>(ogl_, format_desc_.size, std::move(image.get()), std::move(audio), audio_channel_layout_), packet.second));
 			}
 			catch(...)
@@ -361,7 +393,8 @@ mixer::mixer(
 		const channel_layout& audio_channel_layout,
 		int channel_index)
 	: impl_(new implementation(graph, target, format_desc, ogl, audio_channel_layout, channel_index)){}
-void mixer::send(const std::pair<std::map<int, safe_ptr<core::basic_frame>>, std::shared_ptr<void>>& frames){ impl_->send(frames);}
+void mixer::send(const std::pair<std::vector<std::pair<int, safe_ptr<core::basic_frame>>>, std::shared_ptr<void>>& frames){ impl_->send(std::pair<std::vector<std::pair<int, safe_ptr<core::basic_frame>>>, std::shared_ptr<void>>(frames));}
+void mixer::send(std::pair<std::vector<std::pair<int, safe_ptr<core::basic_frame>>>, std::shared_ptr<void>>&& frames){ impl_->send(std::move(frames));}
 safe_ptr<frame_factory> mixer::get_frame_factory(int layer_index) { return impl_->get_frame_factory(layer_index); }
 blend_mode::type mixer::get_blend_mode(int index) { return impl_->get_blend_mode(index); }
 void mixer::set_blend_mode(int index, blend_mode::type value){impl_->set_blend_mode(index, value);}
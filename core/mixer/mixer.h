@@ -49,7 +49,7 @@ struct frame_transform;
 struct pixel_format;
 struct channel_layout;
 
-class mixer : public target<std::pair<std::map<int, safe_ptr<core::basic_frame>>, std::shared_ptr<void>>>
+class mixer : public target<std::pair<std::vector<std::pair<int, safe_ptr<core::basic_frame>>>, std::shared_ptr<void>>>
 {
 public:	
 	typedef target<std::pair<safe_ptr<read_frame>, std::shared_ptr<void>>> target_t;
@@ -64,7 +64,8 @@ public:
 		
 	// target
 
-	virtual void send(const std::pair<std::map<int, safe_ptr<basic_frame>>, std::shared_ptr<void>>& frames) override; 
+	virtual void send(const std::pair<std::vector<std::pair<int, safe_ptr<basic_frame>>>, std::shared_ptr<void>>& frames) override; 
+	virtual void send(std::pair<std::vector<std::pair<int, safe_ptr<basic_frame>>>, std::shared_ptr<void>>&& frames) override; 
 		
 	// mixer
 
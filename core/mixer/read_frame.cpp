@@ -109,6 +109,7 @@ const boost::iterator_range<const int32_t*> read_frame::audio_data()
 	return impl_ ? impl_->audio_data() : boost::iterator_range<const int32_t*>();
 }
 
+std::shared_ptr<host_buffer> read_frame::image_buffer() const{return impl_ ? impl_->image_data_ : std::shared_ptr<host_buffer>();}
 size_t read_frame::image_size() const{return impl_ ? impl_->size_ : 0;}
 int read_frame::num_channels() const { return impl_ ? impl_->audio_channel_layout_.num_channels : 0; }
 const multichannel_view<const int32_t, boost::iterator_range<const int32_t*>::const_iterator> read_frame::multichannel_view() const
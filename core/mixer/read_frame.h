@@ -58,6 +58,10 @@ public:
 	virtual const multichannel_view<const int32_t, boost::iterator_range<const int32_t*>::const_iterator> multichannel_view() const;
 		
 private:
+	friend class write_frame;
+
+	std::shared_ptr<host_buffer> image_buffer() const;
+
 	struct implementation;
 	std::shared_ptr<implementation> impl_;
 };
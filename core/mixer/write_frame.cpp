@@ -22,11 +22,13 @@
 #include "../stdafx.h"
 
 #include "write_frame.h"
+#include "read_frame.h"
 
 #include "gpu/ogl_device.h"
 #include "gpu/host_buffer.h"
 #include "gpu/device_buffer.h"
 
+#include <core/producer/frame/dirty_region.h>
 #include <core/producer/frame/frame_visitor.h>
 #include <core/producer/frame/pixel_format.h>
 #include <core/mixer/audio/audio_util.h>
@@ -48,12 +50,15 @@ struct write_frame::implementation
 	const channel_layout						channel_layout_;
 	const void*									tag_;
 	core::field_mode::type						mode_;
+	std::vector<pixel_rect>						regions_;
+	bool										full_upload_;
 	boost::timer								since_created_timer_;
 	tbb::atomic<int64_t>						recorded_frame_age_;
 
 	implementation(const void* tag, const channel_layout& channel_layout)
 		: channel_layout_(channel_layout)
 		, tag_(tag)
+		, full_upload_(true)
 	{
 		recorded_frame_age_ = -1;
 	}
@@ -64,6 +69,7 @@ struct write_frame::implementation
 		, channel_layout_(channel_layout)
 		, tag_(tag)
 		, mode_(core::field_mode::progressive)
+		, full_upload_(true)
 	{
 		std::transform(desc.planes.begin(), desc.planes.end(), std::back_inserter(buffers_), [&](const core::pixel_format_desc::plane& plane)
 		{
@@ -76,6 +82,53 @@ struct write_frame::implementation
 
 		recorded_frame_age_ = -1;
 	}
+
+	implementation(const safe_ptr<ogl_device>& ogl, const void* tag, const safe_ptr<read_frame>& source, const core::pixel_format_desc& desc, bool mipmapping) 
+		: ogl_(ogl)
+		, desc_(desc)
+		, channel_layout_(source->multichannel_view().channel_layout())
+		, tag_(tag)
+		, mode_(core::field_mode::progressive)
+		, full_upload_(true)
+	{
+		textures_.push_back(ogl_->create_device_buffer(desc.planes.at(0).width, desc.planes.at(0).height, desc.planes.at(0).channels, mipmapping));
+
+		recorded_frame_age_ = -1;
+
+		// Upload straight from the read back buffer of the source. Holding on to
+		// the buffer keeps it out of its pool until the upload has been queued.
+		auto buffer		= source->image_buffer();
+		auto texture	= textures_.at(0);
+
+		if(!buffer || buffer->size() != desc.planes.at(0).size)
+			BOOST_THROW_EXCEPTION(invalid_argument() << msg_info("Source frame does not match the pixel format."));
+
+		ogl_->begin_invoke([=]
+		{
+			buffer->upload(*texture);
+		}, high_priority);
+	}
+
+	implementation(const safe_ptr<ogl_device>& ogl, const void* tag, const write_frame& previous, const std::vector<pixel_rect>& regions) 
+		: ogl_(ogl)
+		, desc_(previous.get_pixel_format_desc())
+		, channel_layout_(previous.get_channel_layout())
+		, tag_(tag)
+		, mode_(core::field_mode::progressive)
+		, regions_(regions)
+		, full_upload_(false)
+	{
+		if(desc_.planes.size() != 1 || previous.get_textures().size() != 1)
+			BOOST_THROW_EXCEPTION(invalid_argument() << msg_info("Partial updates require a frame with a single plane."));
+
+		// Only the regions are written and uploaded, the rest of the texture
+		// keeps the image of the previous frame. Without any regions nothing
+		// is uploaded at all.
+		buffers_.push_back(ogl_->create_host_buffer(desc_.planes.at(0).size, host_buffer::write_only));
+		textures_ = previous.get_textures();
+
+		recorded_frame_age_ = -1;
+	}
 			
 	void accept(write_frame& self, core::frame_visitor& visitor)
 	{
@@ -117,13 +170,21 @@ struct write_frame::implementation
 		if(!buffer)
 			return;
 
+		if(!full_upload_ && regions_.empty())
+			return;
+
 		auto texture = textures_.at(plane_index);
+		auto regions = regions_;
+		auto full_upload = full_upload_;
 		
 		ogl_->begin_invoke([=]
 		{			
 			buffer->unmap();
 			buffer->bind();
-			texture->begin_read();
+			if(full_upload)
+				texture->begin_read();
+			else
+				texture->begin_read(regions);
 			buffer->unbind();
 		}, high_priority);
 	}
@@ -142,6 +203,23 @@ write_frame::write_frame(
 	: impl_(new implementation(ogl, tag, desc, channel_layout, mipmapping))
 {
 }
+write_frame::write_frame(
+		const safe_ptr<ogl_device>& ogl,
+		const void* tag,
+		const safe_ptr<read_frame>& source,
+		const core::pixel_format_desc& desc,
+		bool mipmapping)
+	: impl_(new implementation(ogl, tag, source, desc, mipmapping))
+{
+}
+write_frame::write_frame(
+		const safe_ptr<ogl_device>& ogl,
+		const void* tag,
+		const safe_ptr<write_frame>& previous,
+		const std::vector<pixel_rect>& regions)
+	: impl_(new implementation(ogl, tag, *previous, regions))
+{
+}
 write_frame::write_frame(const write_frame& other) : impl_(new implementation(*other.impl_)){}
 write_frame::write_frame(write_frame&& other) : impl_(std::move(other.impl_)){}
 write_frame& write_frame::operator=(const write_frame& other)
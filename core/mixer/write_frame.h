@@ -37,6 +37,8 @@
 namespace caspar { namespace core {
 
 class device_buffer;
+class read_frame;
+struct pixel_rect;
 struct frame_visitor;
 struct pixel_format_desc;
 class ogl_device;	
@@ -46,6 +48,8 @@ class write_frame : public core::basic_frame, boost::noncopyable
 public:	
 	explicit write_frame(const void* tag, const channel_layout& channel_layout);
 	explicit write_frame(const safe_ptr<ogl_device>& ogl, const void* tag, const core::pixel_format_desc& desc, const channel_layout& channel_layout, bool mipmapping);
+	explicit write_frame(const safe_ptr<ogl_device>& ogl, const void* tag, const safe_ptr<read_frame>& source, const core::pixel_format_desc& desc, bool mipmapping);
+	explicit write_frame(const safe_ptr<ogl_device>& ogl, const void* tag, const safe_ptr<write_frame>& previous, const std::vector<pixel_rect>& regions);
 
 	write_frame(const write_frame& other);
 	write_frame(write_frame&& other);
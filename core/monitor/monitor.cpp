@@ -22,8 +22,462 @@
 
 #include "monitor.h"
 
+#include <tbb/concurrent_unordered_map.h>
+#include <tbb/spin_mutex.h>
+#include <tbb/spin_rw_mutex.h>
+
+#include <boost/foreach.hpp>
+#include <boost/thread/once.hpp>
+
+#include <algorithm>
+#include <map>
+#include <memory>
+
 namespace caspar { namespace core { namespace monitor {
 
+namespace {
+
+class path_table : boost::noncopyable
+{
+	typedef std::pair<const detail::path_entry*, const detail::path_entry*> concatenation;
+
+	struct concatenation_hash
+	{
+		std::size_t operator()(const concatenation& key) const
+		{
+			auto prefix = reinterpret_cast<std::size_t>(key.first);
+			auto suffix = reinterpret_cast<std::size_t>(key.second);
+
+			return prefix ^ (suffix + 0x9e3779b9 + (prefix << 6) + (prefix >> 2));
+		}
+	};
+
+	// Unreferenced entries are only removed once the table holds at least
+	// this many, and then again when it has doubled since the last sweep.
+	enum { MIN_SWEEP_SIZE = 4096 };
+
+	// Lookups and inserts share the lock, sweeps take it exclusively. An
+	// entry's reference count only goes up from zero under the shared lock,
+	// so a sweep never removes an entry that is being handed out.
+	tbb::spin_rw_mutex																		mutex_;
+	tbb::concurrent_unordered_map<std::string, detail::path_entry*>							entries_;
+	tbb::concurrent_unordered_map<concatenation, detail::path_entry*, concatenation_hash>	concatenations_;
+	tbb::atomic<std::size_t>																sweep_size_;
+	detail::path_entry*																		empty_;
+public:
+	path_table()
+	{
+		sweep_size_ = MIN_SWEEP_SIZE;
+		empty_ = intern(""); // Keeps its reference, the empty path is never removed.
+	}
+
+	// The returned entry has been referenced on behalf of the caller.
+	detail::path_entry* empty()
+	{
+		++empty_->ref_count;
+
+		return empty_;
+	}
+
+	detail::path_entry* intern(const std::string& path)
+	{
+		detail::path_entry* entry;
+
+		{
+			tbb::spin_rw_mutex::scoped_lock lock(mutex_, false);
+
+			entry = intern_shared(path);
+		}
+
+		sweep_if_grown();
+
+		return entry;
+	}
+
+	detail::path_entry* concatenate(detail::path_entry* prefix, detail::path_entry* suffix)
+	{
+		if (prefix->str.empty() || suffix->str.empty())
+		{
+			auto entry = prefix->str.empty() ? suffix : prefix;
+			++entry->ref_count;
+
+			return entry;
+		}
+
+		detail::path_entry* entry;
+
+		{
+			tbb::spin_rw_mutex::scoped_lock lock(mutex_, false);
+
+			auto key = concatenation(prefix, suffix);
+			auto it = concatenations_.find(key);
+
+			if (it != concatenations_.end())
+			{
+				entry = it->second;
+				++entry->ref_count;
+			}
+			else
+			{
+				entry = intern_shared(prefix->str + suffix->str);
+				concatenations_.insert(std::make_pair(key, entry));
+			}
+		}
+
+		sweep_if_grown();
+
+		return entry;
+	}
+private:
+	// Requires the shared lock.
+	detail::path_entry* intern_shared(const std::string& path)
+	{
+		auto it = entries_.find(path);
+
+		if (it == entries_.end())
+		{
+			std::unique_ptr<detail::path_entry> entry(new detail::path_entry(path));
+			auto result = entries_.insert(std::make_pair(path, entry.get()));
+
+			if (result.second)
+				entry.release();
+
+			it = result.first;
+		}
+
+		++it->second->ref_count;
+
+		return it->second;
+	}
+
+	void sweep_if_grown()
+	{
+		if (entries_.size() < sweep_size_)
+			return;
+
+		tbb::spin_rw_mutex::scoped_lock lock(mutex_, true);
+
+		if (entries_.size() < sweep_size_)
+			return;
+
+		// The cache refers to entries without referencing them.
+		concatenations_.clear();
+
+		for (auto it = entries_.begin(); it != entries_.end();)
+		{
+			if (it->second->ref_count == 0)
+			{
+				delete it->second;
+				it = entries_.unsafe_erase(it);
+			}
+			else
+				++it;
+		}
+
+		sweep_size_ = std::max<std::size_t>(MIN_SWEEP_SIZE, entries_.size() * 2);
+	}
+};
+
+// Created on first use, so that paths can be interned from other static
+// initializers. Function local statics are not thread safe with this
+// compiler, so the table is created through call_once on a constant
+// initialized flag. It is never destroyed since paths may still be released
+// during static destruction.
+path_table& get_path_table()
+{
+	static boost::once_flag	table_created = BOOST_ONCE_INIT;
+	static path_table*		table;
+
+	boost::call_once(table_created, []
+	{
+		table = new path_table();
+	});
+
+	return *table;
+}
+
+class message_data_pool : boost::noncopyable
+{
+	// Upper bound of recycled blocks, anything beyond is returned to the heap
+	// so that a burst of messages does not pin memory forever.
+	enum { MAX_FREE = 4096 };
+
+	tbb::spin_mutex			mutex_;
+	detail::message_data*	free_;
+	std::size_t				num_free_;
+public:
+	message_data_pool()
+		: free_(nullptr)
+		, num_free_(0)
+	{
+	}
+
+	~message_data_pool()
+	{
+		while (free_)
+		{
+			auto data = free_;
+			free_ = data->next_free;
+			delete data;
+		}
+	}
+
+	detail::message_data* allocate()
+	{
+		detail::message_data* data = nullptr;
+
+		{
+			tbb::spin_mutex::scoped_lock lock(mutex_);
+
+			if (free_)
+			{
+				data = free_;
+				free_ = data->next_free;
+				--num_free_;
+			}
+		}
+
+		if (!data)
+			data = new detail::message_data();
+
+		data->ref_count = 0;
+		data->size = 0;
+		data->next_free = nullptr;
+
+		return data;
+	}
+
+	void release(detail::message_data* data)
+	{
+		// Destroy string and blob arguments now rather than when the block is
+		// handed out again.
+		for (std::size_t n = 0; n < std::min<std::size_t>(data->size, detail::message_data::MAX_ARGS); ++n)
+			data->args[n] = false;
+
+		data->size = 0;
+		data->overflow.clear();
+
+		{
+			tbb::spin_mutex::scoped_lock lock(mutex_);
+
+			if (num_free_ < MAX_FREE)
+			{
+				data->next_free = free_;
+				free_ = data;
+				++num_free_;
+				return;
+			}
+		}
+
+		delete data;
+	}
+};
+
+message_data_pool g_message_data_pool;
+
+}
+
+interned_path::interned_path()
+	: entry_(get_path_table().empty())
+{
+}
+
+interned_path::interned_path(const std::string& path)
+	: entry_(get_path_table().intern(path))
+{
+}
+
+interned_path::interned_path(const char* path)
+	: entry_(get_path_table().intern(path))
+{
+}
+
+interned_path interned_path::operator+(const interned_path& suffix) const
+{
+	return interned_path(get_path_table().concatenate(entry_, suffix.entry_));
+}
+
+namespace {
+
+tbb::atomic<int>& generation()
+{
+	static tbb::atomic<int> value;
+
+	return value;
+}
+
+// Returns the segment starting at begin, excluding the leading '/'.
+std::pair<const char*, const char*> next_segment(const char* begin, const char* end)
+{
+	if (begin != end && *begin == '/')
+		++begin;
+
+	return std::make_pair(begin, std::find(begin, end, '/'));
+}
+
+bool is_compatible(const std::vector<std::string>& pattern, const std::string& path)
+{
+	auto it = path.c_str();
+	auto end = it + path.size();
+
+	BOOST_FOREACH(auto& pattern_segment, pattern)
+	{
+		if (it == end)
+			return true;
+
+		auto segment = next_segment(it, end);
+
+		if (pattern_segment != "*" && 
+			(static_cast<std::size_t>(segment.second - segment.first) != pattern_segment.size() ||
+			 !std::equal(segment.first, segment.second, pattern_segment.begin())))
+			return false;
+
+		it = segment.second;
+	}
+
+	return true;
+}
+
+}
+
+int subscription_generation()
+{
+	return generation();
+}
+
+void invalidate_subscriptions()
+{
+	++generation();
+}
+
+struct path_filter::impl
+{
+	typedef std::map<std::string, std::pair<std::vector<std::string>, int>> pattern_map;
+
+	mutable tbb::spin_mutex	mutex;
+	pattern_map				patterns;
+};
+
+path_filter::path_filter()
+	: impl_(new impl())
+{
+}
+
+void path_filter::subscribe(const std::string& pattern)
+{
+	{
+		tbb::spin_mutex::scoped_lock lock(impl_->mutex);
+
+		auto& entry = impl_->patterns[pattern];
+
+		if (entry.second++ == 0)
+		{
+			auto end = pattern.c_str() + pattern.size();
+
+			for (auto it = pattern.c_str(); it != end;)
+			{
+				auto segment = next_segment(it, end);
+
+				if (segment.first != segment.second)
+					entry.first.push_back(std::string(segment.first, segment.second));
+
+				it = segment.second;
+			}
+		}
+	}
+
+	invalidate_subscriptions();
+}
+
+void path_filter::unsubscribe(const std::string& pattern)
+{
+	{
+		tbb::spin_mutex::scoped_lock lock(impl_->mutex);
+
+		auto it = impl_->patterns.find(pattern);
+
+		if (it == impl_->patterns.end())
+			return;
+
+		if (--it->second.second == 0)
+			impl_->patterns.erase(it);
+	}
+
+	invalidate_subscriptions();
+}
+
+bool path_filter::matches(const interned_path& path) const
+{
+	tbb::spin_mutex::scoped_lock lock(impl_->mutex);
+
+	BOOST_FOREACH(auto& pattern, impl_->patterns)
+	{
+		if (is_compatible(pattern.second.first, path.str()))
+			return true;
+	}
+
+	return false;
+}
+
+bool path_filter::empty() const
+{
+	tbb::spin_mutex::scoped_lock lock(impl_->mutex);
+
+	return impl_->patterns.empty();
+}
+
+bool subject::is_subscribed(const interned_path& path)
+{
+	const int current_generation = generation();
+
+	{
+		tbb::spin_mutex::scoped_lock lock(cache_mutex_);
+
+		BOOST_FOREACH(auto& entry, cache_)
+		{
+			if (entry.path == path && entry.generation == current_generation)
+				return entry.subscribed;
+		}
+	}
+
+	auto parent = parent_.lock();
+	bool subscribed = parent && parent->is_subscribed(path_ + path);
+
+	tbb::spin_mutex::scoped_lock lock(cache_mutex_);
+
+	auto it = std::find_if(cache_.begin(), cache_.end(), [&](const cached_subscription& entry)
+	{
+		return entry.path == path;
+	});
+
+	if (it == cache_.end())
+	{
+		cached_subscription entry = { path, current_generation, subscribed };
+		cache_.push_back(entry);
+	}
+	else
+	{
+		it->generation = current_generation;
+		it->subscribed = subscribed;
+	}
+
+	return subscribed;
+}
+
+namespace detail {
+
+message_data* allocate_message_data()
+{
+	return g_message_data_pool.allocate();
+}
+
+void release_message_data(message_data* data)
+{
+	g_message_data_pool.release(data);
+}
+
+}
+
 /*class in_callers_thread_schedule_group : public Concurrency::ScheduleGroup
 {
 	virtual void ScheduleTask(Concurrency::TaskProc proc, void* data) override
@@ -23,9 +23,16 @@
 #include <common/memory/safe_ptr.h>
 #include <common/utility/assert.h>
 
+#include <boost/array.hpp>
+#include <boost/intrusive_ptr.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/range/iterator_range.hpp>
 #include <boost/variant.hpp>
 #include <boost/chrono/duration.hpp>
 
+#include <tbb/atomic.h>
+#include <tbb/spin_mutex.h>
+
 #include <cstdint>
 #include <string>
 #include <vector>
@@ -41,35 +48,162 @@ typedef boost::variant<bool,
 					   std::wstring,
 					   std::vector<std::int8_t>> data_t;
 
+namespace detail {
+
+// An entry of the process wide path table. Entries nobody refers to are
+// removed once the table has grown past its sweep threshold.
+struct path_entry : boost::noncopyable
+{
+	const std::string	str;
+	tbb::atomic<int>	ref_count;
+
+	explicit path_entry(const std::string& str)
+		: str(str)
+	{
+		ref_count = 0;
+	}
+};
+
+}
+
+// A path stored once for as long as it is referenced. Copying is a reference
+// count increment, comparing is a pointer operation and concatenation is a
+// table lookup once a given prefix/suffix combination has been seen, so
+// propagating a message up the subject tree does not allocate in steady
+// state.
+class interned_path
+{
+public:
+	interned_path(); // The empty path.
+	interned_path(const std::string& path);
+	interned_path(const char* path);
+
+	interned_path(const interned_path& other)
+		: entry_(other.entry_)
+	{
+		++entry_->ref_count;
+	}
+
+	~interned_path()
+	{
+		--entry_->ref_count;
+	}
+
+	interned_path& operator=(const interned_path& other)
+	{
+		++other.entry_->ref_count;
+		--entry_->ref_count;
+		entry_ = other.entry_;
+
+		return *this;
+	}
+
+	const std::string& str() const
+	{
+		return entry_->str;
+	}
+
+	bool empty() const
+	{
+		return entry_->str.empty();
+	}
+
+	interned_path operator+(const interned_path& suffix) const;
+
+	bool operator==(const interned_path& other) const
+	{
+		return entry_ == other.entry_;
+	}
+
+	bool operator!=(const interned_path& other) const
+	{
+		return entry_ != other.entry_;
+	}
+private:
+	// Takes over a reference that the path table has already counted.
+	explicit interned_path(detail::path_entry* entry)
+		: entry_(entry)
+	{
+	}
+
+	detail::path_entry* entry_;
+};
+
+namespace detail {
+
+// Argument storage shared by all the propagated copies of a message. Blocks
+// are recycled through a process wide free list instead of the heap. The
+// rare message with more than MAX_ARGS arguments keeps all of them in
+// overflow instead.
+struct message_data : boost::noncopyable
+{
+	enum { MAX_ARGS = 8 };
+
+	tbb::atomic<int>					ref_count;
+	std::size_t							size;
+	boost::array<data_t, MAX_ARGS>		args;
+	std::vector<data_t>					overflow;
+	message_data*						next_free;
+};
+
+message_data* allocate_message_data();
+void release_message_data(message_data* data);
+
+inline void intrusive_ptr_add_ref(message_data* data)
+{
+	++data->ref_count;
+}
+
+inline void intrusive_ptr_release(message_data* data)
+{
+	if (--data->ref_count == 0)
+		release_message_data(data);
+}
+
+}
+
 class message
 {
 public:
 
-	message(std::string path, std::vector<data_t> data = std::vector<data_t>())
-		: path_(std::move(path))
-		, data_ptr_(std::make_shared<std::vector<data_t>>(std::move(data)))
+	message(const interned_path& path)
+		: path_(path)
+		, data_ptr_(detail::allocate_message_data())
 	{
-		CASPAR_ASSERT(path.empty() || path[0] == '/');
+		CASPAR_ASSERT(path.empty() || path.str()[0] == '/');
 	}
-	
-	message(std::string path, safe_ptr<std::vector<data_t>> data_ptr)
-		: path_(std::move(path))
-		, data_ptr_(std::move(data_ptr))
+
+	message(const std::string& path)
+		: path_(path)
+		, data_ptr_(detail::allocate_message_data())
 	{
 		CASPAR_ASSERT(path.empty() || path[0] == '/');
 	}
 
+	message(const char* path)
+		: path_(path)
+		, data_ptr_(detail::allocate_message_data())
+	{
+		CASPAR_ASSERT(path_.empty() || path_.str()[0] == '/');
+	}
+
 	const std::string& path() const
+	{
+		return path_.str();
+	}
+
+	const interned_path& interned() const
 	{
 		return path_;
 	}
 
-	const std::vector<data_t>& data() const
+	boost::iterator_range<const data_t*> data() const
 	{
-		return *data_ptr_;
+		auto begin = data_ptr_->size > detail::message_data::MAX_ARGS ? data_ptr_->overflow.data() : data_ptr_->args.data();
+		return boost::iterator_range<const data_t*>(begin, begin + data_ptr_->size);
 	}
 
-	message propagate(const std::string& path) const
+	message propagate(const interned_path& path) const
 	{
 		return message(path + path_, data_ptr_);
 	}
@@ -77,13 +211,59 @@ public:
 	template<typename T>
 	message& operator%(T&& data)
 	{
-		data_ptr_->push_back(std::forward<T>(data));
+		auto& block = *data_ptr_;
+
+		if (block.size < detail::message_data::MAX_ARGS)
+			block.args[block.size] = std::forward<T>(data);
+		else
+		{
+			if (block.size == detail::message_data::MAX_ARGS)
+				block.overflow.assign(block.args.begin(), block.args.end());
+
+			block.overflow.push_back(std::forward<T>(data));
+		}
+
+		++block.size;
+
 		return *this;
 	}
 
 private:
-	std::string						path_;
-	safe_ptr<std::vector<data_t>>	data_ptr_;
+	message(const interned_path& path, const boost::intrusive_ptr<detail::message_data>& data_ptr)
+		: path_(path)
+		, data_ptr_(data_ptr)
+	{
+	}
+
+	interned_path								path_;
+	boost::intrusive_ptr<detail::message_data>	data_ptr_;
+};
+
+// Bumped whenever the subject tree is rewired or a sink changes what it
+// subscribes to. Cached subscription lookups older than the current
+// generation are recalculated.
+int subscription_generation();
+void invalidate_subscriptions();
+
+// Reference counted set of path patterns. A pattern is a path where a "*"
+// segment matches any single segment, for example "/channel/*/stage/layer/10".
+// A path matches when it is compatible with a pattern for as many segments as
+// both of them have, so a pattern subscribes to the whole subtree below it and
+// every ancestor of the pattern is reported as subscribed as well. The empty
+// pattern and "/" match everything.
+class path_filter : boost::noncopyable
+{
+public:
+	path_filter();
+
+	void subscribe(const std::string& pattern);
+	void unsubscribe(const std::string& pattern);
+
+	bool matches(const interned_path& path) const;
+	bool empty() const;
+private:
+	struct impl;
+	safe_ptr<impl> impl_;
 };
 
 struct sink
@@ -91,16 +271,32 @@ struct sink
 	virtual ~sink() { }
 
 	virtual void propagate(const message& msg) = 0;
+
+	// Whether anything listens to messages at the given path, relative to
+	// this sink. Used to avoid building messages nobody will receive.
+	virtual bool is_subscribed(const interned_path& path)
+	{
+		return true;
+	}
 };
 
 class subject : public sink
 {
 private:
-	std::weak_ptr<sink> parent_;
-	const std::string path_;
+	struct cached_subscription
+	{
+		interned_path	path;
+		int				generation;
+		bool			subscribed;
+	};
+
+	std::weak_ptr<sink>					parent_;
+	const interned_path					path_;
+	tbb::spin_mutex						cache_mutex_;
+	std::vector<cached_subscription>	cache_;
 public:
-	subject(std::string path = "")
-		: path_(std::move(path))
+	subject(const std::string& path = "")
+		: path_(path)
 	{
 		CASPAR_ASSERT(path.empty() || path[0] == '/');
 	}
@@ -108,13 +304,20 @@ public:
 	void attach_parent(const safe_ptr<sink>& parent)
 	{
 		parent_ = parent;
+		invalidate_subscriptions();
 	}
 
 	void detach_parent()
 	{
 		parent_.reset();
+		invalidate_subscriptions();
 	}
 
+	// Producers should check this before building messages that are costly
+	// to produce or emitted every frame. A subject without a parent is never
+	// subscribed.
+	virtual bool is_subscribed(const interned_path& path) override;
+
 	subject& operator<<(const message& msg)
 	{
 		propagate(msg);
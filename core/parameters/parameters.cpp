@@ -46,7 +46,7 @@ void parameters::to_upper()
 {
 	for(size_t n = 0; n < params_.size(); ++n)
 	{
-		params_[n] = boost::to_upper_copy(params_[n]);
+		boost::to_upper(params_[n]);
 	}
 }
 
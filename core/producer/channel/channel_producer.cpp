@@ -36,7 +36,6 @@
 #include <boost/thread/once.hpp>
 
 #include <common/exception/exceptions.h>
-#include <common/memory/memcpy.h>
 #include <common/concurrency/future_util.h>
 
 #include <tbb/concurrent_queue.h>
@@ -217,7 +216,7 @@ public:
 		}
 		
 		auto read_frame = consumer_->receive();
-		if(!read_frame || read_frame->image_data().empty())
+		if(!read_frame || read_frame->image_size() == 0)
 			return basic_frame::late();		
 
 		frame_number_++;
@@ -231,19 +230,18 @@ public:
 
 		desc.pix_fmt = core::pixel_format::bgra;
 		desc.planes.push_back(core::pixel_format_desc::plane(format_desc.width, format_desc.height, 4));
-		auto frame = frame_factory_->create_frame(this, desc, read_frame->multichannel_view().channel_layout());
+		// The image is uploaded straight from the source channel's read back
+		// buffer, which is never touched by the CPU unless a consumer maps it.
+		auto frame = frame_factory_->create_frame(this, make_safe_ptr(read_frame), desc);
 
 		bool copy_audio = !double_speed && !half_speed;
 
 		if (copy_audio)
 		{
-			frame->audio_data().reserve(read_frame->audio_data().size());
-			boost::copy(read_frame->audio_data(), std::back_inserter(frame->audio_data()));
+			auto audio = read_frame->audio_data();
+			frame->audio_data().assign(audio.begin(), audio.end());
 		}
 
-		fast_memcpy(frame->image_data().begin(), read_frame->image_data().begin(), read_frame->image_data().size());
-		frame->commit();
-
 		frame_buffer_.push(frame);	
 		
 		if(double_speed)	
@@ -56,7 +56,8 @@ public:
 			
 	virtual safe_ptr<basic_frame> receive(int) override
 	{
-		monitor_subject_ << monitor::message("/color") % color_str_;
+		if (monitor_subject_.is_subscribed("/color"))
+			monitor_subject_ << monitor::message("/color") % color_str_;
 
 		return frame_;
 	}	
@@ -30,36 +30,81 @@
 
 namespace caspar { namespace core {
 																																						
+namespace {
+
+bool is_concrete_frame(const basic_frame& frame)
+{
+	return &frame != basic_frame::empty().get() && &frame != basic_frame::eof().get() && &frame != basic_frame::late().get();
+}
+
+}
+																																						
 struct basic_frame::implementation
 {		
-	std::vector<safe_ptr<basic_frame>> frames_;
+	// Almost every frame wraps one or two others (layers, fields, fill and
+	// key, transitions), those are kept inline so that building the frame
+	// tree of a tick only allocates lists for frames with more children.
+	std::shared_ptr<basic_frame>		first_;
+	std::shared_ptr<basic_frame>		second_;
+	std::vector<safe_ptr<basic_frame>>	frames_;
 
 	frame_transform frame_transform_;	
 public:
-	implementation(const std::vector<safe_ptr<basic_frame>>& frames) : frames_(frames) 
+	implementation()
 	{
 	}
-	implementation(std::vector<safe_ptr<basic_frame>>&& frames) : frames_(std::move(frames))
+	implementation(const std::vector<safe_ptr<basic_frame>>& frames)
 	{
+		if(frames.size() > 2)
+			std::vector<safe_ptr<basic_frame>>(frames).swap(frames_);
+		else
+			assign(frames);
 	}
-	implementation(safe_ptr<basic_frame>&& frame) 
+	implementation(std::vector<safe_ptr<basic_frame>>&& frames)
 	{
-		frames_.push_back(std::move(frame));
+		if(frames.size() > 2)
+			frames_.swap(frames);
+		else
+			assign(frames);
+	}
+	implementation(const safe_ptr<basic_frame>& frame) 
+		: first_(frame)
+	{ 
 	}
-	implementation(const safe_ptr<basic_frame>& frame) 		
+	implementation(const safe_ptr<basic_frame>& frame1, const safe_ptr<basic_frame>& frame2) 
+		: first_(frame1)
+		, second_(frame2)
 	{ 
-		frames_.push_back(frame);
+	}
+
+	void assign(const std::vector<safe_ptr<basic_frame>>& frames)
+	{
+		if(frames.size() > 0)
+			first_ = frames[0];
+		if(frames.size() > 1)
+			second_ = frames[1];
+	}
+
+	template<typename F>
+	void for_each_frame(const F& func)
+	{
+		if(first_)
+			func(*first_);
+		if(second_)
+			func(*second_);
+		BOOST_FOREACH(auto& frame, frames_)
+			func(*frame);
 	}
 
 	int64_t get_and_record_age_millis(const basic_frame& self)
 	{
 		int64_t result = 0;
 
-		BOOST_FOREACH(auto& frame, frames_)
+		for_each_frame([&](basic_frame& frame)
 		{
-			if (is_concrete_frame(frame) && frame.get() != &self)
-				result = std::max(result, frame->get_and_record_age_millis());
-		}
+			if (is_concrete_frame(frame) && &frame != &self)
+				result = std::max(result, frame.get_and_record_age_millis());
+		});
 
 		return result;
 	}
@@ -67,18 +112,21 @@ public:
 	void accept(basic_frame& self, frame_visitor& visitor)
 	{
 		visitor.begin(self);
-		BOOST_FOREACH(auto frame, frames_)
-			frame->accept(visitor);
+		for_each_frame([&](basic_frame& frame)
+		{
+			frame.accept(visitor);
+		});
 		visitor.end();
 	}	
 };
 	
-basic_frame::basic_frame() : impl_(new implementation(std::vector<safe_ptr<basic_frame>>())){}
-basic_frame::basic_frame(const std::vector<safe_ptr<basic_frame>>& frames) : impl_(new implementation(frames)){}
-basic_frame::basic_frame(const basic_frame& other) : impl_(new implementation(*other.impl_)){}
-basic_frame::basic_frame(std::vector<safe_ptr<basic_frame>>&& frames) : impl_(new implementation(frames)){}
-basic_frame::basic_frame(const safe_ptr<basic_frame>& frame) : impl_(new implementation(frame)){}
-basic_frame::basic_frame(safe_ptr<basic_frame>&& frame)  : impl_(new implementation(std::move(frame))){}
+basic_frame::basic_frame() : impl_(make_safe<implementation>()){}
+basic_frame::basic_frame(const std::vector<safe_ptr<basic_frame>>& frames) : impl_(make_safe<implementation>(frames)){}
+basic_frame::basic_frame(const basic_frame& other) : impl_(make_safe<implementation>(*other.impl_)){}
+basic_frame::basic_frame(std::vector<safe_ptr<basic_frame>>&& frames) : impl_(make_safe<implementation>(std::move(frames))){}
+basic_frame::basic_frame(const safe_ptr<basic_frame>& frame) : impl_(make_safe<implementation>(frame)){}
+basic_frame::basic_frame(safe_ptr<basic_frame>&& frame)  : impl_(make_safe<implementation>(frame)){}
+basic_frame::basic_frame(const safe_ptr<basic_frame>& frame1, const safe_ptr<basic_frame>& frame2) : impl_(make_safe<implementation>(frame1, frame2)){}
 basic_frame::basic_frame(basic_frame&& other) : impl_(std::move(other.impl_)){}
 basic_frame& basic_frame::operator=(const basic_frame& other)
 {
@@ -123,10 +171,7 @@ safe_ptr<basic_frame> basic_frame::interlace(const safe_ptr<basic_frame>& frame1
 		my_frame2->get_frame_transform().field_mode = field_mode::upper;	
 	}
 
-	std::vector<safe_ptr<basic_frame>> frames;
-	frames.push_back(my_frame1);
-	frames.push_back(my_frame2);
-	return make_safe<basic_frame>(std::move(frames));
+	return make_safe<basic_frame>(my_frame1, my_frame2);
 }
 
 safe_ptr<basic_frame> basic_frame::combine(const safe_ptr<basic_frame>& frame1, const safe_ptr<basic_frame>& frame2)
@@ -137,10 +182,7 @@ safe_ptr<basic_frame> basic_frame::combine(const safe_ptr<basic_frame>& frame1,
 	if(frame1 == basic_frame::empty() && frame2 == basic_frame::empty())
 		return basic_frame::empty();
 
-	std::vector<safe_ptr<basic_frame>> frames;
-	frames.push_back(frame1);
-	frames.push_back(frame2);
-	return make_safe<basic_frame>(std::move(frames));
+	return make_safe<basic_frame>(frame1, frame2);
 }
 
 safe_ptr<basic_frame> basic_frame::fill_and_key(const safe_ptr<basic_frame>& fill, const safe_ptr<basic_frame>& key)
@@ -151,11 +193,8 @@ safe_ptr<basic_frame> basic_frame::fill_and_key(const safe_ptr<basic_frame>& fil
 	if(fill == basic_frame::empty() || key == basic_frame::empty())
 		return basic_frame::empty();
 
-	std::vector<safe_ptr<basic_frame>> frames;
 	key->get_frame_transform().is_key = true;
-	frames.push_back(key);
-	frames.push_back(fill);
-	return make_safe<basic_frame>(std::move(frames));
+	return make_safe<basic_frame>(key, fill);
 }
 
 safe_ptr<basic_frame> disable_audio(const safe_ptr<basic_frame>& frame)
@@ -163,9 +202,9 @@ safe_ptr<basic_frame> disable_audio(const safe_ptr<basic_frame>& frame)
 	if(frame == basic_frame::empty())
 		return frame;
 
-	basic_frame frame2 = frame;
-	frame2.get_frame_transform().volume = 0.0;
-	return make_safe<basic_frame>(std::move(frame2));
+	auto frame2 = make_safe<basic_frame>(frame);
+	frame2->get_frame_transform().volume = 0.0;
+	return frame2;
 }
 	
 }}
\ No newline at end of file
@@ -45,6 +45,7 @@ public:
 
 	basic_frame(const safe_ptr<basic_frame>& frame);
 	basic_frame(safe_ptr<basic_frame>&& frame);
+	basic_frame(const safe_ptr<basic_frame>& frame1, const safe_ptr<basic_frame>& frame2);
 	basic_frame(const std::vector<safe_ptr<basic_frame>>& frames);
 	basic_frame(std::vector<safe_ptr<basic_frame>>&& frames);
 
@@ -0,0 +1,149 @@
+/*
+* Copyright 2026 Sveriges Television AB http://casparcg.com/
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../../stdafx.h"
+
+#include "dirty_region.h"
+
+#include <boost/foreach.hpp>
+
+#include <algorithm>
+
+namespace caspar { namespace core {
+
+namespace {
+
+// Roughly what one extra upload call costs, counted in pixels.
+const int64_t	merge_slack		= 64 * 64;
+const size_t	max_rects		= 16;
+
+pixel_rect intersection(const pixel_rect& lhs, const pixel_rect& rhs)
+{
+	const int left		= std::max(lhs.x, rhs.x);
+	const int top		= std::max(lhs.y, rhs.y);
+	const int right		= std::min(lhs.x + lhs.width, rhs.x + rhs.width);
+	const int bottom	= std::min(lhs.y + lhs.height, rhs.y + rhs.height);
+
+	return pixel_rect(left, top, std::max(0, right - left), std::max(0, bottom - top));
+}
+
+pixel_rect bounding_box(const pixel_rect& lhs, const pixel_rect& rhs)
+{
+	const int left		= std::min(lhs.x, rhs.x);
+	const int top		= std::min(lhs.y, rhs.y);
+	const int right		= std::max(lhs.x + lhs.width, rhs.x + rhs.width);
+	const int bottom	= std::max(lhs.y + lhs.height, rhs.y + rhs.height);
+
+	return pixel_rect(left, top, right - left, bottom - top);
+}
+
+}
+
+bool operator==(const pixel_rect& lhs, const pixel_rect& rhs)
+{
+	return lhs.x == rhs.x && lhs.y == rhs.y && lhs.width == rhs.width && lhs.height == rhs.height;
+}
+
+bool operator!=(const pixel_rect& lhs, const pixel_rect& rhs)
+{
+	return !(lhs == rhs);
+}
+
+dirty_region::dirty_region(int width, int height)
+	: bounds_(0, 0, width, height)
+{
+}
+
+void dirty_region::add(const pixel_rect& rect)
+{
+	auto dirty = intersection(rect, bounds_);
+
+	if (dirty.empty() || full())
+		return;
+
+	for (bool merged = true; merged;)
+	{
+		merged = false;
+
+		for (auto it = rects_.begin(); it != rects_.end(); ++it)
+		{
+			auto combined = bounding_box(dirty, *it);
+
+			if (combined.area() <= dirty.area() + it->area() + merge_slack)
+			{
+				dirty = combined;
+				rects_.erase(it);
+				merged = true;
+				break;
+			}
+		}
+	}
+
+	rects_.push_back(dirty);
+
+	if (rects_.size() > max_rects)
+	{
+		auto all = rects_.front();
+
+		for (auto it = rects_.begin() + 1; it != rects_.end(); ++it)
+			all = bounding_box(all, *it);
+
+		rects_.assign(1, all);
+	}
+
+	if (area() * 4 >= bounds_.area() * 3)
+		add_all();
+}
+
+void dirty_region::add_all()
+{
+	rects_.assign(1, bounds_);
+}
+
+void dirty_region::clear()
+{
+	rects_.clear();
+}
+
+const std::vector<pixel_rect>& dirty_region::rects() const
+{
+	return rects_;
+}
+
+bool dirty_region::empty() const
+{
+	return rects_.empty();
+}
+
+bool dirty_region::full() const
+{
+	return rects_.size() == 1 && rects_.front() == bounds_;
+}
+
+int64_t dirty_region::area() const
+{
+	int64_t area = 0;
+
+	BOOST_FOREACH(auto& rect, rects_)
+		area += rect.area();
+
+	return area;
+}
+
+}}
@@ -0,0 +1,83 @@
+/*
+* Copyright 2026 Sveriges Television AB http://casparcg.com/
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace caspar { namespace core {
+
+struct pixel_rect
+{
+	int x;
+	int y;
+	int width;
+	int height;
+
+	pixel_rect()
+		: x(0), y(0), width(0), height(0)
+	{
+	}
+
+	pixel_rect(int x, int y, int width, int height)
+		: x(x), y(y), width(width), height(height)
+	{
+	}
+
+	bool empty() const
+	{
+		return width <= 0 || height <= 0;
+	}
+
+	int64_t area() const
+	{
+		return empty() ? 0 : static_cast<int64_t>(width) * height;
+	}
+};
+
+bool operator==(const pixel_rect& lhs, const pixel_rect& rhs);
+bool operator!=(const pixel_rect& lhs, const pixel_rect& rhs);
+
+// The parts of an image that have changed since it was last uploaded.
+// Rectangles are clipped to the image and merged whenever uploading their
+// bounding box costs about the same as uploading them one by one. When most
+// of the image is dirty the region becomes the whole image.
+class dirty_region
+{
+public:
+	dirty_region(int width, int height);
+
+	void add(const pixel_rect& rect);
+	void add_all();
+	void clear();
+
+	const std::vector<pixel_rect>& rects() const;
+	bool empty() const;
+	bool full() const;
+
+	// Pixels covered, overlapping rectangles are counted once for each since
+	// they are uploaded once for each.
+	int64_t area() const;
+private:
+	pixel_rect				bounds_;
+	std::vector<pixel_rect>	rects_;
+};
+
+}}
@@ -28,10 +28,14 @@
 
 #include <boost/noncopyable.hpp>
 
+#include <vector>
+
 namespace caspar { namespace core {
 	
 class write_frame;
+class read_frame;
 struct pixel_format_desc;
+struct pixel_rect;
 struct video_format_desc;
 		
 struct frame_factory : boost::noncopyable
@@ -42,6 +46,22 @@ struct frame_factory : boost::noncopyable
 			const pixel_format_desc& desc,
 			const channel_layout& audio_channel_layout = channel_layout::stereo()) = 0;	
 
+	// Creates a frame whose image is uploaded directly from the read back
+	// buffer of source, without copying it through a new host buffer.
+	virtual safe_ptr<write_frame> create_frame(
+			const void* video_stream_tag,
+			const safe_ptr<read_frame>& source,
+			const pixel_format_desc& desc) = 0;
+
+	// Creates a frame that shares the textures of previous and only uploads
+	// the given regions of its image data, the rest of it is ignored. Since
+	// the upload changes what previous shows as well, this is only meant for
+	// producers that never go back to an earlier frame.
+	virtual safe_ptr<write_frame> create_frame(
+			const void* video_stream_tag,
+			const safe_ptr<write_frame>& previous,
+			const std::vector<pixel_rect>& regions) = 0;
+
 	virtual video_format_desc get_video_format_desc() const = 0; // nothrow
 };
 
@@ -138,60 +138,83 @@ frame_transform frame_transform::operator*(const frame_transform &other) const
 	return frame_transform(*this) *= other;
 }
 
-double do_tween(double time, double source, double dest, double duration, const tweener_t& tweener)
-{
-	return tweener(time, source, dest-source, duration);
-};
+static const int NUM_TWEENED_VALUES = 33;
 
-template<typename Rect>
-void do_tween_rectangle(const Rect& source, const Rect& dest, Rect& out, double time, double duration, const tweener_t& tweener)
+// Collects pointers to every value of a transform that is tweened, so that
+// they can be tweened together in one call.
+template<typename T, typename P>
+void get_tweened_values(T& transform, P* values)
 {
-	out.ul[0] = do_tween(time, source.ul[0], dest.ul[0], duration, tweener);
-	out.ul[1] = do_tween(time, source.ul[1], dest.ul[1], duration, tweener);
-	out.lr[0] = do_tween(time, source.lr[0], dest.lr[0], duration, tweener);
-	out.lr[1] = do_tween(time, source.lr[1], dest.lr[1], duration, tweener);
+	P* value = values;
+
+	*value++ = &transform.volume;
+	*value++ = &transform.brightness;
+	*value++ = &transform.contrast;
+	*value++ = &transform.saturation;
+	*value++ = &transform.opacity;
+	*value++ = &transform.anchor[0];
+	*value++ = &transform.anchor[1];
+	*value++ = &transform.fill_translation[0];
+	*value++ = &transform.fill_translation[1];
+	*value++ = &transform.fill_scale[0];
+	*value++ = &transform.fill_scale[1];
+	*value++ = &transform.clip_translation[0];
+	*value++ = &transform.clip_translation[1];
+	*value++ = &transform.clip_scale[0];
+	*value++ = &transform.clip_scale[1];
+	*value++ = &transform.angle;
+	*value++ = &transform.levels.max_input;
+	*value++ = &transform.levels.min_input;
+	*value++ = &transform.levels.max_output;
+	*value++ = &transform.levels.min_output;
+	*value++ = &transform.levels.gamma;
+	*value++ = &transform.crop.ul[0];
+	*value++ = &transform.crop.ul[1];
+	*value++ = &transform.crop.lr[0];
+	*value++ = &transform.crop.lr[1];
+	*value++ = &transform.perspective.ul[0];
+	*value++ = &transform.perspective.ul[1];
+	*value++ = &transform.perspective.ur[0];
+	*value++ = &transform.perspective.ur[1];
+	*value++ = &transform.perspective.lr[0];
+	*value++ = &transform.perspective.lr[1];
+	*value++ = &transform.perspective.ll[0];
+	*value++ = &transform.perspective.ll[1];
+
+	CASPAR_ASSERT(value - values == NUM_TWEENED_VALUES);
 }
 
-void do_tween_corners(const corners& source, const corners& dest, corners& out, double time, double duration, const tweener_t& tweener)
-{
-	do_tween_rectangle(source, dest, out, time, duration, tweener);
-	out.ur[0] = do_tween(time, source.ur[0], dest.ur[0], duration, tweener);
-	out.ur[1] = do_tween(time, source.ur[1], dest.ur[1], duration, tweener);
-	out.ll[0] = do_tween(time, source.ll[0], dest.ll[0], duration, tweener);
-	out.ll[1] = do_tween(time, source.ll[1], dest.ll[1], duration, tweener);
-};
-
 frame_transform tween(double time, const frame_transform& source, const frame_transform& dest, double duration, const tweener_t& tweener)
 {	
+	const double*	source_values[NUM_TWEENED_VALUES];
+	const double*	dest_values[NUM_TWEENED_VALUES];
+	double*			result_values[NUM_TWEENED_VALUES];
+
 	frame_transform result;	
-	result.volume				= do_tween(time, source.volume,					dest.volume,				duration, tweener);
-	result.brightness			= do_tween(time, source.brightness,				dest.brightness,			duration, tweener);
-	result.contrast				= do_tween(time, source.contrast,				dest.contrast,				duration, tweener);
-	result.saturation			= do_tween(time, source.saturation,				dest.saturation,			duration, tweener);
-	result.opacity				= do_tween(time, source.opacity,				dest.opacity,				duration, tweener);	
-	result.anchor[0]			= do_tween(time, source.anchor[0],				dest.anchor[0],				duration, tweener), 
-	result.anchor[1]			= do_tween(time, source.anchor[1],				dest.anchor[1],				duration, tweener);		
-	result.fill_translation[0]	= do_tween(time, source.fill_translation[0],	dest.fill_translation[0],	duration, tweener), 
-	result.fill_translation[1]	= do_tween(time, source.fill_translation[1],	dest.fill_translation[1],	duration, tweener);		
-	result.fill_scale[0]		= do_tween(time, source.fill_scale[0],			dest.fill_scale[0],			duration, tweener), 
-	result.fill_scale[1]		= do_tween(time, source.fill_scale[1],			dest.fill_scale[1],			duration, tweener);	
-	result.clip_translation[0]	= do_tween(time, source.clip_translation[0],	dest.clip_translation[0],	duration, tweener), 
-	result.clip_translation[1]	= do_tween(time, source.clip_translation[1],	dest.clip_translation[1],	duration, tweener);		
-	result.clip_scale[0]		= do_tween(time, source.clip_scale[0],			dest.clip_scale[0],			duration, tweener), 
-	result.clip_scale[1]		= do_tween(time, source.clip_scale[1],			dest.clip_scale[1],			duration, tweener);
-	result.angle				= do_tween(time, source.angle,					dest.angle,					duration, tweener);	
-	result.levels.max_input		= do_tween(time, source.levels.max_input,		dest.levels.max_input,		duration, tweener);
-	result.levels.min_input		= do_tween(time, source.levels.min_input,		dest.levels.min_input,		duration, tweener);	
-	result.levels.max_output	= do_tween(time, source.levels.max_output,		dest.levels.max_output,		duration, tweener);
-	result.levels.min_output	= do_tween(time, source.levels.min_output,		dest.levels.min_output,		duration, tweener);
-	result.levels.gamma			= do_tween(time, source.levels.gamma,			dest.levels.gamma,			duration, tweener);
+
+	get_tweened_values(source, source_values);
+	get_tweened_values(dest, dest_values);
+	get_tweened_values(result, result_values);
+
+	double sources[NUM_TWEENED_VALUES];
+	double dests[NUM_TWEENED_VALUES];
+	double results[NUM_TWEENED_VALUES];
+
+	for(int n = 0; n < NUM_TWEENED_VALUES; ++n)
+	{
+		sources[n]	= *source_values[n];
+		dests[n]	= *dest_values[n];
+	}
+
+	tweener(time, sources, dests, results, NUM_TWEENED_VALUES, duration);
+
+	for(int n = 0; n < NUM_TWEENED_VALUES; ++n)
+		*result_values[n] = results[n];
+
 	result.field_mode			= static_cast<field_mode::type>(source.field_mode & dest.field_mode);
 	result.is_key				= source.is_key | dest.is_key;
 	result.is_mix				= source.is_mix | dest.is_mix;
 
-	do_tween_rectangle(source.crop, dest.crop, result.crop, time, duration, tweener);
-	do_tween_corners(source.perspective, dest.perspective, result.perspective, time, duration, tweener);
-
 	return result;
 }
 
@@ -109,7 +109,8 @@ public:
 	{		
 		try
 		{
-			*monitor_subject_ << monitor::message("/paused") % is_paused_;
+			if (monitor_subject_->is_subscribed("/paused"))
+				*monitor_subject_ << monitor::message("/paused") % is_paused_;
 
 			if(is_paused_)
 			{
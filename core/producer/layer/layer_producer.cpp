@@ -40,19 +40,24 @@
 #include <boost/format.hpp>
 
 #include <tbb/concurrent_queue.h>
+#include <tbb/spin_mutex.h>
 
 namespace caspar { namespace core {
 
 class layer_consumer : public write_frame_consumer
 {	
+	const bool												same_tick_;
 	tbb::concurrent_bounded_queue<safe_ptr<basic_frame>>	frame_buffer_;
+	tbb::spin_mutex											current_frame_mutex_;
+	std::shared_ptr<basic_frame>							current_frame_;
 	boost::promise<void>									first_frame_promise_;
 	boost::unique_future<void>								first_frame_available_;
 	bool													first_frame_reported_;
 
 public:
-	layer_consumer()
-		: first_frame_available_(first_frame_promise_.get_future())
+	explicit layer_consumer(bool same_tick)
+		: same_tick_(same_tick)
+		, first_frame_available_(first_frame_promise_.get_future())
 		, first_frame_reported_(false)
 	{
 		frame_buffer_.set_capacity(2);
@@ -66,7 +71,15 @@ public:
 
 	virtual void send(const safe_ptr<basic_frame>& src_frame) override
 	{
-		bool pushed = frame_buffer_.try_push(src_frame);
+		bool pushed = true;
+
+		if (same_tick_)
+		{
+			tbb::spin_mutex::scoped_lock lock(current_frame_mutex_);
+			current_frame_ = src_frame;
+		}
+		else
+			pushed = frame_buffer_.try_push(src_frame);
 
 		if (pushed && !first_frame_reported_)
 		{
@@ -82,6 +95,18 @@ public:
 
 	safe_ptr<basic_frame> receive()
 	{
+		if (same_tick_)
+		{
+			// The stage receives the source layer first, so this is the frame
+			// of the current tick. It is released here to not keep it alive.
+			std::shared_ptr<basic_frame> frame;
+			{
+				tbb::spin_mutex::scoped_lock lock(current_frame_mutex_);
+				frame.swap(current_frame_);
+			}
+			return frame ? make_safe_ptr(frame) : basic_frame::late();
+		}
+
 		safe_ptr<basic_frame> frame;
 		if (!frame_buffer_.try_pop(frame))
 		{
@@ -110,18 +135,23 @@ class layer_producer : public frame_producer
 	uint64_t								frame_number_;
 
 	const safe_ptr<stage>                   stage_;
+	const bool								same_tick_;
 
 public:
-	explicit layer_producer(const safe_ptr<frame_factory>& frame_factory, const safe_ptr<stage>& stage, int layer) 
+	explicit layer_producer(const safe_ptr<frame_factory>& frame_factory, const safe_ptr<stage>& stage, int layer, int destination_layer) 
 		: frame_factory_(frame_factory)
 		, layer_(layer)
 		, stage_(stage)
-		, consumer_(new layer_consumer())
+		, same_tick_(destination_layer >= 0)
+		, consumer_(new layer_consumer(destination_layer >= 0))
 		, last_frame_(basic_frame::empty())
 		, frame_number_(0)
 	{
-		stage_->add_layer_consumer(this, layer_, consumer_);
-		consumer_->block_until_first_frame_available();
+		stage_->add_layer_consumer(this, layer_, consumer_, destination_layer);
+
+		if (!same_tick_)
+			consumer_->block_until_first_frame_available();
+
 		CASPAR_LOG(info) << print() << L" Initialized";
 	}
 
@@ -157,6 +187,8 @@ public:
 	{
 		boost::property_tree::wptree info;
 		info.add(L"type", L"layer-producer");
+		info.add(L"layer", layer_);
+		info.add(L"same-tick", same_tick_);
 		return info;
 	}
 
@@ -167,10 +199,10 @@ public:
 
 };
 
-safe_ptr<frame_producer> create_layer_producer(const safe_ptr<core::frame_factory>& frame_factory, const safe_ptr<stage>& stage, int layer)
+safe_ptr<frame_producer> create_layer_producer(const safe_ptr<core::frame_factory>& frame_factory, const safe_ptr<stage>& stage, int layer, int destination_layer)
 {
 	return create_producer_print_proxy(
-		make_safe<layer_producer>(frame_factory, stage, layer)
+		make_safe<layer_producer>(frame_factory, stage, layer, destination_layer)
 	);
 }
 
@@ -31,6 +31,9 @@ namespace caspar { namespace core {
 class stage;
 struct frame_factory;
 
-safe_ptr<frame_producer> create_layer_producer(const safe_ptr<core::frame_factory>& frame_factory, const safe_ptr<stage>& stage, int layer);
+// A route with a destination_layer is played on that layer of the stage it
+// routes from. It shares the source layer's frame of the current tick instead
+// of queueing frames. Routes to other stages pass -1.
+safe_ptr<frame_producer> create_layer_producer(const safe_ptr<core::frame_factory>& frame_factory, const safe_ptr<stage>& stage, int layer, int destination_layer = -1);
 
 }}
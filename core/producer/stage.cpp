@@ -28,7 +28,10 @@
 #include "frame/basic_frame.h"
 #include "frame/frame_factory.h"
 
+#include "../frame_trace.h"
+
 #include <common/concurrency/executor.h>
+#include <common/scope_exit.h>
 
 #include <core/producer/frame/frame_transform.h>
 #include <core/consumer/frame_consumer.h>
@@ -37,11 +40,13 @@
 #include <boost/foreach.hpp>
 #include <boost/timer.hpp>
 
+#include <tbb/parallel_for.h>
 #include <tbb/parallel_for_each.h>
-#include <tbb/concurrent_unordered_map.h>
+#include <tbb/spin_mutex.h>
 
 #include <boost/property_tree/ptree.hpp>
 
+#include <algorithm>
 #include <map>
 
 namespace caspar { namespace core {
@@ -57,8 +62,7 @@ class tweened_transform
 public:	
 	tweened_transform()
 		: duration_(0)
-		, time_(0)
-		, tweener_(get_tweener(L"linear")){}
+		, time_(0){}
 	tweened_transform(const T& source, const T& dest, int duration, const std::wstring& tween = L"linear")
 		: source_(source)
 		, dest_(dest)
@@ -83,9 +87,14 @@ public:
 
 	T fetch_and_tick(int num)
 	{						
-		time_ = std::min(time_+num, duration_);
+		tick(num);
 		return fetch();
 	}
+
+	void tick(int num)
+	{
+		time_ = std::min(time_+num, duration_);
+	}
 };
 
 struct stage::implementation : public std::enable_shared_from_this<implementation>
@@ -94,14 +103,74 @@ struct stage::implementation : public std::enable_shared_from_this<implementatio
 	safe_ptr<diagnostics::graph>												 graph_;
 	safe_ptr<stage::target_t>													 target_;
 	video_format_desc															 format_desc_;
+	safe_ptr<frame_tracer>														 tracer_;
 																				 
 	boost::timer																 produce_timer_;
 	boost::timer																 tick_timer_;
 																				 
-	std::map<int, std::shared_ptr<layer>>										 layers_;	
-	tbb::concurrent_unordered_map<int, tweened_transform<core::frame_transform>> transforms_;	
+	// One entry per index with a layer, a transform or both, sorted by index.
+	// Layers are held by pointer so that they stay put when entries are
+	// inserted or removed.
+	struct layer_entry
+	{
+		int									index;
+		std::shared_ptr<core::layer>		layer;
+		tweened_transform<frame_transform>	transform;
+		bool								has_transform;
+
+		explicit layer_entry(int index)
+			: index(index)
+			, has_transform(false)
+		{
+		}
+	};
+
+	struct entry_index_less
+	{
+		bool operator()(const layer_entry& lhs, int rhs) const { return lhs.index < rhs; }
+		bool operator()(int lhs, const layer_entry& rhs) const { return lhs < rhs.index; }
+	};
+
+	std::vector<layer_entry>													 layers_;
+	std::vector<layer_entry*>													 active_layers_;
 	// map of layer -> map of tokens (src ref) -> layer_consumer
 	std::map<int, std::map<void*, std::shared_ptr<write_frame_consumer>>>		 layer_consumers_;
+	// map of tokens -> (source layer, destination layer) for routes within this stage
+	std::map<void*, std::pair<int, int>>										 routes_;
+	// map of layer -> number of routes it is behind, layers not in it are at 0
+	std::map<int, size_t>														 route_levels_;
+
+	// Transform updates are queued by the callers and applied together at the
+	// start of the next tick, instead of as one executor task per update.
+	struct transform_update
+	{
+		enum type_t
+		{
+			apply_to_dest,
+			apply_to_current,
+			clear_layer,
+			clear_all
+		};
+
+		type_t						type;
+		int							index;
+		stage::transform_func_t		transform;
+		unsigned int				mix_duration;
+		std::wstring				tween;
+
+		transform_update(type_t type, int index, const stage::transform_func_t& transform = nullptr, unsigned int mix_duration = 0, const std::wstring& tween = L"linear")
+			: type(type)
+			, index(index)
+			, transform(transform)
+			, mix_duration(mix_duration)
+			, tween(tween)
+		{
+		}
+	};
+
+	tbb::spin_mutex																 pending_transforms_mutex_;
+	std::vector<transform_update>												 pending_transforms_;
+	std::vector<transform_update>												 applied_transforms_;
 	
 	safe_ptr<monitor::subject>													 monitor_subject_;
 
@@ -112,10 +181,12 @@ public:
 			const safe_ptr<diagnostics::graph>& graph,
 			const safe_ptr<stage::target_t>& target,
 			const video_format_desc& format_desc,
+			const safe_ptr<frame_tracer>& tracer,
 			int channel_index)
 		: graph_(graph)
 		, format_desc_(format_desc)
 		, target_(target)
+		, tracer_(tracer)
 		, monitor_subject_(make_safe<monitor::subject>("/stage"))
 		, executor_(L"stage " + boost::lexical_cast<std::wstring>(channel_index))
 	{
@@ -129,11 +200,17 @@ public:
 		executor_.begin_invoke([=]{tick(self);});
 	}
 	
-	void add_layer_consumer(void* token, int layer, const std::shared_ptr<write_frame_consumer>& layer_consumer)
+	void add_layer_consumer(void* token, int layer, const std::shared_ptr<write_frame_consumer>& layer_consumer, int destination_layer)
 	{
 		executor_.begin_invoke([=]
 		{
 			layer_consumers_[layer][token] = layer_consumer;
+
+			if (destination_layer >= 0)
+			{
+				routes_[token] = std::make_pair(layer, destination_layer);
+				update_route_levels();
+			}
 		}, high_priority);
 	}
 
@@ -147,23 +224,70 @@ public:
 			{
 				layer_consumers_.erase(layer);
 			}
+
+			if (routes_.erase(token) > 0)
+				update_route_levels();
 		}, high_priority);
 	}
 
+	// A route destination is received one level after its source, so that a
+	// chain of routes gets the frame of the current tick at every hop. Each
+	// pass relaxes every route once, which settles any chain without cycles.
+	// A cycle is cut off after as many levels as there are routes, the route
+	// that closes it lags a frame behind.
+	void update_route_levels()
+	{
+		route_levels_.clear();
+
+		for (size_t n = 0; n < routes_.size(); ++n)
+		{
+			BOOST_FOREACH(auto& route, routes_)
+			{
+				auto level = route_levels_[route.second.first] + 1;
+				auto& destination_level = route_levels_[route.second.second];
+				destination_level = std::max(destination_level, level);
+			}
+		}
+	}
+
 	void tick(const std::weak_ptr<implementation>& self)
 	{		
 		try
 		{
 			produce_timer_.restart();
 
-			std::map<int, safe_ptr<basic_frame>> frames;
-		
-			for(auto it = layers_.begin(); it != layers_.end(); ++it)
-				frames[it->first] = basic_frame::empty();	
+			auto ticket = tracer_->create_ticket([self]
+			{
+				auto self2 = self.lock();
+				if(self2)				
+					self2->executor_.begin_invoke([=]{self2->tick(self);});				
+			});
 
-			tbb::parallel_for_each(layers_.begin(), layers_.end(), [&](std::map<int, std::shared_ptr<layer>>::value_type& layer) 
+			auto trace = get_frame_trace(ticket);
+
+			apply_pending_transforms();
+
+			const int ticks = format_desc_.field_mode != core::field_mode::progressive ? 2 : 1;
+
+			std::vector<std::pair<int, safe_ptr<basic_frame>>> frames;
+			frames.reserve(layers_.size());
+			active_layers_.clear();
+
+			BOOST_FOREACH(auto& entry, layers_)
+			{
+				if(entry.layer)
+				{
+					active_layers_.push_back(&entry);
+					frames.push_back(std::make_pair(entry.index, basic_frame::empty()));
+				}
+				else // Tick the transforms that does not have a corresponding layer.
+					entry.transform.tick(ticks);
+			}
+
+			auto receive_layer = [&](size_t n) 
 			{
-				auto transform = transforms_[layer.first].fetch_and_tick(1);
+				auto& entry = *active_layers_[n];
+				auto transform = entry.transform.fetch_and_tick(1);
 
 				int hints = frame_producer::NO_HINT;
 				if(format_desc_.field_mode != field_mode::progressive)
@@ -175,8 +299,13 @@ public:
 				if(transform.is_key)
 					hints |= frame_producer::ALPHA_HINT;
 
-				auto frame = layer.second->receive(hints);	
-				auto layer_consumers_it = layer_consumers_.find(layer.first);
+				auto receive_begin = trace ? frame_trace::now() : 0;
+				auto frame = entry.layer->receive(hints);	
+
+				if(trace)
+					trace->add_layer(entry.index, receive_begin, frame_trace::now());
+
+				auto layer_consumers_it = layer_consumers_.find(entry.index);
 				if (layer_consumers_it != layer_consumers_.end())
 				{
 					auto consumer_it = (*layer_consumers_it).second | boost::adaptors::map_values;
@@ -192,106 +321,235 @@ public:
 				if(format_desc_.field_mode != core::field_mode::progressive)
 				{				
 					auto frame2 = make_safe<core::basic_frame>(frame);
-					frame2->get_frame_transform() = transforms_[layer.first].fetch_and_tick(1);
+					frame2->get_frame_transform() = entry.transform.fetch_and_tick(1);
 					frame1 = core::basic_frame::interlace(frame1, frame2, format_desc_.field_mode);
 				}
 
-				frames[layer.first] = frame1;
-			});
+				frames[n].second = frame1;
+			};
+
+			if (route_levels_.empty())
+				tbb::parallel_for<size_t>(0, active_layers_.size(), receive_layer);
+			else
+			{
+				// Routes within this stage are received after the layers they
+				// route from, one level at a time.
+				std::vector<std::vector<size_t>> levels;
+
+				for(size_t n = 0; n < active_layers_.size(); ++n)
+				{
+					auto it = route_levels_.find(active_layers_[n]->index);
+					auto level = it != route_levels_.end() ? it->second : 0;
 
-			// Tick the transforms that does not have a corresponding layer.
-			BOOST_FOREACH(auto& elem, transforms_)
-				if (layers_.find(elem.first) == layers_.end())
-					elem.second.fetch_and_tick(format_desc_.field_mode != core::field_mode::progressive ? 2 : 1);
+					if (levels.size() <= level)
+						levels.resize(level + 1);
+
+					levels[level].push_back(n);
+				}
+
+				BOOST_FOREACH(auto& level, levels)
+					tbb::parallel_for_each(level.begin(), level.end(), receive_layer);
+			}
 			
 			graph_->set_value("produce-time", produce_timer_.elapsed()*format_desc_.fps*0.5);
 
-			std::shared_ptr<void> ticket(nullptr, [self](void*)
-			{
-				auto self2 = self.lock();
-				if(self2)				
-					self2->executor_.begin_invoke([=]{tick(self);});				
-			});
+			if(trace)
+				trace->stamp(frame_trace::stage_end);
 
-			target_->send(std::make_pair(frames, ticket));
+			target_->send(std::make_pair(std::move(frames), ticket));
 
 			graph_->set_value("tick-time", tick_timer_.elapsed()*format_desc_.fps*0.5);
 			tick_timer_.restart();
 		}
 		catch(...)
 		{
-			layers_.clear();
+			clear_layers();
 			CASPAR_LOG_CURRENT_EXCEPTION();
 		}		
 	}
+
+	layer_entry* find_entry(int index)
+	{
+		auto it = std::lower_bound(layers_.begin(), layers_.end(), index, entry_index_less());
+		return it != layers_.end() && it->index == index ? &*it : nullptr;
+	}
+
+	std::shared_ptr<layer> find_layer(int index) const
+	{
+		auto it = std::lower_bound(layers_.begin(), layers_.end(), index, entry_index_less());
+		return it != layers_.end() && it->index == index ? it->layer : nullptr;
+	}
+
+	layer_entry& get_entry(int index)
+	{
+		auto it = std::lower_bound(layers_.begin(), layers_.end(), index, entry_index_less());
+		if(it == layers_.end() || it->index != index)
+			it = layers_.insert(it, layer_entry(index));
+		return *it;
+	}
+
+	void remove_unused_entries()
+	{
+		layers_.erase(std::remove_if(layers_.begin(), layers_.end(), [](const layer_entry& entry)
+		{
+			return !entry.layer && !entry.has_transform;
+		}), layers_.end());
+	}
+
+	std::vector<std::pair<int, std::shared_ptr<layer>>> take_layers()
+	{
+		std::vector<std::pair<int, std::shared_ptr<layer>>> layers;
+
+		BOOST_FOREACH(auto& entry, layers_)
+		{
+			if(entry.layer)
+				layers.push_back(std::make_pair(entry.index, std::move(entry.layer)));
+		}
+
+		remove_unused_entries();
+
+		return layers;
+	}
+
+	void put_layers(const std::vector<std::pair<int, std::shared_ptr<layer>>>& layers)
+	{
+		BOOST_FOREACH(auto& layer, layers)
+			get_entry(layer.first).layer = layer.second;
+	}
+
+	void clear_layers()
+	{
+		BOOST_FOREACH(auto& entry, layers_)
+			entry.layer.reset();
+
+		remove_unused_entries();
+	}
+		
+	void queue_transform(const transform_update& update)
+	{
+		tbb::spin_mutex::scoped_lock lock(pending_transforms_mutex_);
+		pending_transforms_.push_back(update);
+	}
+
+	void apply_pending_transforms()
+	{
+		{
+			tbb::spin_mutex::scoped_lock lock(pending_transforms_mutex_);
+			pending_transforms_.swap(applied_transforms_);
+		}
+
+		CASPAR_SCOPE_EXIT
+		{
+			applied_transforms_.clear();
+		};
+
+		// A failing update is skipped on its own, letting it escape would
+		// make tick clear every layer of the channel.
+		BOOST_FOREACH(auto& update, applied_transforms_)
+		{
+			try
+			{
+				switch(update.type)
+				{
+				case transform_update::apply_to_dest:
+					{
+						auto& entry = get_entry(update.index);
+						auto& tween = entry.transform;
+						entry.has_transform = true;
+						auto src = tween.fetch();
+						auto dst = update.transform(tween.dest());
+						tween = tweened_transform<frame_transform>(src, dst, update.mix_duration, update.tween);
+						break;
+					}
+				case transform_update::apply_to_current:
+					{
+						auto& entry = get_entry(update.index);
+						auto& tween = entry.transform;
+						entry.has_transform = true;
+						auto src = tween.fetch();
+						auto dst = update.transform(src);
+						tween = tweened_transform<frame_transform>(src, dst, update.mix_duration, update.tween);
+						break;
+					}
+				case transform_update::clear_layer:
+					{
+						auto entry = find_entry(update.index);
+						if(entry)
+						{
+							entry->transform		= tweened_transform<frame_transform>();
+							entry->has_transform	= false;
+						}
+						break;
+					}
+				case transform_update::clear_all:
+					BOOST_FOREACH(auto& entry, layers_)
+					{
+						entry.transform		= tweened_transform<frame_transform>();
+						entry.has_transform	= false;
+					}
+					break;
+				}
+			}
+			catch(...)
+			{
+				CASPAR_LOG_CURRENT_EXCEPTION();
+			}
+		}
+
+		if(!applied_transforms_.empty())
+			remove_unused_entries();
+	}
 		
 	void set_transform(int index, const frame_transform& transform, unsigned int mix_duration, const std::wstring& tween)
 	{
-		executor_.begin_invoke([=]
+		queue_transform(transform_update(transform_update::apply_to_current, index, [=](frame_transform) 
 		{
-			auto src = transforms_[index].fetch();
-			auto dst = transform;
-			transforms_[index] = tweened_transform<frame_transform>(src, dst, mix_duration, tween);
-		}, high_priority);
+			return transform;
+		}, mix_duration, tween));
 	}
 					
 	void apply_transforms(const std::vector<std::tuple<int, stage::transform_func_t, unsigned int, std::wstring>>& transforms)
 	{
-		executor_.begin_invoke([=]
-		{
-			BOOST_FOREACH(auto& transform, transforms)
-			{
-				auto& tween = transforms_[std::get<0>(transform)];
-				auto src = tween.fetch();
-				auto dst = std::get<1>(transform)(tween.dest());
-				transforms_[std::get<0>(transform)] = tweened_transform<frame_transform>(src, dst, std::get<2>(transform), std::get<3>(transform));
-			}
-		}, high_priority);
+		tbb::spin_mutex::scoped_lock lock(pending_transforms_mutex_);
+
+		BOOST_FOREACH(auto& transform, transforms)
+			pending_transforms_.push_back(transform_update(transform_update::apply_to_dest, std::get<0>(transform), std::get<1>(transform), std::get<2>(transform), std::get<3>(transform)));
 	}
 						
 	void apply_transform(int index, const stage::transform_func_t& transform, unsigned int mix_duration, const std::wstring& tween)
 	{
-		executor_.begin_invoke([=]
-		{
-			auto src = transforms_[index].fetch();
-			auto dst = transform(src);
-			transforms_[index] = tweened_transform<frame_transform>(src, dst, mix_duration, tween);
-		}, high_priority);
+		queue_transform(transform_update(transform_update::apply_to_current, index, transform, mix_duration, tween));
 	}
 
 	void clear_transforms(int index)
 	{
-		executor_.begin_invoke([=]
-		{
-			transforms_.unsafe_erase(index);
-		}, high_priority);
+		queue_transform(transform_update(transform_update::clear_layer, index));
 	}
 
 	void clear_transforms()
 	{
-		executor_.begin_invoke([=]
-		{
-			transforms_.clear();
-		}, high_priority);
+		queue_transform(transform_update(transform_update::clear_all, 0));
 	}
 
 	frame_transform get_current_transform(int index)
 	{
 		return executor_.invoke([=]
 		{
-			return transforms_[index].fetch();
+			apply_pending_transforms();
+			auto entry = find_entry(index);
+			return entry ? entry->transform.fetch() : frame_transform();
 		});
 	}
 		
 	layer& get_layer(int index)
 	{
-		auto it = layers_.find(index);
-		if(it == std::end(layers_))
+		auto& entry = get_entry(index);
+		if(!entry.layer)
 		{
-			it = layers_.insert(std::make_pair(index, std::make_shared<layer>(index))).first;
-			it->second->monitor_output().attach_parent(monitor_subject_);
+			entry.layer = std::make_shared<layer>(index);
+			entry.layer->monitor_output().attach_parent(monitor_subject_);
 		}
-		return *it->second;
+		return *entry.layer;
 	}
 
 	void load(int index, const safe_ptr<frame_producer>& producer, bool preview, int auto_play_delta)
@@ -338,7 +596,12 @@ public:
 	{
 		executor_.begin_invoke([=]
 		{
-			layers_.erase(index);
+			auto entry = find_entry(index);
+			if(entry)
+			{
+				entry->layer.reset();
+				remove_unused_entries();
+			}
 		}, high_priority);
 	}
 		
@@ -346,7 +609,7 @@ public:
 	{
 		executor_.begin_invoke([=]
 		{
-			layers_.clear();
+			clear_layers();
 		}, high_priority);
 	}	
 	
@@ -367,22 +630,24 @@ public:
 		
 		auto func = [=]
 		{
-			auto layers			= layers_ | boost::adaptors::map_values;
-			auto other_layers	= other_impl->layers_ | boost::adaptors::map_values;
+			// Only the layers are swapped, the transforms stay with their stage.
+			auto layers			= take_layers();
+			auto other_layers	= other_impl->take_layers();
 
 			BOOST_FOREACH(auto& layer, layers)
-				layer->monitor_output().detach_parent();
+				layer.second->monitor_output().detach_parent();
 			
 			BOOST_FOREACH(auto& layer, other_layers)
-				layer->monitor_output().attach_parent(monitor_subject_);
+				layer.second->monitor_output().attach_parent(monitor_subject_);
 			
-			std::swap(layers_, other_impl->layers_);
+			put_layers(other_layers);
+			other_impl->put_layers(layers);
 						
 			BOOST_FOREACH(auto& layer, layers)
-				layer->monitor_output().detach_parent();
+				layer.second->monitor_output().detach_parent();
 			
 			BOOST_FOREACH(auto& layer, other_layers)
-				layer->monitor_output().detach_parent();
+				layer.second->monitor_output().detach_parent();
 		};		
 
 		executor_.begin_invoke([=]
@@ -457,9 +722,12 @@ public:
 		return std::move(executor_.begin_invoke([this]() -> boost::property_tree::wptree
 		{
 			boost::property_tree::wptree info;
-			BOOST_FOREACH(auto& layer, layers_)			
-				info.add_child(L"layers.layer", layer.second->info())
-					.add(L"index", layer.first);	
+			BOOST_FOREACH(auto& entry, layers_)			
+			{
+				if(entry.layer)
+					info.add_child(L"layers.layer", entry.layer->info())
+						.add(L"index", entry.index);	
+			}
 			return info;
 		}, high_priority));
 	}
@@ -477,9 +745,12 @@ public:
 		return std::move(executor_.begin_invoke([this]() -> boost::property_tree::wptree
 		{
 			boost::property_tree::wptree info;
-			BOOST_FOREACH(auto& layer, layers_)			
-				info.add_child(L"layer", layer.second->delay_info())
-					.add(L"index", layer.first);	
+			BOOST_FOREACH(auto& entry, layers_)			
+			{
+				if(entry.layer)
+					info.add_child(L"layer", entry.layer->delay_info())
+						.add(L"index", entry.index);	
+			}
 			return info;
 		}, high_priority));
 	}
@@ -492,32 +763,37 @@ public:
 		}, high_priority));
 	}
 
-	std::wstring shortinfo(int index) const
+	std::wstring shortinfo(int index)
 	{
 
 		std::wstringstream replyString;
 		boost::property_tree::wptree info__;
 
-		auto it = layers_.find(index);
-		if (it != std::end(layers_))
+		// The layer table is only accessed on the executor, tick inserts and
+		// erases entries in it.
+		auto layer = executor_.invoke([=]
+		{
+			return find_layer(index);
+		}, high_priority);
+		if (layer)
 		{
-			if (it->second->foreground() != frame_producer::empty())
+			if (layer->foreground() != frame_producer::empty())
 			{
-				replyString << it->second->foreground()->ID << L"#" << it->second->foreground()->info().get<std::wstring>(L"filename");
+				replyString << layer->foreground()->ID << L"#" << layer->foreground()->info().get<std::wstring>(L"filename");
 			}
 			else
 			{
 				replyString << L"#";
 			}
 
-			if (it->second->background() != frame_producer::empty())
+			if (layer->background() != frame_producer::empty())
 			{
-				if (it->second->background()->info().get_child_optional(L"destination")){
-					replyString << "#" << it->second->background()->ID << L"#" << it->second->background()->info().get<std::wstring>(L"destination.producer.filename");
+				if (layer->background()->info().get_child_optional(L"destination")){
+					replyString << "#" << layer->background()->ID << L"#" << layer->background()->info().get<std::wstring>(L"destination.producer.filename");
 				}
-				else if (it->second->background()->info().get_child_optional(L"filename"))
+				else if (layer->background()->info().get_child_optional(L"filename"))
 				{
-					replyString << "#" << it->second->background()->ID << L"#" << it->second->background()->info().get<std::wstring>(L"filename");
+					replyString << "#" << layer->background()->ID << L"#" << layer->background()->info().get<std::wstring>(L"filename");
 				}
 				else
 				{
@@ -529,12 +805,12 @@ public:
 				replyString << L"##";
 			}
 
-			if (it->second->foreground() != frame_producer::empty())
+			if (layer->foreground() != frame_producer::empty())
 			{
-				int64_t currenttotal = it->second->info().get<int64_t>(L"nb_frames");
-				int64_t currentleft = it->second->info().get<int64_t>(L"frames-left");
+				int64_t currenttotal = layer->info().get<int64_t>(L"nb_frames");
+				int64_t currentleft = layer->info().get<int64_t>(L"frames-left");
 
-				replyString << L"#" << currenttotal << L"#" << (currenttotal - currentleft) << L"#" << it->second->foreground()->info().get<float>(L"fps") << L"#" << it->second->foreground()->info().get<std::wstring>(L"loop") << L"#" << ((it->second->is_paused()) ? L"true" : L"false");
+				replyString << L"#" << currenttotal << L"#" << (currenttotal - currentleft) << L"#" << layer->foreground()->info().get<float>(L"fps") << L"#" << layer->foreground()->info().get<std::wstring>(L"loop") << L"#" << ((layer->is_paused()) ? L"true" : L"false");
 			}
 			else
 			{
@@ -552,7 +828,9 @@ public:
 	{
 		executor_.begin_invoke([=]
 		{
-			layers_.find(index)->second->clearcue();
+			auto layer = find_layer(index);
+			if(layer)
+				layer->clearcue();
 		}, high_priority);
 	}
 
@@ -560,7 +838,9 @@ public:
 	{
 		executor_.begin_invoke([=]
 		{
-			layers_.find(index)->second->setEvent(event_);
+			auto layer = find_layer(index);
+			if(layer)
+				layer->setEvent(event_);
 		}, high_priority);
 	}
 };
@@ -571,8 +851,9 @@ stage::stage(
 		const safe_ptr<diagnostics::graph>& graph,
 		const safe_ptr<target_t>& target,
 		const video_format_desc& format_desc,
+		const safe_ptr<frame_tracer>& tracer,
 		int channel_index)
-	: impl_(new implementation(graph, target, format_desc, channel_index)){}
+	: impl_(new implementation(graph, target, format_desc, tracer, channel_index)){}
 void stage::apply_transforms(const std::vector<stage::transform_tuple_t>& transforms){impl_->apply_transforms(transforms);}
 void stage::apply_transform(int index, const std::function<core::frame_transform(core::frame_transform)>& transform, unsigned int mix_duration, const std::wstring& tween){impl_->apply_transform(index, transform, mix_duration, tween);}
 void stage::clear_transforms(int index){impl_->clear_transforms(index);}
@@ -589,7 +870,7 @@ void stage::clear(){impl_->clear();}
 void stage::swap_layers(const safe_ptr<stage>& other){impl_->swap_layers(*other);}
 void stage::swap_layer(int index, size_t other_index){impl_->swap_layer(index, other_index);}
 void stage::swap_layer(int index, size_t other_index, const safe_ptr<stage>& other){impl_->swap_layer(index, other_index, *other);}
-void stage::add_layer_consumer(void* token, int layer, const std::shared_ptr<write_frame_consumer>& layer_consumer){impl_->add_layer_consumer(token, layer, layer_consumer);}
+void stage::add_layer_consumer(void* token, int layer, const std::shared_ptr<write_frame_consumer>& layer_consumer, int destination_layer){impl_->add_layer_consumer(token, layer, layer_consumer, destination_layer);}
 void stage::remove_layer_consumer(void* token, int layer){impl_->remove_layer_consumer(token, layer);}
 boost::unique_future<safe_ptr<frame_producer>> stage::foreground(int index) {return impl_->foreground(index);}
 boost::unique_future<safe_ptr<frame_producer>> stage::background(int index) {return impl_->background(index);}
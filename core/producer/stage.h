@@ -41,6 +41,7 @@ namespace caspar { namespace core {
 struct video_format_desc;
 struct frame_transform;
 struct write_frame_consumer;
+class frame_tracer;
 
 class stage : boost::noncopyable
 {
@@ -50,7 +51,7 @@ public:
 
 	typedef std::function<struct frame_transform(struct frame_transform)>							transform_func_t;
 	typedef std::tuple<int, transform_func_t, unsigned int, std::wstring>							transform_tuple_t;
-	typedef target<std::pair<std::map<int, safe_ptr<basic_frame>>, std::shared_ptr<void>>> target_t;
+	typedef target<std::pair<std::vector<std::pair<int, safe_ptr<basic_frame>>>, std::shared_ptr<void>>>	target_t;
 
 	// Constructors
 
@@ -58,6 +59,7 @@ public:
 			const safe_ptr<diagnostics::graph>& graph,
 			const safe_ptr<target_t>& target,
 			const video_format_desc& format_desc,
+			const safe_ptr<frame_tracer>& tracer,
 			int channel_index);
 	
 	// Methods
@@ -81,7 +83,7 @@ public:
 	void swap_layer(int index, size_t other_index);
 	void swap_layer(int index, size_t other_index, const safe_ptr<stage>& other);
 
-	void add_layer_consumer(void* token, int layer, const std::shared_ptr<write_frame_consumer>& layer_consumer);
+	void add_layer_consumer(void* token, int layer, const std::shared_ptr<write_frame_consumer>& layer_consumer, int destination_layer = -1);
 	void remove_layer_consumer(void* token, int layer);
 
 	boost::unique_future<std::wstring>				call(int index, bool foreground, const std::wstring& param);
@@ -100,19 +100,20 @@ struct transition_producer : public frame_producer
 				source = source_producer_->last_frame();
 		});
 
-		*monitor_subject_ << monitor::message("/transition/frame") % static_cast<std::int32_t>(current_frame_) % static_cast<std::int32_t>(info_.duration)
-		                  << monitor::message("/transition/type") % [&]() -> std::string
-																{
-																	switch(info_.type)
+		if (monitor_subject_->is_subscribed("/transition"))
+			*monitor_subject_ << monitor::message("/transition/frame") % static_cast<std::int32_t>(current_frame_) % static_cast<std::int32_t>(info_.duration)
+			                  << monitor::message("/transition/type") % [&]() -> std::string
 																	{
-																	case transition::mix:	return "mix";
-																	case transition::wipe:	return "wipe";
-																	case transition::slide:	return "slide";
-																	case transition::push:	return "push";
-																	case transition::cut:	return "cut";
-																	default:				return "n/a";
-																	}
-																}();
+																		switch(info_.type)
+																		{
+																		case transition::mix:	return "mix";
+																		case transition::wipe:	return "wipe";
+																		case transition::slide:	return "slide";
+																		case transition::push:	return "push";
+																		case transition::cut:	return "cut";
+																		default:				return "n/a";
+																		}
+																	}();
 
 		return compose(dest, source);
 	}
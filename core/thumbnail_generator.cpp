@@ -291,7 +291,7 @@ public:
 				thumbnail_creator_(frame, format_desc_, png_file, width_, height_);
 			};
 
-			std::map<int, safe_ptr<basic_frame>> frames;
+			std::vector<std::pair<int, safe_ptr<basic_frame>>> frames;
 			auto raw_frame = basic_frame::empty();
 
 			try
@@ -322,7 +322,7 @@ public:
 			auto transformed_frame = make_safe<basic_frame>(raw_frame);
 			transformed_frame->get_frame_transform().fill_scale[0] = static_cast<double>(width_) / format_desc_.width;
 			transformed_frame->get_frame_transform().fill_scale[1] = static_cast<double>(height_) / format_desc_.height;
-			frames.insert(std::make_pair(0, transformed_frame));
+			frames.push_back(std::make_pair(0, transformed_frame));
 
 			std::shared_ptr<void> ticket(nullptr, [&thumbnail_ready](void*)
 			{
@@ -30,6 +30,7 @@
 #include "mixer/gpu/ogl_device.h"
 #include "mixer/audio/audio_util.h"
 #include "producer/stage.h"
+#include "frame_trace.h"
 
 #include <common/diagnostics/graph.h>
 #include <common/env.h>
@@ -47,6 +48,7 @@ struct video_channel::implementation : boost::noncopyable
 	video_format_desc						format_desc_;
 	const safe_ptr<ogl_device>				ogl_;
 	const safe_ptr<diagnostics::graph>		graph_;
+	const safe_ptr<frame_tracer>			tracer_;
 
 	const safe_ptr<caspar::core::output>	output_;
 	const safe_ptr<caspar::core::mixer>		mixer_;
@@ -60,9 +62,10 @@ public:
 		, index_(index)
 		, format_desc_(format_desc)
 		, ogl_(ogl)
+		, tracer_(make_safe<frame_tracer>(index))
 		, output_(new caspar::core::output(graph_, format_desc, audio_channel_layout, index))
 		, mixer_(new caspar::core::mixer(graph_, output_, format_desc, ogl, audio_channel_layout, index))
-		, stage_(new caspar::core::stage(graph_, mixer_, format_desc, index))
+		, stage_(new caspar::core::stage(graph_, mixer_, format_desc, tracer_, index))
 		, monitor_subject_(make_safe<monitor::subject>("/channel/" + boost::lexical_cast<std::string>(index)))
 	{
 		graph_->set_text(print());
@@ -153,6 +156,7 @@ video_channel::video_channel(int index, const video_format_desc& format_desc, co
 safe_ptr<stage> video_channel::stage() { return impl_->stage_;} 
 safe_ptr<mixer> video_channel::mixer() { return impl_->mixer_;} 
 safe_ptr<output> video_channel::output() { return impl_->output_;} 
+safe_ptr<frame_tracer> video_channel::tracer() { return impl_->tracer_;} 
 video_format_desc video_channel::get_video_format_desc() const{return impl_->format_desc_;}
 void video_channel::set_video_format_desc(const video_format_desc& format_desc){impl_->set_video_format_desc(format_desc);}
 boost::property_tree::wptree video_channel::info() const{return impl_->info();}
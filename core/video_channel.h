@@ -35,6 +35,7 @@ namespace caspar { namespace core {
 class stage;
 class mixer;
 class output;
+class frame_tracer;
 class ogl_device;
 struct video_format_desc;
 struct channel_layout;
@@ -56,6 +57,7 @@ public:
 	safe_ptr<stage> stage();
 	safe_ptr<mixer>	mixer();
 	safe_ptr<output> output();
+	safe_ptr<frame_tracer> tracer();
 	
 	video_format_desc get_video_format_desc() const;
 	void set_video_format_desc(const video_format_desc& format_desc);
@@ -40,12 +40,14 @@
 #include <common/env.h>
 #include <common/utility/string.h>
 #include <common/memory/memshfl.h>
+#include <common/memory/bgra_to_yuv.h>
 
 #include <boost/algorithm/string.hpp>
 #include <boost/timer.hpp>
 #include <boost/property_tree/ptree.hpp>
 
 #include <tbb/cache_aligned_allocator.h>
+#include <tbb/parallel_for.h>
 #include <tbb/parallel_invoke.h>
 #include <tbb/atomic.h>
 
@@ -211,6 +213,10 @@ struct output_format
 
 typedef std::vector<uint8_t, tbb::cache_aligned_allocator<uint8_t>>	byte_vector;
 
+// Frames pass through three threads, each with a bounded queue in front of it:
+// color conversion (sliced over all cores), encoding (frame threaded where the
+// codec supports it) and muxing. A full queue blocks the stage before it, the
+// consumer drops frames only when the conversion queue is full.
 struct ffmpeg_consumer : boost::noncopyable
 {		
 	const std::string						filename_;
@@ -221,22 +227,24 @@ struct ffmpeg_consumer : boost::noncopyable
 	
 	const safe_ptr<diagnostics::graph>		graph_;
 
+	executor								convert_executor_;
 	executor								encode_executor_;
+	executor								write_executor_;
 	
 	std::shared_ptr<AVStream>				audio_st_;
 	std::shared_ptr<AVStream>				video_st_;
 	
-	byte_vector								audio_outbuf_;
-	byte_vector								audio_buf_;
-	byte_vector								video_outbuf_;
+	// Owned by the conversion thread.
 	byte_vector								key_picture_buf_;
-	byte_vector								picture_buf_;
 	std::shared_ptr<audio_resampler>		swr_;
-	std::shared_ptr<SwsContext>				sws_;
-
+	std::vector<std::shared_ptr<SwsContext>> sws_;
 	int64_t									in_frame_number_;
 	int64_t									out_frame_number_;
 
+	// Owned by the encoding thread.
+	byte_vector								audio_buf_;
+	int64_t									audio_pts_;
+
 	output_format							output_format_;
 	bool									key_only_;
 	tbb::atomic<int64_t>					current_encoding_delay_;
@@ -244,13 +252,14 @@ struct ffmpeg_consumer : boost::noncopyable
 public:
 	ffmpeg_consumer(const std::string& filename, const core::video_format_desc& format_desc, std::vector<option> options, bool key_only, const core::channel_layout& audio_channel_layout)
 		: filename_(filename)
-		, video_outbuf_(1920*1080*8)
-		, audio_outbuf_(10000)
 		, format_desc_(format_desc)
 		, channel_layout_(audio_channel_layout)
-		, encode_executor_(print())
+		, convert_executor_(print() + L" convert")
+		, encode_executor_(print() + L" encode")
+		, write_executor_(print() + L" write")
 		, in_frame_number_(0)
 		, out_frame_number_(0)
+		, audio_pts_(0)
 		, output_format_(format_desc, filename, options)
 		, key_only_(key_only)
 	{
@@ -262,11 +271,14 @@ public:
 
 
 		graph_->set_color("frame-time", diagnostics::color(0.1f, 1.0f, 0.1f));
+		graph_->set_color("convert-time", diagnostics::color(0.1f, 0.6f, 1.0f));
 		graph_->set_color("dropped-frame", diagnostics::color(0.3f, 0.6f, 0.3f));
 		graph_->set_text(print());
 		diagnostics::register_graph(graph_);
 
-		encode_executor_.set_capacity(8);
+		convert_executor_.set_capacity(8);
+		encode_executor_.set_capacity(4);
+		write_executor_.set_capacity(16);
 				
 		AVFormatContext* oc;
 
@@ -304,9 +316,27 @@ public:
 
 	~ffmpeg_consumer()
 	{    
+		convert_executor_.stop();
+		convert_executor_.join();
+
+		try
+		{
+			encode_executor_.begin_invoke([this]
+			{
+				flush_encoders();
+			}).get();
+		}
+		catch(...)
+		{
+			CASPAR_LOG_CURRENT_EXCEPTION();
+		}
+
 		encode_executor_.stop();
 		encode_executor_.join();
 
+		write_executor_.stop();
+		write_executor_.join();
+
 		LOG_ON_ERROR2(av_write_trailer(oc_.get()), "[ffmpeg_consumer]");
 		
 		if (!key_only_)
@@ -408,9 +438,11 @@ public:
 			c->flags |= CODEC_FLAG_GLOBAL_HEADER;
 		
 		c->thread_count = boost::thread::hardware_concurrency();
+		c->thread_type	= FF_THREAD_FRAME | FF_THREAD_SLICE;
 		if(avcodec_open2(c, encoder, nullptr) < 0)
 		{
 			c->thread_count = 1;
+			c->thread_type	= 0;
 			THROW_ON_ERROR2(avcodec_open2(c, encoder, nullptr), "[ffmpeg_consumer]");
 		}
 
@@ -448,6 +480,9 @@ public:
 		if(output_format_.vcodec == CODEC_ID_FLV1)		
 			c->sample_rate	= 44100;		
 
+		c->time_base.num	= 1;
+		c->time_base.den	= c->sample_rate;
+
 		if(output_format_.format->flags & AVFMT_GLOBALHEADER)
 			c->flags |= CODEC_FLAG_GLOBAL_HEADER;
 				
@@ -466,13 +501,84 @@ public:
 		});
 	}
 
+	// Without scaling and vertical chroma subsampling every row converts
+	// independently, so the picture is split into horizontal slices that are
+	// converted in parallel with one context each.
+	int conversion_slices(AVCodecContext* c) const
+	{
+		auto desc = av_pix_fmt_desc_get(c->pix_fmt);
+
+		if(c->width != format_desc_.width || c->height != format_desc_.height || !desc || desc->log2_chroma_h != 0)
+			return 1;
+
+		return std::max(1, std::min<int>(boost::thread::hardware_concurrency(), format_desc_.height / 16));
+	}
+
+	// Formats that the fused conversion kernels produce directly. Fill or key
+	// is converted in one pass without going through swscale.
+	bool get_yuv_format(AVCodecContext* c, yuv_format::type& format) const
+	{
+		if(c->width != format_desc_.width || c->height != format_desc_.height)
+			return false;
+
+		switch(c->pix_fmt)
+		{
+		case PIX_FMT_UYVY422:		format = yuv_format::uyvy;		return true;
+		case PIX_FMT_YUV420P:		format = yuv_format::yuv420p;	return true;
+		case PIX_FMT_YUV422P10LE:	format = yuv_format::yuv422p10;	return true;
+		default:					return false;
+		}
+	}
+
 	std::shared_ptr<AVFrame> convert_video(core::read_frame& frame, AVCodecContext* c)
 	{
-		if(!sws_) 
+		// The picture travels to the encoding thread, so every frame gets its own buffer.
+		auto picture_buf = std::make_shared<byte_vector>(avpicture_get_size(c->pix_fmt, c->width, c->height));
+
+		std::shared_ptr<AVFrame> out_frame(avcodec_alloc_frame(), [picture_buf](AVFrame* p)
+		{
+			av_free(p);
+		});
+		avpicture_fill(reinterpret_cast<AVPicture*>(out_frame.get()), picture_buf->data(), c->pix_fmt, c->width, c->height);
+		out_frame->width	= c->width;
+		out_frame->height	= c->height;
+		out_frame->format	= c->pix_fmt;
+
+		yuv_format::type yuv;
+
+		if(get_yuv_format(c, yuv))
 		{
-			sws_.reset(sws_getContext(format_desc_.width, format_desc_.height, PIX_FMT_BGRA, c->width, c->height, c->pix_fmt, SWS_BICUBIC, nullptr, nullptr, nullptr), sws_freeContext);
-			if (sws_ == nullptr) 
-				BOOST_THROW_EXCEPTION(caspar_exception() << msg_info("Cannot initialize the conversion context"));
+			const yuv_image image(out_frame->data, out_frame->linesize);
+
+			// BT.601 is also what swscale uses by default, so the colors do not
+			// depend on which path converts the frame.
+			bgra_to_yuv(
+					frame.image_data().begin(), 
+					format_desc_.width, 
+					format_desc_.height, 
+					yuv, 
+					yuv_matrix::bt601, 
+					key_only_ ? nullptr : &image, 
+					key_only_ ? &image : nullptr);
+
+			return out_frame;
+		}
+
+		const int slices = conversion_slices(c);
+
+		if(sws_.empty())
+		{
+			for(int n = 0; n < slices; ++n)
+			{
+				int src_height = format_desc_.height * (n + 1) / slices - format_desc_.height * n / slices;
+				int dst_height = slices > 1 ? src_height : c->height;
+
+				std::shared_ptr<SwsContext> sws(sws_getContext(format_desc_.width, src_height, PIX_FMT_BGRA, c->width, dst_height, c->pix_fmt, SWS_BICUBIC, nullptr, nullptr, nullptr), sws_freeContext);
+				if (sws == nullptr)
+					BOOST_THROW_EXCEPTION(caspar_exception() << msg_info("Cannot initialize the conversion context"));
+
+				sws_.push_back(sws);
+			}
 		}
 
 		std::shared_ptr<AVFrame> in_frame(avcodec_alloc_frame(), av_free);
@@ -491,140 +597,206 @@ public:
 			avpicture_fill(in_picture, const_cast<uint8_t*>(frame.image_data().begin()), PIX_FMT_BGRA, format_desc_.width, format_desc_.height);
 		}
 
-		std::shared_ptr<AVFrame> out_frame(avcodec_alloc_frame(), av_free);
-		picture_buf_.resize(avpicture_get_size(c->pix_fmt, c->width, c->height));
-		avpicture_fill(reinterpret_cast<AVPicture*>(out_frame.get()), picture_buf_.data(), c->pix_fmt, c->width, c->height);
+		tbb::parallel_for(0, slices, [&](int n)
+		{
+			int begin	= format_desc_.height * n / slices;
+			int end		= format_desc_.height * (n + 1) / slices;
+
+			const uint8_t*	src[4]	= {};
+			uint8_t*		dst[4]	= {};
+
+			for(int plane = 0; plane < 4; ++plane)
+			{
+				if(in_frame->data[plane])
+					src[plane] = in_frame->data[plane] + begin * in_frame->linesize[plane];
+
+				if(out_frame->data[plane])
+					dst[plane] = out_frame->data[plane] + begin * out_frame->linesize[plane];
+			}
 
-		sws_scale(sws_.get(), in_frame->data, in_frame->linesize, 0, format_desc_.height, out_frame->data, out_frame->linesize);
+			sws_scale(sws_[n].get(), src, in_frame->linesize, 0, end - begin, dst, out_frame->linesize);
+		});
 
 		return out_frame;
 	}
-  
-	void encode_video_frame(core::read_frame& frame)
-	{ 
+
+	safe_ptr<AVPacket> create_packet()
+	{
+		safe_ptr<AVPacket> pkt(new AVPacket, [](AVPacket* p)
+		{
+			av_free_packet(p);
+			delete p;
+		});
+		av_init_packet(pkt.get());
+		pkt->data = nullptr;
+		pkt->size = 0;
+
+		return pkt;
+	}
+
+	void write_packet(const safe_ptr<AVPacket>& pkt, AVCodecContext* c, AVStream* st)
+	{
+		if (pkt->pts != AV_NOPTS_VALUE)
+			pkt->pts = av_rescale_q(pkt->pts, c->time_base, st->time_base);
+
+		if (pkt->dts != AV_NOPTS_VALUE)
+			pkt->dts = av_rescale_q(pkt->dts, c->time_base, st->time_base);
+
+		if (pkt->duration > 0)
+			pkt->duration = static_cast<int>(av_rescale_q(pkt->duration, c->time_base, st->time_base));
+
+		pkt->stream_index = st->index;
+
+		write_executor_.begin_invoke([=]
+		{
+			LOG_ON_ERROR2(av_interleaved_write_frame(oc_.get(), pkt.get()), "[ffmpeg_consumer]");
+		});
+	}
+
+	std::shared_ptr<AVFrame> convert_video_frame(core::read_frame& frame)
+	{
 		auto c = video_st_->codec;
-		
+
 		auto in_time  = static_cast<double>(in_frame_number_) / format_desc_.fps;
 		auto out_time = static_cast<double>(out_frame_number_) / (static_cast<double>(c->time_base.den) / static_cast<double>(c->time_base.num));
-		
+
 		in_frame_number_++;
 
 		if(out_time - in_time > 0.01)
-			return;
- 
+			return nullptr;
+
 		auto av_frame = convert_video(frame, c);
 		av_frame->interlaced_frame	= format_desc_.field_mode != core::field_mode::progressive;
 		av_frame->top_field_first	= format_desc_.field_mode == core::field_mode::upper;
 		av_frame->pts				= out_frame_number_++;
 
-		int out_size = THROW_ON_ERROR2(avcodec_encode_video(c, video_outbuf_.data(), video_outbuf_.size(), av_frame.get()), "[ffmpeg_consumer]");
-		if(out_size == 0)
-			return;
-				
-		safe_ptr<AVPacket> pkt(new AVPacket, [](AVPacket* p)
-		{
-			av_free_packet(p);
-			delete p;
-		});
-		av_init_packet(pkt.get());
- 
-		if (c->coded_frame->pts != AV_NOPTS_VALUE)
-			pkt->pts = av_rescale_q(c->coded_frame->pts, c->time_base, video_st_->time_base);
+		return av_frame;
+	}
+
+	void encode_video_frame(const std::shared_ptr<AVFrame>& av_frame)
+	{
+		auto c		= video_st_->codec;
+		auto pkt	= create_packet();
+		int got_packet = 0;
 
-		if(c->coded_frame->key_frame)
-			pkt->flags |= AV_PKT_FLAG_KEY;
+		THROW_ON_ERROR2(avcodec_encode_video2(c, pkt.get(), av_frame.get(), &got_packet), "[ffmpeg_consumer]");
 
-		pkt->stream_index	= video_st_->index;
-		pkt->data			= video_outbuf_.data();
-		pkt->size			= out_size;
- 			
-		av_interleaved_write_frame(oc_.get(), pkt.get());		
+		if(got_packet)
+			write_packet(pkt, c, video_st_.get());
 	}
-		
+
 	byte_vector convert_audio(core::read_frame& frame, AVCodecContext* c)
 	{
-		if(!swr_) 		
-			swr_.reset(new audio_resampler(c->channels, frame.num_channels(), 
+		if(!swr_)
+			swr_.reset(new audio_resampler(c->channels, frame.num_channels(),
 										   c->sample_rate, format_desc_.audio_sample_rate,
 										   c->sample_fmt, AV_SAMPLE_FMT_S32));
-		
+
 
 		auto audio_data = frame.audio_data();
 
-		std::vector<int8_t,  tbb::cache_aligned_allocator<int8_t>> audio_resample_buffer;
-		std::copy(reinterpret_cast<const uint8_t*>(audio_data.begin()), 
-				  reinterpret_cast<const uint8_t*>(audio_data.begin()) + audio_data.size()*4, 
-				  std::back_inserter(audio_resample_buffer));
-		
+		std::vector<int8_t,  tbb::cache_aligned_allocator<int8_t>> audio_resample_buffer(
+				reinterpret_cast<const int8_t*>(audio_data.begin()),
+				reinterpret_cast<const int8_t*>(audio_data.begin()) + audio_data.size()*4);
+
 		audio_resample_buffer = swr_->resample(std::move(audio_resample_buffer));
-		
+
 		return byte_vector(audio_resample_buffer.begin(), audio_resample_buffer.end());
 	}
 
-	void encode_audio_frame(core::read_frame& frame)
-	{			
+	void encode_audio_frame(const byte_vector& samples)
+	{
 		auto c = audio_st_->codec;
 
-		boost::range::push_back(audio_buf_, convert_audio(frame, c));
-		
-		std::size_t frame_size = c->frame_size;
-		auto input_audio_size = frame_size * av_get_bytes_per_sample(c->sample_fmt) * c->channels;
-		
-		while(audio_buf_.size() >= input_audio_size)
+		boost::range::push_back(audio_buf_, samples);
+
+		const int bytes_per_sample	= av_get_bytes_per_sample(c->sample_fmt) * c->channels;
+		const int frame_size		= c->frame_size > 1 ? c->frame_size : static_cast<int>(audio_buf_.size()) / bytes_per_sample; // PCM takes any number of samples.
+		const size_t input_audio_size = frame_size * bytes_per_sample;
+
+		while(frame_size > 0 && audio_buf_.size() >= input_audio_size)
 		{
-			safe_ptr<AVPacket> pkt(new AVPacket, [](AVPacket* p)
-			{
-				av_free_packet(p);
-				delete p;
-			});
-			av_init_packet(pkt.get());
+			std::shared_ptr<AVFrame> av_frame(avcodec_alloc_frame(), av_free);
+			av_frame->nb_samples	= frame_size;
+			av_frame->pts			= audio_pts_;
 
-			if(frame_size > 1)
-			{								
-				pkt->size = avcodec_encode_audio(c, audio_outbuf_.data(), audio_outbuf_.size(), reinterpret_cast<short*>(audio_buf_.data()));
-				audio_buf_.erase(audio_buf_.begin(), audio_buf_.begin() + input_audio_size);
-			}
-			else
+			THROW_ON_ERROR2(avcodec_fill_audio_frame(av_frame.get(), c->channels, c->sample_fmt, audio_buf_.data(), input_audio_size, 0), "[ffmpeg_consumer]");
+
+			auto pkt = create_packet();
+			int got_packet = 0;
+
+			THROW_ON_ERROR2(avcodec_encode_audio2(c, pkt.get(), av_frame.get(), &got_packet), "[ffmpeg_consumer]");
+
+			audio_pts_ += frame_size;
+			audio_buf_.erase(audio_buf_.begin(), audio_buf_.begin() + input_audio_size);
+
+			if(got_packet)
+				write_packet(pkt, c, audio_st_.get());
+		}
+	}
+
+	void flush_encoders()
+	{
+		std::vector<std::shared_ptr<AVStream>> streams;
+		streams.push_back(video_st_);
+		streams.push_back(audio_st_);
+
+		BOOST_FOREACH(auto& st, streams)
+		{
+			if(!st || !(st->codec->codec->capabilities & CODEC_CAP_DELAY))
+				continue;
+
+			auto c = st->codec;
+
+			for(int got_packet = 1; got_packet;)
 			{
-				audio_outbuf_ = std::move(audio_buf_);		
-				audio_buf_.clear();
-				pkt->size = audio_outbuf_.size();
-				pkt->data = audio_outbuf_.data();
-			}
-		
-			if(pkt->size == 0)
-				return;
+				auto pkt = create_packet();
 
-			if (c->coded_frame && c->coded_frame->pts != AV_NOPTS_VALUE)
-				pkt->pts = av_rescale_q(c->coded_frame->pts, c->time_base, audio_st_->time_base);
+				if(c->codec_type == AVMEDIA_TYPE_VIDEO)
+					THROW_ON_ERROR2(avcodec_encode_video2(c, pkt.get(), nullptr, &got_packet), "[ffmpeg_consumer]");
+				else
+					THROW_ON_ERROR2(avcodec_encode_audio2(c, pkt.get(), nullptr, &got_packet), "[ffmpeg_consumer]");
 
-			pkt->flags		 |= AV_PKT_FLAG_KEY;
-			pkt->stream_index = audio_st_->index;
-			pkt->data		  = reinterpret_cast<uint8_t*>(audio_outbuf_.data());
-		
-			av_interleaved_write_frame(oc_.get(), pkt.get());
+				if(got_packet)
+					write_packet(pkt, c, st.get());
+			}
 		}
 	}
-		 
+
 	void send(const safe_ptr<core::read_frame>& frame)
 	{
-		encode_executor_.begin_invoke([=]
-		{		
-			boost::timer frame_timer;
+		convert_executor_.begin_invoke([=]
+		{
+			boost::timer convert_timer;
 
-			encode_video_frame(*frame);
+			auto av_frame	= convert_video_frame(*frame);
+			auto samples	= std::make_shared<byte_vector>();
 
 			if (!key_only_)
-				encode_audio_frame(*frame);
+				*samples = convert_audio(*frame, audio_st_->codec);
+
+			graph_->set_value("convert-time", convert_timer.elapsed()*format_desc_.fps*0.5);
+
+			// Blocks while the encoder is behind.
+			encode_executor_.begin_invoke([=]
+			{
+				boost::timer frame_timer;
 
-			graph_->set_value("frame-time", frame_timer.elapsed()*format_desc_.fps*0.5);
-			current_encoding_delay_ = frame->get_age_millis();
+				if (av_frame)
+					encode_video_frame(av_frame);
+
+				if (!key_only_)
+					encode_audio_frame(*samples);
+
+				graph_->set_value("frame-time", frame_timer.elapsed()*format_desc_.fps*0.5);
+				current_encoding_delay_ = frame->get_age_millis();
+			});
 		});
 	}
 
 	bool ready_for_frame()
 	{
-		return encode_executor_.size() < encode_executor_.capacity();
+		return convert_executor_.size() < convert_executor_.capacity();
 	}
 
 	void mark_dropped()
@@ -35,6 +35,7 @@
 #include <tbb/parallel_for.h>
 
 #include <agents.h>
+#include <functional>
 #include <numeric>
 
 #pragma warning(push)
@@ -71,6 +72,297 @@ int crc16(const std::string& str)
 	return result.checksum();
 }
 
+std::map<std::string, std::string> parse_options(const std::string& options)
+{
+	std::map<std::string, std::string> result;
+
+	for(auto it = 
+			boost::sregex_iterator(
+				options.begin(), 
+				options.end(), 
+				boost::regex("-(?<NAME>[^-\\s]+)(\\s+(?<VALUE>[^\\s]+))?")); 
+		it != boost::sregex_iterator(); 
+		++it)
+	{				
+		result[(*it)["NAME"].str()] = (*it)["VALUE"].matched ? (*it)["VALUE"].str() : "";
+	}
+
+	return result;
+}
+
+template<typename T>
+boost::optional<T> try_remove_arg(
+	std::map<std::string, std::string>& options, 
+	const boost::regex& expr)
+{
+	for(auto it = options.begin(); it != options.end(); ++it)
+	{			
+		if(boost::regex_search(it->first, expr))
+		{
+			auto arg = it->second;
+			options.erase(it);
+			return boost::lexical_cast<T>(arg);
+		}
+	}
+
+	return boost::optional<T>();
+}
+	
+std::map<std::string, std::string> remove_options(
+	std::map<std::string, std::string>& options, 
+	const boost::regex& expr)
+{
+	std::map<std::string, std::string> result;
+		
+	auto it = options.begin();
+	while(it != options.end())
+	{			
+		boost::smatch what;
+		if(boost::regex_search(it->first, what, expr))
+		{
+			result[
+				what.size() > 0 && what[1].matched 
+					? what[1].str() 
+					: it->first] = it->second;
+			it = options.erase(it);
+		}
+		else
+			++it;
+	}
+
+	return result;
+}
+	
+void to_dict(AVDictionary** dest, const std::map<std::string, std::string>& c)
+{		
+	BOOST_FOREACH(const auto& entry, c)
+	{
+		av_dict_set(
+			dest, 
+			entry.first.c_str(), 
+			entry.second.c_str(), 0);
+	}
+}
+
+std::map<std::string, std::string> to_map(AVDictionary* dict)
+{
+	std::map<std::string, std::string> result;
+	
+	for(auto t = dict 
+			? av_dict_get(
+				dict, 
+				"", 
+				nullptr, 
+				AV_DICT_IGNORE_SUFFIX) 
+			: nullptr;
+		t; 
+		t = av_dict_get(
+			dict, 
+			"", 
+			t,
+			AV_DICT_IGNORE_SUFFIX))
+	{
+		result[t->key] = t->value;
+	}
+
+	return result;
+}
+
+void configure_filtergraph(
+	AVFilterGraph& graph, 
+	const std::string& filtergraph, 
+	AVFilterContext& source_ctx, 
+	AVFilterContext& sink_ctx)
+{
+	AVFilterInOut* outputs = nullptr;
+	AVFilterInOut* inputs = nullptr;
+
+	try
+	{
+		if(!filtergraph.empty())
+		{
+			outputs = avfilter_inout_alloc();
+			inputs  = avfilter_inout_alloc();
+
+			CASPAR_VERIFY(outputs && inputs);
+
+			outputs->name       = av_strdup("in");
+			outputs->filter_ctx = &source_ctx;
+			outputs->pad_idx    = 0;
+			outputs->next       = nullptr;
+
+			inputs->name        = av_strdup("out");
+			inputs->filter_ctx  = &sink_ctx;
+			inputs->pad_idx     = 0;
+			inputs->next        = nullptr;
+
+			FF(avfilter_graph_parse(
+				&graph, 
+				filtergraph.c_str(), 
+				&inputs, 
+				&outputs, 
+				nullptr));
+		} 
+		else 
+		{
+			FF(avfilter_link(
+				&source_ctx, 
+				0, 
+				&sink_ctx, 
+				0));
+		}
+
+		FF(avfilter_graph_config(
+			&graph, 
+			nullptr));
+	}
+	catch(...)
+	{
+		avfilter_inout_free(&outputs);
+		avfilter_inout_free(&inputs);
+		throw;
+	}
+}
+
+std::shared_ptr<AVStream> open_encoder(
+	AVFormatContext& oc,
+	const AVCodec& codec, 
+	AVFilterContext& sink,
+	std::map<std::string, std::string>& options)
+{			
+	auto st = 
+		avformat_new_stream(
+			&oc, 
+			&codec);
+
+	if (!st) 		
+		BOOST_THROW_EXCEPTION(caspar_exception() << msg_info("Could not allocate video-stream.") << boost::errinfo_api_function("av_new_stream"));	
+
+	auto enc = st->codec;
+			
+	CASPAR_VERIFY(enc);
+					
+	switch(enc->codec_type)
+	{
+		case AVMEDIA_TYPE_VIDEO:
+		{				
+			enc->time_base			  = sink.inputs[0]->time_base;
+			enc->pix_fmt			  = static_cast<AVPixelFormat>(sink.inputs[0]->format);
+			enc->sample_aspect_ratio  = st->sample_aspect_ratio = sink.inputs[0]->sample_aspect_ratio;
+			enc->width				  = sink.inputs[0]->w;
+			enc->height				  = sink.inputs[0]->h;
+		
+			break;
+		}
+		case AVMEDIA_TYPE_AUDIO:
+		{
+			enc->time_base			  = sink.inputs[0]->time_base;
+			enc->sample_fmt			  = static_cast<AVSampleFormat>(sink.inputs[0]->format);
+			enc->sample_rate		  = sink.inputs[0]->sample_rate;
+			enc->channel_layout		  = sink.inputs[0]->channel_layout;
+			enc->channels			  = sink.inputs[0]->channels;
+		
+			break;
+		}
+	}
+									
+	if(oc.oformat->flags & AVFMT_GLOBALHEADER)
+		enc->flags |= CODEC_FLAG_GLOBAL_HEADER;
+	
+	static const std::array<std::string, 4> char_id_map = {{"v", "a", "d", "s"}};
+
+	const auto char_id = char_id_map.at(enc->codec_type);
+							
+	const auto codec_opts = 
+		remove_options(
+			options, 
+			boost::regex("^(" + char_id + "?[^:]+):" + char_id + "$"));
+	
+	AVDictionary* av_codec_opts = nullptr;
+
+	to_dict(
+		&av_codec_opts, 
+		options);
+
+	to_dict(
+		&av_codec_opts,
+		codec_opts);
+
+	options.clear();
+	
+	FF(avcodec_open2(
+		enc,		
+		&codec, 
+		av_codec_opts ? &av_codec_opts : nullptr));		
+
+	if(av_codec_opts)
+	{
+		auto t = 
+			av_dict_get(
+				av_codec_opts, 
+				"", 
+				 nullptr, 
+				AV_DICT_IGNORE_SUFFIX);
+
+		while(t)
+		{
+			options[t->key + (codec_opts.find(t->key) != codec_opts.end() ? ":" + char_id : "")] = t->value;
+
+			t = av_dict_get(
+					av_codec_opts, 
+					"", 
+					t, 
+					AV_DICT_IGNORE_SUFFIX);
+		}
+
+		av_dict_free(&av_codec_opts);
+	}
+			
+	if(enc->codec_type == AVMEDIA_TYPE_AUDIO && !(codec.capabilities & CODEC_CAP_VARIABLE_FRAME_SIZE))
+	{
+		CASPAR_ASSERT(enc->frame_size > 0);
+		av_buffersink_set_frame_size(&sink, 
+									 enc->frame_size);
+	}
+	
+	return std::shared_ptr<AVStream>(st, [](AVStream* st)
+	{
+		avcodec_close(st->codec);
+	});
+}
+
+// Protocol urls and pipes are passed through, plain files are made relative to
+// the media folder.
+boost::filesystem::path resolve_output_path(
+	boost::filesystem::path path, 
+	bool overwrite)
+{
+	static boost::regex prot_exp("^.+:.*" );
+
+	if(boost::regex_match(
+			path.string(), 
+			prot_exp))
+		return path;
+
+	if(!path.is_complete())
+	{
+		path = 
+			narrow(
+				env::media_folder()) + 
+				path.string();
+	}
+			
+	if(boost::filesystem::exists(path))
+	{
+		if(!overwrite)
+			BOOST_THROW_EXCEPTION(invalid_argument() << msg_info("File exists"));
+					
+		boost::filesystem::remove(path);
+	}
+
+	return path;
+}
+
 class streaming_consumer sealed : public core::frame_consumer
 {
 public:
@@ -132,16 +424,7 @@ public:
 	{		
 		abort_request_ = false;	
 
-		for(auto it = 
-				boost::sregex_iterator(
-					options.begin(), 
-					options.end(), 
-					boost::regex("-(?<NAME>[^-\\s]+)(\\s+(?<VALUE>[^\\s]+))?")); 
-			it != boost::sregex_iterator(); 
-			++it)
-		{				
-			options_[(*it)["NAME"].str()] = (*it)["VALUE"].matched ? (*it)["VALUE"].str() : "";
-		}
+		options_ = parse_options(options);
 										
         if (options_.find("threads") == options_.end())
             options_["threads"] = "auto";
@@ -192,33 +475,12 @@ public:
 	{
 		try
 		{				
-			static boost::regex prot_exp("^.+:.*" );
-			
 			const auto overwrite = 
 				try_remove_arg<std::string>(
 					options_,
 					boost::regex("y")) != nullptr;
 
-			if(!boost::regex_match(
-					path_.string(), 
-					prot_exp))
-			{
-				if(!path_.is_complete())
-				{
-					path_ = 
-						narrow(
-							env::media_folder()) + 
-							path_.string();
-				}
-			
-				if(boost::filesystem::exists(path_))
-				{
-					if(!overwrite)
-						BOOST_THROW_EXCEPTION(invalid_argument() << msg_info("File exists"));
-						
-					boost::filesystem::remove(path_);
-				}
-			}
+			path_ = resolve_output_path(path_, overwrite);
 							
 			const auto oformat_name = 
 				try_remove_arg<std::string>(
@@ -309,11 +571,15 @@ public:
 				auto audio_options = options_;
 
 				video_st_ = open_encoder(
+					*oc_,
 					*video_codec, 
+					*video_graph_out_,
 					video_options);
 
 				audio_st_ = open_encoder(
+					*oc_,
 					*audio_codec, 
+					*audio_graph_out_,
 					audio_options);
 
 				auto it = options_.begin();
@@ -458,112 +724,6 @@ private:
 		return reinterpret_cast<streaming_consumer*>(ctx)->abort_request_;		
 	}
 		
-	std::shared_ptr<AVStream> open_encoder(
-		const AVCodec& codec, 
-		std::map<std::string, 
-		std::string>& options)
-	{			
-		auto st = 
-			avformat_new_stream(
-				oc_.get(), 
-				&codec);
-
-		if (!st) 		
-			BOOST_THROW_EXCEPTION(caspar_exception() << msg_info("Could not allocate video-stream.") << boost::errinfo_api_function("av_new_stream"));	
-
-		auto enc = st->codec;
-				
-		CASPAR_VERIFY(enc);
-						
-		switch(enc->codec_type)
-		{
-			case AVMEDIA_TYPE_VIDEO:
-			{				
-				enc->time_base			  = video_graph_out_->inputs[0]->time_base;
-				enc->pix_fmt			  = static_cast<AVPixelFormat>(video_graph_out_->inputs[0]->format);
-				enc->sample_aspect_ratio  = st->sample_aspect_ratio = video_graph_out_->inputs[0]->sample_aspect_ratio;
-				enc->width				  = video_graph_out_->inputs[0]->w;
-				enc->height				  = video_graph_out_->inputs[0]->h;
-			
-				break;
-			}
-			case AVMEDIA_TYPE_AUDIO:
-			{
-				enc->time_base			  = audio_graph_out_->inputs[0]->time_base;
-				enc->sample_fmt			  = static_cast<AVSampleFormat>(audio_graph_out_->inputs[0]->format);
-				enc->sample_rate		  = audio_graph_out_->inputs[0]->sample_rate;
-				enc->channel_layout		  = audio_graph_out_->inputs[0]->channel_layout;
-				enc->channels			  = audio_graph_out_->inputs[0]->channels;
-			
-				break;
-			}
-		}
-										
-		if(oc_->oformat->flags & AVFMT_GLOBALHEADER)
-			enc->flags |= CODEC_FLAG_GLOBAL_HEADER;
-		
-		static const std::array<std::string, 4> char_id_map = {{"v", "a", "d", "s"}};
-
-		const auto char_id = char_id_map.at(enc->codec_type);
-								
-		const auto codec_opts = 
-			remove_options(
-				options, 
-				boost::regex("^(" + char_id + "?[^:]+):" + char_id + "$"));
-		
-		AVDictionary* av_codec_opts = nullptr;
-
-		to_dict(
-			&av_codec_opts, 
-			options);
-
-		to_dict(
-			&av_codec_opts,
-			codec_opts);
-
-		options.clear();
-		
-		FF(avcodec_open2(
-			enc,		
-			&codec, 
-			av_codec_opts ? &av_codec_opts : nullptr));		
-
-		if(av_codec_opts)
-		{
-			auto t = 
-				av_dict_get(
-					av_codec_opts, 
-					"", 
-					 nullptr, 
-					AV_DICT_IGNORE_SUFFIX);
-
-			while(t)
-			{
-				options[t->key + (codec_opts.find(t->key) != codec_opts.end() ? ":" + char_id : "")] = t->value;
-
-				t = av_dict_get(
-						av_codec_opts, 
-						"", 
-						t, 
-						AV_DICT_IGNORE_SUFFIX);
-			}
-
-			av_dict_free(&av_codec_opts);
-		}
-				
-		if(enc->codec_type == AVMEDIA_TYPE_AUDIO && !(codec.capabilities & CODEC_CAP_VARIABLE_FRAME_SIZE))
-		{
-			CASPAR_ASSERT(enc->frame_size > 0);
-			av_buffersink_set_frame_size(audio_graph_out_, 
-										 enc->frame_size);
-		}
-		
-		return std::shared_ptr<AVStream>(st, [this](AVStream* st)
-		{
-			avcodec_close(st->codec);
-		});
-	}
-
 	void configue_audio_bistream_filters(std::map<std::string, std::string>& options)
 	{
 		const auto audio_bitstream_filter_str = 
@@ -780,62 +940,6 @@ private:
 					nullptr));
 	}
 
-	void configure_filtergraph(
-		AVFilterGraph& graph, 
-		const std::string& filtergraph, 
-		AVFilterContext& source_ctx, 
-		AVFilterContext& sink_ctx)
-	{
-		AVFilterInOut* outputs = nullptr;
-		AVFilterInOut* inputs = nullptr;
-
-		try
-		{
-			if(!filtergraph.empty())
-			{
-				outputs = avfilter_inout_alloc();
-				inputs  = avfilter_inout_alloc();
-
-				CASPAR_VERIFY(outputs && inputs);
-
-				outputs->name       = av_strdup("in");
-				outputs->filter_ctx = &source_ctx;
-				outputs->pad_idx    = 0;
-				outputs->next       = nullptr;
-
-				inputs->name        = av_strdup("out");
-				inputs->filter_ctx  = &sink_ctx;
-				inputs->pad_idx     = 0;
-				inputs->next        = nullptr;
-
-				FF(avfilter_graph_parse(
-					&graph, 
-					filtergraph.c_str(), 
-					&inputs, 
-					&outputs, 
-					nullptr));
-			} 
-			else 
-			{
-				FF(avfilter_link(
-					&source_ctx, 
-					0, 
-					&sink_ctx, 
-					0));
-			}
-
-			FF(avfilter_graph_config(
-				&graph, 
-				nullptr));
-		}
-		catch(...)
-		{
-			avfilter_inout_free(&outputs);
-			avfilter_inout_free(&inputs);
-			throw;
-		}
-	}
-	
 	void encode_video(
 		const std::shared_ptr<core::read_frame>& frame_ptr, 
 		std::shared_ptr<void> token)
@@ -1174,100 +1278,967 @@ private:
 		});	
 	}	
 	
-	template<typename T>
-	static boost::optional<T> try_remove_arg(
-		std::map<std::string, std::string>& options, 
-		const boost::regex& expr)
-	{
-		for(auto it = options.begin(); it != options.end(); ++it)
-		{			
-			if(boost::regex_search(it->first, expr))
-			{
-				auto arg = it->second;
-				options.erase(it);
-				return boost::lexical_cast<T>(arg);
-			}
-		}
+};
 
-		return boost::optional<T>();
-	}
-		
-	static std::map<std::string, std::string> remove_options(
-		std::map<std::string, std::string>& options, 
-		const boost::regex& expr)
+struct rendition_desc
+{
+	std::string							path;
+	int									width;
+	int									height;
+	std::map<std::string, std::string>	options;
+
+	rendition_desc()
+		: width(0)
+		, height(0)
 	{
-		std::map<std::string, std::string> result;
-			
-		auto it = options.begin();
-		while(it != options.end())
-		{			
-			boost::smatch what;
-			if(boost::regex_search(it->first, what, expr))
-			{
-				result[
-					what.size() > 0 && what[1].matched 
-						? what[1].str() 
-						: it->first] = it->second;
-				it = options.erase(it);
-			}
-			else
-				++it;
-		}
-
-		return result;
-	}
-		
-	static void to_dict(AVDictionary** dest, const std::map<std::string, std::string>& c)
-	{		
-		BOOST_FOREACH(const auto& entry, c)
-		{
-			av_dict_set(
-				dest, 
-				entry.first.c_str(), 
-				entry.second.c_str(), 0);
-		}
 	}
+};
 
-	static std::map<std::string, std::string> to_map(AVDictionary* dict)
+// Publishes several renditions of the channel from one conversion pass. The
+// channel frame is converted once to the encoder pixel format and then split
+// into one scaler per rendition. Every rendition has its own encoder and muxer
+// thread, so the renditions encode in parallel.
+class multi_rendition_consumer sealed : public core::frame_consumer
+{
+	struct rendition : boost::noncopyable
 	{
-		std::map<std::string, std::string> result;
-		
-		for(auto t = dict 
-				? av_dict_get(
-					dict, 
-					"", 
-					nullptr, 
-					AV_DICT_IGNORE_SUFFIX) 
-				: nullptr;
-			t; 
-			t = av_dict_get(
-				dict, 
-				"", 
-				t,
-				AV_DICT_IGNORE_SUFFIX))
+		const rendition_desc				desc;
+		std::map<std::string, std::string>	options;
+		std::shared_ptr<AVFormatContext>	oc;
+		const AVCodec*						video_codec;
+		const AVCodec*						audio_codec;
+		AVFilterContext*					video_sink;
+		AVFilterContext*					audio_sink;
+		std::shared_ptr<AVStream>			video_st;
+		std::shared_ptr<AVStream>			audio_st;
+
+		executor							encoder;
+		executor							writer;
+
+		rendition(const rendition_desc& desc, const std::wstring& name)
+			: desc(desc)
+			, options(desc.options)
+			, video_codec(nullptr)
+			, audio_codec(nullptr)
+			, video_sink(nullptr)
+			, audio_sink(nullptr)
+			, encoder(name + L" encoder")
+			, writer(name + L" io")
 		{
-			result[t->key] = t->value;
+			encoder.set_capacity(8);
+			writer.set_capacity(32);
 		}
 
-		return result;
-	}
-};
-	
-safe_ptr<core::frame_consumer> create_streaming_consumer(const core::parameters& params)
-{       
-	if (params.size() < 1 || params[0] != L"STREAM")
-		return core::frame_consumer::empty();
+		// Encodes one filtered frame, or drains the encoder when frame is null.
+		void encode(
+			const std::shared_ptr<AVStream>& st, 
+			const std::shared_ptr<AVFrame>& frame)
+		{
+			auto enc = st->codec;
 
-	auto path = narrow(params.at_original(1));
-	auto args = narrow(params.get_original_string(2));
+			if(!frame && !(enc->codec->capabilities & CODEC_CAP_DELAY))
+				return;
 
-	return make_safe<streaming_consumer>(path, args);
-}
+			if(frame && enc->codec_type == AVMEDIA_TYPE_VIDEO)
+			{
+				if (frame->interlaced_frame) 
+				{
+					if (enc->codec->id == AV_CODEC_ID_MJPEG)
+						enc->field_order = frame->top_field_first ? AV_FIELD_TT : AV_FIELD_BB;
+					else
+						enc->field_order = frame->top_field_first ? AV_FIELD_TB : AV_FIELD_BT;
+				} 
+				else
+					enc->field_order = AV_FIELD_PROGRESSIVE;
 
-safe_ptr<core::frame_consumer> create_streaming_consumer(const boost::property_tree::wptree& ptree)
-{              	
-    return make_safe<streaming_consumer>(
-		narrow(ptree.get<std::wstring>(L"path")), 
+				frame->quality	 = enc->global_quality;
+				frame->pict_type = AV_PICTURE_TYPE_NONE;
+			}
+
+			while(true)
+			{
+				AVPacket pkt = {};
+				av_init_packet(&pkt);
+
+				int got_packet = 0;
+
+				if(enc->codec_type == AVMEDIA_TYPE_VIDEO)
+					FF(avcodec_encode_video2(enc, &pkt, frame.get(), &got_packet));
+				else
+					FF(avcodec_encode_audio2(enc, &pkt, frame.get(), &got_packet));
+
+				if(!got_packet || pkt.size <= 0)
+				{
+					av_free_packet(&pkt);
+					return;
+				}
+
+				pkt.stream_index = st->index;
+
+				if (pkt.pts != AV_NOPTS_VALUE)
+					pkt.pts = av_rescale_q(pkt.pts, enc->time_base, st->time_base);
+
+				if (pkt.dts != AV_NOPTS_VALUE)
+					pkt.dts = av_rescale_q(pkt.dts, enc->time_base, st->time_base);
+
+				pkt.duration = static_cast<int>(av_rescale_q(pkt.duration, enc->time_base, st->time_base));
+
+				std::shared_ptr<AVPacket> pkt_ptr(
+					new AVPacket(pkt), 
+					[](AVPacket* p)
+					{
+						av_free_packet(p); 
+						delete p;
+					});
+
+				auto oc = this->oc;
+
+				writer.begin_invoke([oc, pkt_ptr]
+				{
+					FF(av_interleaved_write_frame(
+						oc.get(), 
+						pkt_ptr.get()));
+				});
+
+				if(frame)
+					return;
+			}
+		}
+	};
+
+	std::vector<rendition_desc>					descs_;
+	std::string									video_filter_;
+	std::string									audio_filter_;
+	int											consumer_index_offset_;
+
+	core::video_format_desc						in_video_format_;
+	core::channel_layout						in_channel_layout_;
+	tbb::atomic<bool>							abort_request_;
+
+	std::vector<std::shared_ptr<rendition>>		renditions_;
+
+	std::int64_t								video_pts_;
+	std::int64_t								audio_pts_;
+
+	AVFilterContext*							video_graph_in_;
+	std::shared_ptr<AVFilterGraph>				video_graph_;
+	AVFilterContext*							audio_graph_in_;
+	std::shared_ptr<AVFilterGraph>				audio_graph_;
+
+	executor									executor_;
+
+public:
+
+	multi_rendition_consumer(
+		std::vector<rendition_desc> descs, 
+		std::string options)
+		: descs_(std::move(descs))
+		, consumer_index_offset_(0)
+		, video_pts_(0)
+		, audio_pts_(0)
+		, video_graph_in_(nullptr)
+		, audio_graph_in_(nullptr)
+		, executor_(L"multi_rendition_consumer")
+	{
+		abort_request_ = false;
+
+		if(descs_.empty())
+			BOOST_THROW_EXCEPTION(invalid_argument() << msg_info("No renditions specified"));
+
+		auto common_options = parse_options(options);
+
+		if (common_options.find("threads") == common_options.end())
+			common_options["threads"] = "auto";
+
+		// The filters run before the split, so they are shared by all renditions.
+		video_filter_ = try_remove_arg<std::string>(common_options, boost::regex("vf|f:v|filter:v")).get_value_or("");
+		audio_filter_ = try_remove_arg<std::string>(common_options, boost::regex("af|f:a|filter:a")).get_value_or("");
+
+		// Options with a ":<n>" suffix only apply to the n:th rendition.
+		const auto indexed = remove_options(common_options, boost::regex("^.+:\\d+$"));
+
+		std::string paths;
+
+		for(size_t n = 0; n < descs_.size(); ++n)
+		{
+			auto rendition_options = common_options;
+
+			BOOST_FOREACH(const auto& option, indexed)
+			{
+				const auto pos = option.first.find_last_of(':');
+
+				if(boost::lexical_cast<size_t>(option.first.substr(pos + 1)) == n)
+					rendition_options[option.first.substr(0, pos)] = option.second;
+			}
+
+			BOOST_FOREACH(const auto& option, descs_[n].options)
+				rendition_options[option.first] = option.second;
+
+			descs_[n].options = std::move(rendition_options);
+			paths += descs_[n].path;
+		}
+
+		consumer_index_offset_ = crc16(paths);
+
+		executor_.set_capacity(8);
+	}
+
+	~multi_rendition_consumer()
+	{
+		executor_.invoke([this]
+		{
+			close();
+		});
+	}
+
+	void initialize(
+		const core::video_format_desc& format_desc,
+		const core::channel_layout& audio_channel_layout,
+		int channel_index) override
+	{
+		executor_.invoke([&]
+		{
+			close();
+
+			try
+			{
+				open(format_desc, audio_channel_layout);
+			}
+			catch(...)
+			{
+				renditions_.clear();
+				video_graph_.reset();
+				audio_graph_.reset();
+				throw;
+			}
+		});
+	}
+
+	boost::unique_future<bool> send(const safe_ptr<core::read_frame>& frame) override
+	{
+		CASPAR_VERIFY(in_video_format_.format != core::video_format::invalid);
+
+		// Blocks while the filter graph is behind, which in turn blocks while
+		// the slowest encoder is behind.
+		return executor_.begin_invoke([=]() -> bool
+		{
+			push_video(*frame);
+			push_audio(*frame);
+
+			BOOST_FOREACH(const auto& r, renditions_)
+			{
+				pull(r, r->video_sink, r->video_st);
+				pull(r, r->audio_sink, r->audio_st);
+			}
+
+			return true;
+		});
+	}
+
+	std::wstring print() const override
+	{
+		return L"multi_rendition_consumer[" + widen(descs_.front().path) + (descs_.size() > 1 ? L"..." : L"") + L"]";
+	}
+
+	virtual boost::property_tree::wptree info() const override
+	{
+		boost::property_tree::wptree info;
+		info.add(L"type", L"multi-rendition-consumer");
+
+		BOOST_FOREACH(const auto& desc, descs_)
+		{
+			auto& rendition = info.add(L"renditions.rendition", L"");
+			rendition.add(L"path", widen(desc.path));
+			rendition.add(L"width", desc.width);
+			rendition.add(L"height", desc.height);
+		}
+
+		return info;
+	}
+
+	bool has_synchronization_clock() const override
+	{
+		return false;
+	}
+
+	int buffer_depth() const override
+	{
+		return -1;
+	}
+
+	int index() const override
+	{
+		return 100000 + consumer_index_offset_;
+	}
+
+	int64_t presentation_frame_age_millis() const override
+	{
+		return 0;
+	}
+
+private:
+
+	static int interrupt_cb(void* ctx)
+	{
+		CASPAR_ASSERT(ctx);
+		return reinterpret_cast<multi_rendition_consumer*>(ctx)->abort_request_;		
+	}
+
+	void open(
+		const core::video_format_desc& format_desc,
+		const core::channel_layout& audio_channel_layout)
+	{
+		CASPAR_VERIFY(format_desc.format != core::video_format::invalid);
+
+		in_video_format_	= format_desc;
+		in_channel_layout_	= audio_channel_layout;
+		video_pts_			= 0;
+		audio_pts_			= 0;
+
+		for(size_t n = 0; n < descs_.size(); ++n)
+		{
+			auto r = std::make_shared<rendition>(descs_[n], print() + L"[" + boost::lexical_cast<std::wstring>(n) + L"]");
+
+			const auto overwrite = 
+				try_remove_arg<std::string>(
+					r->options,
+					boost::regex("y")) != nullptr;
+
+			const auto path = resolve_output_path(r->desc.path, overwrite).string();
+
+			const auto oformat_name = 
+				try_remove_arg<std::string>(
+					r->options, 
+					boost::regex("^f|format$"));
+
+			AVFormatContext* oc;
+
+			FF(avformat_alloc_output_context2(
+				&oc, 
+				nullptr, 
+				oformat_name && !oformat_name->empty() ? oformat_name->c_str() : nullptr, 
+				path.c_str()));
+
+			r->oc.reset(
+				oc, 
+				avformat_free_context);
+
+			CASPAR_VERIFY(r->oc->oformat);
+
+			r->oc->interrupt_callback.callback = multi_rendition_consumer::interrupt_cb;
+			r->oc->interrupt_callback.opaque   = this;
+
+			const auto video_codec_name = 
+				try_remove_arg<std::string>(
+					r->options, 
+					boost::regex("^c:v|codec:v|vcodec$"));
+
+			r->video_codec = 
+				video_codec_name 
+					? avcodec_find_encoder_by_name(video_codec_name->c_str())
+					: avcodec_find_encoder(r->oc->oformat->video_codec);
+
+			const auto audio_codec_name = 
+				try_remove_arg<std::string>(
+					r->options, 
+					boost::regex("^c:a|codec:a|acodec$"));
+
+			r->audio_codec = 
+				audio_codec_name 
+					? avcodec_find_encoder_by_name(audio_codec_name->c_str())
+					: avcodec_find_encoder(r->oc->oformat->audio_codec);
+
+			if (!r->video_codec)
+				BOOST_THROW_EXCEPTION(caspar_exception() << msg_info("Failed to find video codec for " + path));
+			if (!r->audio_codec)
+				BOOST_THROW_EXCEPTION(caspar_exception() << msg_info("Failed to find audio codec for " + path));
+
+			renditions_.push_back(r);
+		}
+
+		configure_video_graph();
+		configure_audio_graph();
+
+		BOOST_FOREACH(const auto& r, renditions_)
+		{
+			auto video_options = r->options;
+			auto audio_options = r->options;
+
+			r->video_st = open_encoder(
+				*r->oc,
+				*r->video_codec, 
+				*r->video_sink,
+				video_options);
+
+			r->audio_st = open_encoder(
+				*r->oc,
+				*r->audio_codec, 
+				*r->audio_sink,
+				audio_options);
+
+			auto it = r->options.begin();
+			while(it != r->options.end())
+			{
+				if(video_options.find(it->first) == video_options.end() || audio_options.find(it->first) == audio_options.end())
+					it = r->options.erase(it);
+				else
+					++it;
+			}
+
+			AVDictionary* av_opts = nullptr;
+
+			to_dict(
+				&av_opts, 
+				r->options);
+
+			CASPAR_SCOPE_EXIT
+			{
+				av_dict_free(&av_opts);
+			};
+
+			if (!(r->oc->oformat->flags & AVFMT_NOFILE)) 
+			{
+				FF(avio_open2(
+					&r->oc->pb, 
+					r->oc->filename, 
+					AVIO_FLAG_WRITE, 
+					&r->oc->interrupt_callback, 
+					&av_opts));
+			}
+
+			FF(avformat_write_header(
+				r->oc.get(), 
+				&av_opts));
+
+			av_dump_format(
+				r->oc.get(), 
+				0, 
+				r->oc->filename, 
+				1);
+
+			BOOST_FOREACH(const auto& option, to_map(av_opts))
+			{
+				CASPAR_LOG(warning) 
+					<< print()
+					<< L" Invalid option: -" 
+					<< widen(option.first) 
+					<< L" " 
+					<< widen(option.second);
+			}
+		}
+	}
+
+	void close()
+	{
+		if(renditions_.empty())
+			return;
+
+		try
+		{
+			FF(av_buffersrc_add_frame(video_graph_in_, nullptr));
+			FF(av_buffersrc_add_frame(audio_graph_in_, nullptr));
+
+			BOOST_FOREACH(const auto& r, renditions_)
+			{
+				pull(r, r->video_sink, r->video_st);
+				pull(r, r->audio_sink, r->audio_st);
+			}
+		}
+		catch(...)
+		{
+			CASPAR_LOG_CURRENT_EXCEPTION();
+		}
+
+		BOOST_FOREACH(const auto& r, renditions_)
+		{
+			r->encoder.begin_invoke([r]
+			{
+				r->encode(r->video_st, nullptr);
+				r->encode(r->audio_st, nullptr);
+			});
+		}
+
+		BOOST_FOREACH(const auto& r, renditions_)
+		{
+			r->encoder.stop();
+			r->encoder.join();
+		}
+
+		video_graph_.reset();
+		audio_graph_.reset();
+
+		BOOST_FOREACH(const auto& r, renditions_)
+		{
+			r->writer.stop();
+			r->writer.join();
+
+			r->video_st.reset();
+			r->audio_st.reset();
+
+			try
+			{
+				FF(av_write_trailer(r->oc.get()));
+			}
+			catch(...)
+			{
+				CASPAR_LOG_CURRENT_EXCEPTION();
+			}
+
+			if (!(r->oc->oformat->flags & AVFMT_NOFILE) && r->oc->pb)
+				avio_close(r->oc->pb);
+		}
+
+		renditions_.clear();
+	}
+
+	void push_video(core::read_frame& frame)
+	{
+		std::shared_ptr<AVFrame> src_av_frame(
+			av_frame_alloc(),
+			[](AVFrame* p)
+			{
+				av_frame_free(&p);
+			});
+
+		const auto sample_aspect_ratio = 
+			boost::rational<int>(
+				in_video_format_.square_width, 
+				in_video_format_.square_height) /
+			boost::rational<int>(
+				in_video_format_.width, 
+				in_video_format_.height);
+
+		src_av_frame->format				  = AV_PIX_FMT_BGRA;
+		src_av_frame->width					  = in_video_format_.width;
+		src_av_frame->height				  = in_video_format_.height;
+		src_av_frame->sample_aspect_ratio.num = sample_aspect_ratio.numerator();
+		src_av_frame->sample_aspect_ratio.den = sample_aspect_ratio.denominator();
+		src_av_frame->interlaced_frame		  = in_video_format_.field_mode != core::field_mode::progressive;
+		src_av_frame->top_field_first		  = in_video_format_.field_mode == core::field_mode::upper;
+		src_av_frame->pts					  = video_pts_++;
+
+		FF(av_image_fill_arrays(
+			src_av_frame->data,
+			src_av_frame->linesize,
+			frame.image_data().begin(),
+			AV_PIX_FMT_BGRA, 
+			in_video_format_.width, 
+			in_video_format_.height, 
+			1));
+
+		FF(av_buffersrc_add_frame(
+			video_graph_in_, 
+			src_av_frame.get()));
+	}
+
+	void push_audio(core::read_frame& frame)
+	{
+		std::shared_ptr<AVFrame> src_av_frame(
+			av_frame_alloc(), 
+			[](AVFrame* p)
+			{
+				av_frame_free(&p);
+			});
+
+		src_av_frame->channels		 = frame.num_channels();
+		src_av_frame->channel_layout = av_get_default_channel_layout(frame.num_channels());
+		src_av_frame->sample_rate	 = in_video_format_.audio_sample_rate;
+		src_av_frame->nb_samples	 = frame.audio_data().size() / src_av_frame->channels;
+		src_av_frame->format		 = AV_SAMPLE_FMT_S32;
+		src_av_frame->pts			 = audio_pts_;
+
+		audio_pts_ += src_av_frame->nb_samples;
+
+		FF(av_samples_fill_arrays(
+			src_av_frame->extended_data, 
+			src_av_frame->linesize,
+			reinterpret_cast<const std::uint8_t*>(&*frame.audio_data().begin()), 
+			src_av_frame->channels,
+			src_av_frame->nb_samples, 
+			AV_SAMPLE_FMT_S32, 
+			16));
+
+		FF(av_buffersrc_add_frame(
+			audio_graph_in_, 
+			src_av_frame.get()));
+	}
+
+	// Hands every frame available on the sink to the rendition encoder,
+	// blocking while its queue is full.
+	void pull(
+		const std::shared_ptr<rendition>& r, 
+		AVFilterContext* sink, 
+		const std::shared_ptr<AVStream>& st)
+	{
+		while(true)
+		{
+			std::shared_ptr<AVFrame> filt_frame(
+				av_frame_alloc(), 
+				[](AVFrame* p)
+				{
+					av_frame_free(&p);
+				});
+
+			const auto ret = av_buffersink_get_frame(
+				sink, 
+				filt_frame.get());
+
+			if(ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
+				return;
+
+			FF_RET(ret, "av_buffersink_get_frame");
+
+			r->encoder.begin_invoke([r, st, filt_frame]
+			{
+				r->encode(st, filt_frame);
+			});
+		}
+	}
+
+	static AVFilterInOut* create_inout(
+		const std::string& name, 
+		AVFilterContext* ctx, 
+		AVFilterInOut* next)
+	{
+		auto inout = avfilter_inout_alloc();
+
+		CASPAR_VERIFY(inout);
+
+		inout->name       = av_strdup(name.c_str());
+		inout->filter_ctx = ctx;
+		inout->pad_idx    = 0;
+		inout->next       = next;
+
+		return inout;
+	}
+
+	// Links "[in]" to the source and "[out<n>]" to the sink of rendition n.
+	void parse_filtergraph(
+		AVFilterGraph& graph, 
+		const std::string& filtergraph, 
+		AVFilterContext& source_ctx, 
+		const std::vector<AVFilterContext*>& sinks)
+	{
+		AVFilterInOut* outputs = nullptr;
+		AVFilterInOut* inputs  = nullptr;
+
+		try
+		{
+			outputs = create_inout("in", &source_ctx, nullptr);
+
+			for(int n = static_cast<int>(sinks.size()) - 1; n >= 0; --n)
+				inputs = create_inout("out" + boost::lexical_cast<std::string>(n), sinks[n], inputs);
+
+			FF(avfilter_graph_parse(
+				&graph, 
+				filtergraph.c_str(), 
+				&inputs, 
+				&outputs, 
+				nullptr));
+
+			FF(avfilter_graph_config(
+				&graph, 
+				nullptr));
+		}
+		catch(...)
+		{
+			avfilter_inout_free(&outputs);
+			avfilter_inout_free(&inputs);
+			throw;
+		}
+	}
+
+	// Builds "[in]<filter>,split=N[s0][s1]...;[s0]<per rendition>[out0];...".
+	std::string split_filtergraph(
+		const std::string& head, 
+		const std::string& split_filter, 
+		const std::function<std::string(const rendition&)>& tail)
+	{
+		const auto count = renditions_.size();
+
+		auto result = "[in]" + head + "," + split_filter + "=" + boost::lexical_cast<std::string>(count);
+
+		for(size_t n = 0; n < count; ++n)
+			result += "[s" + boost::lexical_cast<std::string>(n) + "]";
+
+		for(size_t n = 0; n < count; ++n)
+		{
+			result += ";[s" + boost::lexical_cast<std::string>(n) + "]" + tail(*renditions_[n]) + "[out" + boost::lexical_cast<std::string>(n) + "]";
+		}
+
+		return result;
+	}
+
+	void configure_video_graph()
+	{
+		video_graph_.reset(
+			avfilter_graph_alloc(), 
+			[](AVFilterGraph* p)
+			{
+				avfilter_graph_free(&p);
+			});
+
+		video_graph_->nb_threads  = boost::thread::hardware_concurrency()/2;
+		video_graph_->thread_type = AVFILTER_THREAD_SLICE;
+
+		const auto sample_aspect_ratio = 
+			boost::rational<int>(
+				in_video_format_.square_width, 
+				in_video_format_.square_height) /
+			boost::rational<int>(
+				in_video_format_.width, 
+				in_video_format_.height);
+
+		const auto vsrc_options = (boost::format("video_size=%1%x%2%:pix_fmt=%3%:time_base=%4%/%5%:pixel_aspect=%6%/%7%:frame_rate=%8%/%9%")
+			% in_video_format_.width % in_video_format_.height
+			% AV_PIX_FMT_BGRA
+			% in_video_format_.duration	% in_video_format_.time_scale
+			% sample_aspect_ratio.numerator() % sample_aspect_ratio.denominator()
+			% in_video_format_.time_scale % in_video_format_.duration).str();
+
+		FF(avfilter_graph_create_filter(
+			&video_graph_in_,
+			avfilter_get_by_name("buffer"), 
+			"multi_rendition_consumer_buffer",
+			vsrc_options.c_str(), 
+			nullptr, 
+			video_graph_.get()));
+
+		std::vector<AVFilterContext*> sinks;
+
+		BOOST_FOREACH(const auto& r, renditions_)
+		{
+			FF(avfilter_graph_create_filter(
+				&r->video_sink,
+				avfilter_get_by_name("buffersink"), 
+				("multi_rendition_consumer_buffersink" + boost::lexical_cast<std::string>(sinks.size())).c_str(),
+				nullptr, 
+				nullptr, 
+				video_graph_.get()));
+
+#pragma warning (push)
+#pragma warning (disable : 4245)
+
+			FF(av_opt_set_int_list(
+				r->video_sink, 
+				"pix_fmts", 
+				r->video_codec->pix_fmts, 
+				-1,
+				AV_OPT_SEARCH_CHILDREN));
+
+#pragma warning (pop)
+
+			sinks.push_back(r->video_sink);
+		}
+
+		// The color conversion happens once, before the split, in the format
+		// preferred by the first rendition's encoder.
+		const auto first_codec = renditions_.front()->video_codec;
+		const auto pix_fmt = first_codec->pix_fmts ? first_codec->pix_fmts[0] : AV_PIX_FMT_YUV420P;
+
+		const auto head = 
+			(video_filter_.empty() ? "" : video_filter_ + ",") + 
+			"format=pix_fmts=" + av_get_pix_fmt_name(pix_fmt);
+
+		const auto in_width  = in_video_format_.width;
+		const auto in_height = in_video_format_.height;
+
+		parse_filtergraph(
+			*video_graph_, 
+			split_filtergraph(head, "split", [=](const rendition& r) -> std::string
+			{
+				if(r.desc.width <= 0 || r.desc.height <= 0 || (r.desc.width == in_width && r.desc.height == in_height))
+					return "null";
+
+				return (boost::format("scale=%1%:%2%") % r.desc.width % r.desc.height).str();
+			}),
+			*video_graph_in_, 
+			sinks);
+
+		CASPAR_LOG(info)
+			<< 	widen(std::string("\n") 
+				+ avfilter_graph_dump(
+						video_graph_.get(), 
+						nullptr));
+	}
+
+	void configure_audio_graph()
+	{
+		audio_graph_.reset(
+			avfilter_graph_alloc(), 
+			[](AVFilterGraph* p)
+			{
+				avfilter_graph_free(&p);
+			});
+
+		audio_graph_->nb_threads  = boost::thread::hardware_concurrency()/2;
+		audio_graph_->thread_type = AVFILTER_THREAD_SLICE;
+
+		const auto asrc_options = (boost::format("sample_rate=%1%:sample_fmt=%2%:channels=%3%:time_base=%4%/%5%:channel_layout=%6%")
+			% in_video_format_.audio_sample_rate
+			% av_get_sample_fmt_name(AV_SAMPLE_FMT_S32)
+			% in_channel_layout_.num_channels
+			% 1	% in_video_format_.audio_sample_rate
+			% boost::io::group(
+				std::hex, 
+				std::showbase, 
+				av_get_default_channel_layout(in_channel_layout_.num_channels))).str();
+
+		FF(avfilter_graph_create_filter(
+			&audio_graph_in_,
+			avfilter_get_by_name("abuffer"), 
+			"multi_rendition_consumer_abuffer",
+			asrc_options.c_str(), 
+			nullptr, 
+			audio_graph_.get()));
+
+		std::vector<AVFilterContext*> sinks;
+
+		BOOST_FOREACH(const auto& r, renditions_)
+		{
+			FF(avfilter_graph_create_filter(
+				&r->audio_sink,
+				avfilter_get_by_name("abuffersink"), 
+				("multi_rendition_consumer_abuffersink" + boost::lexical_cast<std::string>(sinks.size())).c_str(),
+				nullptr, 
+				nullptr, 
+				audio_graph_.get()));
+
+#pragma warning (push)
+#pragma warning (disable : 4245)
+
+			FF(av_opt_set_int(
+				r->audio_sink,	   
+				"all_channel_counts",
+				1,	
+				AV_OPT_SEARCH_CHILDREN));
+
+			FF(av_opt_set_int_list(
+				r->audio_sink, 
+				"sample_fmts",		 
+				r->audio_codec->sample_fmts,				
+				-1, 
+				AV_OPT_SEARCH_CHILDREN));
+
+			FF(av_opt_set_int_list(
+				r->audio_sink,
+				"channel_layouts",	 
+				r->audio_codec->channel_layouts,			
+				-1, 
+				AV_OPT_SEARCH_CHILDREN));
+
+			FF(av_opt_set_int_list(
+				r->audio_sink, 
+				"sample_rates" ,	 
+				r->audio_codec->supported_samplerates,	
+				-1, 
+				AV_OPT_SEARCH_CHILDREN));
+
+#pragma warning (pop)
+
+			sinks.push_back(r->audio_sink);
+		}
+
+		const auto first_codec = renditions_.front()->audio_codec;
+		const auto sample_fmt = first_codec->sample_fmts ? first_codec->sample_fmts[0] : AV_SAMPLE_FMT_S16;
+
+		const auto head = 
+			(audio_filter_.empty() ? "" : audio_filter_ + ",") + 
+			"aformat=sample_fmts=" + av_get_sample_fmt_name(sample_fmt);
+
+		parse_filtergraph(
+			*audio_graph_, 
+			split_filtergraph(head, "asplit", [](const rendition&)
+			{
+				return std::string("anull");
+			}),
+			*audio_graph_in_, 
+			sinks);
+
+		CASPAR_LOG(info) 
+			<< 	widen(std::string("\n") 
+				+ avfilter_graph_dump(
+					audio_graph_.get(), 
+					nullptr));
+	}
+};
+
+safe_ptr<core::frame_consumer> create_streaming_consumer(const core::parameters& params)
+{       
+	if (params.size() < 1 || params[0] != L"STREAM")
+		return core::frame_consumer::empty();
+
+	auto path = narrow(params.at_original(1));
+	auto args = narrow(params.get_original_string(2));
+
+	return make_safe<streaming_consumer>(path, args);
+}
+
+safe_ptr<core::frame_consumer> create_streaming_consumer(const boost::property_tree::wptree& ptree)
+{              	
+    return make_safe<streaming_consumer>(
+		narrow(ptree.get<std::wstring>(L"path")), 
+		narrow(ptree.get<std::wstring>(L"args", L"")));
+}
+
+bool parse_rendition_size(const std::wstring& str, rendition_desc& desc)
+{
+	static const boost::wregex size_exp(L"(?<WIDTH>\\d+)[xX](?<HEIGHT>\\d+)");
+
+	boost::wsmatch what;
+	if(!boost::regex_match(str, what, size_exp))
+		return false;
+
+	desc.width  = boost::lexical_cast<int>(what["WIDTH"].str());
+	desc.height = boost::lexical_cast<int>(what["HEIGHT"].str());
+
+	return true;
+}
+
+safe_ptr<core::frame_consumer> create_multi_rendition_consumer(const core::parameters& params)
+{
+	if (params.size() < 2 || params[0] != L"RENDITIONS")
+		return core::frame_consumer::empty();
+
+	std::vector<rendition_desc> renditions;
+
+	size_t n = 1;
+	while(n < params.size() && !boost::starts_with(params[n], L"-"))
+	{
+		rendition_desc desc;
+		desc.path = narrow(params.at_original(n++));
+
+		if(n < params.size() && parse_rendition_size(params[n], desc))
+			++n;
+
+		renditions.push_back(desc);
+	}
+
+	auto args = n < params.size() ? narrow(params.get_original_string(static_cast<int>(n))) : "";
+
+	return make_safe<multi_rendition_consumer>(renditions, args);
+}
+
+safe_ptr<core::frame_consumer> create_multi_rendition_consumer(const boost::property_tree::wptree& ptree)
+{
+	std::vector<rendition_desc> renditions;
+
+	BOOST_FOREACH(auto& xml_rendition, ptree.get_child(L"renditions"))
+	{
+		if(xml_rendition.first != L"rendition")
+			continue;
+
+		rendition_desc desc;
+		desc.path	 = narrow(xml_rendition.second.get<std::wstring>(L"path"));
+		desc.options = parse_options(narrow(xml_rendition.second.get<std::wstring>(L"args", L"")));
+
+		parse_rendition_size(xml_rendition.second.get<std::wstring>(L"size", L""), desc);
+
+		renditions.push_back(desc);
+	}
+
+	return make_safe<multi_rendition_consumer>(
+		renditions, 
 		narrow(ptree.get<std::wstring>(L"args", L"")));
 }
 
@@ -16,4 +16,9 @@ safe_ptr<core::frame_consumer> create_streaming_consumer(
 safe_ptr<core::frame_consumer> create_streaming_consumer(
 		const boost::property_tree::wptree& ptree);
 
+safe_ptr<core::frame_consumer> create_multi_rendition_consumer(
+		const core::parameters& params);
+safe_ptr<core::frame_consumer> create_multi_rendition_consumer(
+		const boost::property_tree::wptree& ptree);
+
 }}
\ No newline at end of file
@@ -262,6 +262,7 @@ void init(const safe_ptr<core::media_info_repository>& media_info_repo)
 	
 	core::register_consumer_factory([](const core::parameters& params){return ffmpeg::create_consumer(params);});
 	core::register_consumer_factory([](const core::parameters& params){return ffmpeg::create_streaming_consumer(params);});
+	core::register_consumer_factory([](const core::parameters& params){return ffmpeg::create_multi_rendition_consumer(params);});
 	core::register_producer_factory(create_producer);
 	core::register_thumbnail_producer_factory(create_thumbnail_producer);
 
@@ -247,16 +247,22 @@ public:
 
 	void send_osc()
 	{
-		monitor_subject_	<< core::monitor::message("/profiler/time")		% frame_timer_.elapsed() % (1.0/format_desc_.fps);			
+		if (monitor_subject_.is_subscribed("/profiler"))
+			monitor_subject_	<< core::monitor::message("/profiler/time")		% frame_timer_.elapsed() % (1.0/format_desc_.fps);			
 								
-		monitor_subject_	<< core::monitor::message("/file/time")			% (file_frame_number()/fps_) 
-																			% (file_nb_frames()/fps_)
-							<< core::monitor::message("/file/frame")			% static_cast<int32_t>(file_frame_number())
-																			% static_cast<int32_t>(file_nb_frames())
-							<< core::monitor::message("/file/fps")			% fps_
-							<< core::monitor::message("/file/path")			% path_relative_to_media_
-							<< core::monitor::message("/loop")				% input_.loop()
-							<< core::monitor::message("/guid")				% guid_;
+		if (monitor_subject_.is_subscribed("/file"))
+			monitor_subject_	<< core::monitor::message("/file/time")			% (file_frame_number()/fps_) 
+																				% (file_nb_frames()/fps_)
+								<< core::monitor::message("/file/frame")			% static_cast<int32_t>(file_frame_number())
+																				% static_cast<int32_t>(file_nb_frames())
+								<< core::monitor::message("/file/fps")			% fps_
+								<< core::monitor::message("/file/path")			% path_relative_to_media_;
+
+		if (monitor_subject_.is_subscribed("/loop"))
+			monitor_subject_	<< core::monitor::message("/loop")				% input_.loop();
+
+		if (monitor_subject_.is_subscribed("/guid"))
+			monitor_subject_	<< core::monitor::message("/guid")				% guid_;
 	}
 	
 	safe_ptr<core::basic_frame> render_specific_frame(uint32_t file_position, int hints)
@@ -57,6 +57,16 @@ std::wstring get_cg_version()
 			{
 				return make_safe<core::write_frame>(nullptr, layout);
 			}
+
+			virtual safe_ptr<core::write_frame> create_frame(const void* video_stream_tag, const safe_ptr<core::read_frame>& source, const core::pixel_format_desc& desc) 
+			{
+				return make_safe<core::write_frame>(nullptr, core::channel_layout::stereo());
+			}
+
+			virtual safe_ptr<core::write_frame> create_frame(const void* video_stream_tag, const safe_ptr<core::write_frame>& previous, const std::vector<core::pixel_rect>& regions) 
+			{
+				return make_safe<core::write_frame>(nullptr, core::channel_layout::stereo());
+			}
 	
 			virtual core::video_format_desc get_video_format_desc() const
 			{
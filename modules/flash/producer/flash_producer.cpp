@@ -412,11 +412,14 @@ public:
 
 		fill_buffer();
 		
-		monitor_subject_ << core::monitor::message("/host/path")		% filename_
-					     << core::monitor::message("/host/width")	% width_
-					     << core::monitor::message("/host/height")	% height_
-					     << core::monitor::message("/host/fps")		% fps_
-					     << core::monitor::message("/buffer")		% output_buffer_.size() % buffer_size_;
+		if (monitor_subject_.is_subscribed("/host"))
+			monitor_subject_ << core::monitor::message("/host/path")		% filename_
+						     << core::monitor::message("/host/width")	% width_
+						     << core::monitor::message("/host/height")	% height_
+						     << core::monitor::message("/host/fps")		% fps_;
+
+		if (monitor_subject_.is_subscribed("/buffer"))
+			monitor_subject_ << core::monitor::message("/buffer")		% output_buffer_.size() % buffer_size_;
 
 		return frame;
 	}
@@ -26,6 +26,7 @@
 #include <core/monitor/monitor.h>
 #include <core/parameters/parameters.h>
 #include <core/producer/frame/basic_frame.h>
+#include <core/producer/frame/dirty_region.h>
 #include <core/producer/frame/frame_factory.h>
 #include <core/producer/frame_producer.h>
 #include <core/mixer/write_frame.h>
@@ -43,6 +44,7 @@
 #include <boost/algorithm/string/trim.hpp>
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/foreach.hpp>
 #include <boost/format.hpp>
 #include <boost/timer.hpp>
 
@@ -90,6 +92,12 @@ namespace caspar {
 
 			CefRefPtr<CefBrowser>					browser_;
 
+			std::shared_ptr<core::write_frame>		previous_paint_;
+			tbb::atomic<int64_t>					paints_;
+			tbb::atomic<int64_t>					partial_paints_;
+			tbb::atomic<int64_t>					last_paint_bytes_;
+			tbb::atomic<int64_t>					total_paint_bytes_;
+
 			executor								executor_;
 
 		public:
@@ -104,9 +112,14 @@ namespace caspar {
 				graph_->set_color("browser-tick-time", diagnostics::color(0.1f, 1.0f, 0.1f));
 				graph_->set_color("tick-time", diagnostics::color(0.0f, 0.6f, 0.9f));
 				graph_->set_color("late-frame", diagnostics::color(0.6f, 0.3f, 0.9f));
+				graph_->set_color("updated-area", diagnostics::color(0.9f, 0.9f, 0.3f));
 				graph_->set_text(print());
 				diagnostics::register_graph(graph_);
 
+				paints_ = 0;
+				partial_paints_ = 0;
+				last_paint_bytes_ = 0;
+				total_paint_bytes_ = 0;
 				loaded_ = false;
 				removed_ = false;
 				animation_frame_requested_ = false;
@@ -168,6 +181,16 @@ namespace caspar {
 				return removed_;
 			}
 
+			boost::property_tree::wptree paint_info() const
+			{
+				boost::property_tree::wptree info;
+				info.add(L"count", paints_);
+				info.add(L"partial", partial_paints_);
+				info.add(L"last-updated-bytes", last_paint_bytes_);
+				info.add(L"total-updated-bytes", total_paint_bytes_);
+				return info;
+			}
+
 		private:
 
 			bool GetViewRect(CefRefPtr<CefBrowser> browser, CefRect &rect)
@@ -198,9 +221,60 @@ namespace caspar {
 					pixel_desc.pix_fmt = core::pixel_format::bgra;
 					pixel_desc.planes.push_back(
 						core::pixel_format_desc::plane(width, height, 4));
-				auto frame = frame_factory_->create_frame(this, pixel_desc);
-				fast_memcpy(frame->image_data().begin(), buffer, width * height * 4);
+
+				core::dirty_region region(width, height);
+
+				BOOST_FOREACH(auto& rect, dirtyRects)
+					region.add(core::pixel_rect(rect.x, rect.y, rect.width, rect.height));
+
+				bool same_size = previous_paint_
+						&& previous_paint_->get_pixel_format_desc().planes.at(0).width == width
+						&& previous_paint_->get_pixel_format_desc().planes.at(0).height == height;
+
+				// Nothing visible changed, the previous paint is still shown.
+				if (region.empty() && same_size)
+					return;
+
+				// Partial paints update the texture of the previous paint, so
+				// they are not used when fields need separate images.
+				bool partial = same_size
+						&& !region.empty()
+						&& !region.full()
+						&& frame_factory_->get_video_format_desc().field_mode == core::field_mode::progressive;
+
+				auto frame = partial
+						? frame_factory_->create_frame(this, make_safe_ptr(previous_paint_), region.rects())
+						: frame_factory_->create_frame(this, pixel_desc);
+
+				int64_t updated_bytes = static_cast<int64_t>(width) * height * 4;
+
+				if (partial)
+				{
+					auto source = static_cast<const uint8_t*>(buffer);
+					auto dest = frame->image_data().begin();
+
+					BOOST_FOREACH(auto& rect, region.rects())
+					{
+						for (int y = rect.y; y < rect.y + rect.height; ++y)
+						{
+							auto offset = (static_cast<size_t>(y) * width + rect.x) * 4;
+							std::memcpy(dest + offset, source + offset, rect.width * 4);
+						}
+					}
+
+					updated_bytes = region.area() * 4;
+					++partial_paints_;
+				}
+				else
+					fast_memcpy(frame->image_data().begin(), buffer, width * height * 4);
+
 				frame->commit();
+				previous_paint_ = frame;
+
+				++paints_;
+				last_paint_bytes_ = updated_bytes;
+				total_paint_bytes_ += updated_bytes;
+				graph_->set_value("updated-area", static_cast<double>(updated_bytes) / (static_cast<double>(width) * height * 4));
 
 				lock(frames_mutex_, [&]
 				{
@@ -557,6 +631,10 @@ namespace caspar {
 			{
 				boost::property_tree::wptree info;
 				info.add(L"type", L"html-producer");
+
+				if (client_)
+					info.add_child(L"paints", client_->paint_info());
+
 				return info;
 			}
 
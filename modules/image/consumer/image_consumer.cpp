@@ -26,6 +26,7 @@
 #include <common/env.h>
 #include <common/log/log.h>
 #include <common/utility/string.h>
+#include <common/concurrency/executor.h>
 #include <common/concurrency/future_util.h>
 
 #include <core/parameters/parameters.h>
@@ -33,17 +34,43 @@
 #include <core/video_format.h>
 #include <core/mixer/read_frame.h>
 
+#include <boost/algorithm/string/case_conv.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
-#include <boost/thread.hpp>
+#include <boost/thread/once.hpp>
+
+#include <tbb/atomic.h>
 
-#include <FreeImage.h>
-#include <vector>
 #include <algorithm>
+#include <memory>
 
-#include "../util/image_view.h"
+#include "../util/png_encoder.h"
 
 namespace caspar { namespace image {
 
+// Shared by all image consumers. Captures queue up instead of each getting a
+// thread of their own, the encoder itself is parallel. The executor is
+// created on the first capture, so that no thread is started during static
+// initialization. Declared at namespace scope since function local statics
+// are not thread safe.
+std::unique_ptr<executor>	g_encoder;
+boost::once_flag			g_encoder_created = BOOST_ONCE_INIT;
+
+// Captures accepted but not yet encoded. send() runs on the channel's output
+// thread, so captures beyond MAX_PENDING_CAPTURES are dropped rather than
+// waited for.
+const int					MAX_PENDING_CAPTURES = 8;
+tbb::atomic<int>			g_pending_captures;
+
+executor& get_encoder()
+{
+	boost::call_once(g_encoder_created, []
+	{
+		g_encoder.reset(new executor(L"image_consumer"));
+	});
+
+	return *g_encoder;
+}
+
 void write_cropped_png(
 		const safe_ptr<core::read_frame>& frame,
 		const core::video_format_desc& format_desc,
@@ -51,26 +78,21 @@ void write_cropped_png(
 		int width,
 		int height)
 {
-	auto bitmap = std::shared_ptr<FIBITMAP>(FreeImage_Allocate(width, height, 32), FreeImage_Unload);
-	image_view<bgra_pixel> destination_view(FreeImage_GetBits(bitmap.get()), width, height);
-	image_view<bgra_pixel> complete_frame(const_cast<uint8_t*>(frame->image_data().begin()), format_desc.width, format_desc.height);
-	auto thumbnail_view = complete_frame.subview(0, 0, width, height);
-
-	std::copy(thumbnail_view.begin(), thumbnail_view.end(), destination_view.begin());
-	FreeImage_FlipVertical(bitmap.get());
-	FreeImage_SaveU(FIF_PNG, bitmap.get(), output_file.wstring().c_str(), 0);
+	write_png(frame->image_data().begin(), width, height, format_desc.width * 4, output_file, get_configured_png_options());
 }
 
 struct image_consumer : public core::frame_consumer
 {
 	core::video_format_desc	format_desc_;
 	std::wstring			filename_;
+	png_options				options_;
 public:
 
 	// frame_consumer
 
-	image_consumer(const std::wstring& filename)
+	image_consumer(const std::wstring& filename, const png_options& options)
 		: filename_(filename)
+		, options_(options)
 	{
 	}
 
@@ -88,8 +110,16 @@ public:
 	{				
 		auto format_desc = format_desc_;
 		auto filename = filename_;
+		auto options = options_;
 
-		boost::thread async([format_desc, frame, filename]
+		if (++g_pending_captures > MAX_PENDING_CAPTURES)
+		{
+			--g_pending_captures;
+			CASPAR_LOG(warning) << print() << L" Too many captures waiting to be encoded, dropping capture.";
+			return wrap_as_future(false);
+		}
+
+		get_encoder().begin_invoke([format_desc, frame, filename, options]
 		{
 			win32_exception::ensure_handler_installed_for_thread("image-consumer-thread");
 
@@ -102,17 +132,15 @@ public:
 				else
 					filename2 = env::getFileName(filename2) + L".png";
 
-				auto bitmap = std::shared_ptr<FIBITMAP>(FreeImage_Allocate(format_desc.width, format_desc.height, 32), FreeImage_Unload);
-				memcpy(FreeImage_GetBits(bitmap.get()), frame->image_data().begin(), frame->image_size());
-				FreeImage_FlipVertical(bitmap.get());
-				FreeImage_SaveU(FIF_PNG, bitmap.get(), filename2.c_str(), 0);
+				write_png(frame->image_data().begin(), format_desc.width, format_desc.height, format_desc.width * 4, filename2, options);
 			}
 			catch(...)
 			{
 				CASPAR_LOG_CURRENT_EXCEPTION();
 			}
+
+			--g_pending_captures;
 		});
-		async.detach();
 
 		return wrap_as_future(false);
 	}
@@ -147,10 +175,16 @@ safe_ptr<core::frame_consumer> create_consumer(const core::parameters& params)
 
 	std::wstring filename;
 
-	if (params.size() > 1)
+	if (params.size() > 1 && params.at(1) != L"COMPRESSION" && params.at(1) != L"FILTER")
 		filename = params.at(1);
 
-	return make_safe<image_consumer>(filename);
+	auto options = get_configured_png_options();
+	options.compression_level	= std::max(0, std::min(9, params.get(L"COMPRESSION", options.compression_level)));
+
+	if (params.has(L"FILTER"))
+		options.filter			= get_png_filter(boost::to_lower_copy(params.get(L"FILTER")));
+
+	return make_safe<image_consumer>(filename, options);
 }
 
 }}
@@ -24,19 +24,25 @@
 #include "producer/image_producer.h"
 #include "producer/image_scroll_producer.h"
 #include "consumer/image_consumer.h"
+#include "util/image_cache.h"
 
 #include <core/parameters/parameters.h>
 #include <core/producer/frame_producer.h>
 #include <core/consumer/frame_consumer.h>
 
+#include <common/env.h>
 #include <common/utility/string.h>
 
+#include <boost/property_tree/ptree.hpp>
+
 #include <FreeImage.h>
 
 namespace caspar { namespace image {
 
 void init()
 {
+	get_image_cache().set_budget(static_cast<size_t>(env::properties().get(L"configuration.image.cache-size-mb", 256)) * 1024 * 1024);
+
 	core::register_producer_factory(create_scroll_producer);
 	core::register_producer_factory(create_producer);
 	core::register_thumbnail_producer_factory(create_thumbnail_producer);
@@ -48,4 +54,25 @@ std::wstring get_version()
 	return widen(std::string(FreeImage_GetVersion()));
 }
 
+bool prefetch_image(const std::wstring& name)
+{
+	auto filename = find_image_file(name);
+
+	if (filename.empty())
+		return false;
+
+	get_image_cache().prefetch(filename);
+	return true;
+}
+
+boost::property_tree::wptree image_cache_info()
+{
+	return get_image_cache().info();
+}
+
+void clear_image_cache()
+{
+	get_image_cache().clear();
+}
+
 }}
\ No newline at end of file
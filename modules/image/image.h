@@ -21,6 +21,8 @@
 
 #pragma once
 
+#include <boost/property_tree/ptree_fwd.hpp>
+
 #include <string>
 
 namespace caspar { namespace image {
@@ -29,4 +31,10 @@ void init();
 
 std::wstring get_version();
 
+// Decodes an image from the media folder into the image cache in the
+// background. Returns false if there is no image by that name.
+bool prefetch_image(const std::wstring& name);
+boost::property_tree::wptree image_cache_info();
+void clear_image_cache();
+
 }}
\ No newline at end of file
@@ -21,6 +21,7 @@
 
 #include "image_producer.h"
 
+#include "../util/image_cache.h"
 #include "../util/image_loader.h"
 
 #include <core/video_format.h>
@@ -32,6 +33,7 @@
 #include <core/mixer/write_frame.h>
 
 #include <common/env.h>
+#include <common/exception/exceptions.h>
 #include <common/log/log.h>
 #include <common/utility/base64.h>
 #include <common/utility/string.h>
@@ -39,6 +41,9 @@
 #include <boost/assign.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/property_tree/ptree.hpp>
+#include <boost/thread/future.hpp>
+
+#include <tbb/atomic.h>
 
 #include <algorithm>
 
@@ -46,18 +51,55 @@ using namespace boost::assign;
 
 namespace caspar { namespace image {
 
+struct load_mode
+{
+	enum type
+	{
+		background,		// Decoded through the image cache, LOAD does not wait.
+		synchronous		// Decoded in the constructor, bypassing the image cache.
+	};
+};
+
 struct image_producer : public core::frame_producer
 {	
 	const std::wstring description_;
 	core::monitor::subject		monitor_subject_;
 	const safe_ptr<core::frame_factory> frame_factory_;	safe_ptr<core::basic_frame> frame_;
+	boost::unique_future<safe_ptr<core::basic_frame>>	future_;
+	tbb::atomic<bool>									ready_;
+	tbb::atomic<bool>									failed_;
+	std::wstring										error_;
 	
-	explicit image_producer(const safe_ptr<core::frame_factory>& frame_factory, const std::wstring& filename) 
+	// Images played out are decoded and uploaded in the background so that
+	// LOAD returns immediately regardless of the image size, the producer
+	// is empty until the image is ready. The file header is still checked
+	// here, so LOAD fails right away for missing files and unknown formats.
+	// Thumbnails are loaded synchronously and bypass the image cache.
+	explicit image_producer(const safe_ptr<core::frame_factory>& frame_factory, const std::wstring& filename, load_mode::type mode) 
 		: description_(filename)
 		, frame_factory_(frame_factory)
 		, frame_(core::basic_frame::empty())	
 	{
-		load(load_image(filename));
+		ready_	= mode == load_mode::synchronous;
+		failed_	= false;
+
+		if (mode == load_mode::synchronous)
+		{
+			auto bitmap = load_image(filename);
+			FreeImage_FlipVertical(bitmap.get());
+			frame_ = create_frame(frame_factory_, this, bitmap);
+		}
+		else
+		{
+			probe_image(filename);
+
+			const void* tag = this;
+
+			future_ = get_image_cache().get_async(filename, [=](const std::shared_ptr<FIBITMAP>& bitmap)
+			{
+				return create_frame(frame_factory, tag, bitmap);
+			});
+		}
 	}
 
 	explicit image_producer(const safe_ptr<core::frame_factory>& frame_factory, const void* png_data, size_t size)
@@ -65,28 +107,68 @@ struct image_producer : public core::frame_producer
 		, frame_factory_(frame_factory)
 		, frame_(core::basic_frame::empty())
 	{
-		load(load_png_from_memory(png_data, size));
-	}
+		ready_	= true;
+		failed_	= false;
 
-	void load(const std::shared_ptr<FIBITMAP>& bitmap)
-	{
+		auto bitmap = load_png_from_memory(png_data, size);
 		FreeImage_FlipVertical(bitmap.get());
+		frame_ = create_frame(frame_factory_, this, bitmap);
+	}
 
+	// The bitmap is top-down and might be shared with the image cache.
+	static safe_ptr<core::basic_frame> create_frame(const safe_ptr<core::frame_factory>& frame_factory, const void* tag, const std::shared_ptr<FIBITMAP>& bitmap)
+	{
 		core::pixel_format_desc desc;
 		desc.pix_fmt = core::pixel_format::bgra;
 		desc.planes.push_back(core::pixel_format_desc::plane(FreeImage_GetWidth(bitmap.get()), FreeImage_GetHeight(bitmap.get()), 4));
-		auto frame = frame_factory_->create_frame(this, desc);
+		auto frame = frame_factory->create_frame(tag, desc);
 
 		std::copy_n(FreeImage_GetBits(bitmap.get()), frame->image_data().size(), frame->image_data().begin());
 		frame->commit();
-		frame_ = std::move(frame);
+		return frame;
+	}
+
+	void set_failed(const std::wstring& error)
+	{
+		CASPAR_LOG(error) << print() << L" Failed to load image: " << error;
+
+		error_	= error;
+		failed_	= true;
 	}
 
 	// frame_producer
 
 	virtual safe_ptr<core::basic_frame> receive(int) override
 	{
-		monitor_subject_ << core::monitor::message("/file/path") % description_;
+		if (!ready_ && !failed_ && future_.is_ready())
+		{
+			try
+			{
+				frame_ = future_.get();
+				ready_ = true;
+			}
+			catch(const caspar_exception& e)
+			{
+				CASPAR_LOG_CURRENT_EXCEPTION();
+
+				auto msg = boost::get_error_info<msg_info>(e);
+				set_failed(msg ? widen(*msg) : L"Failed to load image.");
+			}
+			catch(...)
+			{
+				CASPAR_LOG_CURRENT_EXCEPTION();
+				set_failed(L"Failed to load image.");
+			}
+		}
+
+		if (monitor_subject_.is_subscribed("/file/path"))
+			monitor_subject_ << core::monitor::message("/file/path") % description_;
+
+		if (monitor_subject_.is_subscribed("/file/ready"))
+			monitor_subject_ << core::monitor::message("/file/ready") % static_cast<bool>(ready_);
+
+		if (failed_ && monitor_subject_.is_subscribed("/file/error"))
+			monitor_subject_ << core::monitor::message("/file/error") % error_;
 
 		return frame_;
 	}
@@ -111,6 +193,11 @@ struct image_producer : public core::frame_producer
 		boost::property_tree::wptree info;
 		info.add(L"type", L"image-producer");
 		info.add(L"location", description_);
+		info.add(L"ready", static_cast<bool>(ready_));
+
+		if (failed_)
+			info.add(L"error", error_);
+
 		return info;
 	}
 
@@ -120,9 +207,26 @@ struct image_producer : public core::frame_producer
 	}
 };
 
+std::wstring find_image_file(const std::wstring& name)
+{
+	static const std::vector<std::wstring> extensions = list_of(L"png")(L"tga")(L"bmp")(L"jpg")(L"jpeg")(L"gif")(L"tiff")(L"tif")(L"jp2")(L"jpx")(L"j2k")(L"j2c");
+	std::wstring filename = env::getFileName(name);
+	
+	auto ext = std::find_if(extensions.begin(), extensions.end(), [&](const std::wstring& ex) -> bool
+		{					
+			return boost::filesystem::is_regular_file(boost::filesystem::path(filename).replace_extension(ex));
+		});
+
+	if(ext == extensions.end())
+		return L"";
+
+	return filename + L"." + *ext;
+}
+
 safe_ptr<core::frame_producer> create_raw_producer(
 	const safe_ptr<core::frame_factory>& frame_factory,
-	const core::parameters& params)
+	const core::parameters& params,
+	load_mode::type mode)
 {
 	if (params[0] == L"[PNG_BASE64]")
 	{
@@ -134,25 +238,19 @@ safe_ptr<core::frame_producer> create_raw_producer(
 		return make_safe<image_producer>(frame_factory, png_data.data(), png_data.size());
 	}
 
-	static const std::vector<std::wstring> extensions = list_of(L"png")(L"tga")(L"bmp")(L"jpg")(L"jpeg")(L"gif")(L"tiff")(L"tif")(L"jp2")(L"jpx")(L"j2k")(L"j2c");
-	std::wstring filename = env::getFileName(params.at_original(0));
-	
-	auto ext = std::find_if(extensions.begin(), extensions.end(), [&](const std::wstring& ex) -> bool
-		{					
-			return boost::filesystem::is_regular_file(boost::filesystem::path(filename).replace_extension(ex));
-		});
+	auto filename = find_image_file(params.at_original(0));
 
-	if(ext == extensions.end())
+	if(filename.empty())
 		return core::frame_producer::empty();
 
-	return make_safe<image_producer>(frame_factory, filename + L"." + *ext);
+	return make_safe<image_producer>(frame_factory, filename, mode);
 }
 
 safe_ptr<core::frame_producer> create_producer(
 		const safe_ptr<core::frame_factory>& frame_factory,
 		const core::parameters& params)
 {
-	auto raw_producer = create_raw_producer(frame_factory, params);
+	auto raw_producer = create_raw_producer(frame_factory, params, load_mode::background);
 
 	if (raw_producer == core::frame_producer::empty())
 		return raw_producer;
@@ -164,7 +262,9 @@ safe_ptr<core::frame_producer> create_thumbnail_producer(
 		const safe_ptr<core::frame_factory>& frame_factory,
 		const core::parameters& params)
 {
-	return create_raw_producer(frame_factory, params);
+	// Thumbnail generation walks the whole media folder and would only push
+	// the images that are actually played out of the cache.
+	return create_raw_producer(frame_factory, params, load_mode::synchronous);
 }
 
 }}
\ No newline at end of file
@@ -39,4 +39,8 @@ safe_ptr<core::frame_producer> create_thumbnail_producer(
 		const safe_ptr<core::frame_factory>& frame_factory,
 		const core::parameters& params);
 
+// Returns the media file with the first supported image extension that
+// exists for a name given without extension, or an empty string.
+std::wstring find_image_file(const std::wstring& name);
+
 }}
\ No newline at end of file
@@ -36,22 +36,29 @@
 #include <core/mixer/write_frame.h>
 
 #include <common/env.h>
+#include <common/concurrency/executor.h>
 #include <common/log/log.h>
 #include <common/memory/memclr.h>
 #include <common/exception/exceptions.h>
 #include <common/utility/tweener.h>
 
+#include <boost/algorithm/string.hpp>
 #include <boost/assign.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/foreach.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/optional.hpp>
 #include <boost/property_tree/ptree.hpp>
 #include <boost/gil/gil_all.hpp>
 
+#include <tbb/spin_mutex.h>
+
 #include <algorithm>
 #include <array>
+#include <map>
 #include <boost/math/special_functions/round.hpp>
-#include <boost/scoped_array.hpp>
+#include <boost/shared_array.hpp>
+#include <boost/thread/future.hpp>
 
 using namespace boost::assign;
 
@@ -59,21 +66,50 @@ namespace caspar { namespace image {
 
 struct image_scroll_producer : public core::frame_producer
 {	
+	// A frame sized slice of the image. Only the slices around the visible
+	// window are kept, the rest are cut from the decoded image when needed.
+	struct tile
+	{
+		boost::unique_future<safe_ptr<core::basic_frame>>	future;
+		std::shared_ptr<core::basic_frame>					frame;
+
+		safe_ptr<core::basic_frame> get()
+		{
+			if(!frame)
+				frame = future.get();
+
+			return safe_ptr<core::basic_frame>(frame);
+		}
+	};
+
 	core::monitor::subject						monitor_subject_;
 	const std::wstring							filename_;
-	std::vector<safe_ptr<core::basic_frame>>	frames_;
+	const safe_ptr<core::frame_factory>			frame_factory_;
 	core::video_format_desc						format_desc_;
 	size_t										width_;
 	size_t										height_;
 
+	std::shared_ptr<FIBITMAP>					bitmap_;
+	boost::shared_array<uint8_t>				blurred_copy_;
+	const uint8_t*								bytes_;
+	int											num_tiles_;
+	std::map<int, std::shared_ptr<tile>>		tiles_;
+
 	double										delta_;
 	double										speed_;
 
+	// Set by SPEED on the calling thread, speed_ picks it up on the next
+	// receive.
+	tbb::spin_mutex								requested_speed_mutex_;
+	boost::optional<double>						requested_speed_;
+
 	int											start_offset_x_;
 	int											start_offset_y_;
 	bool										progressive_;
 
 	safe_ptr<core::basic_frame>					last_frame_;
+
+	executor									loader_;
 	
 	explicit image_scroll_producer(
 		const safe_ptr<core::frame_factory>& frame_factory, 
@@ -84,20 +120,22 @@ struct image_scroll_producer : public core::frame_producer
 		bool premultiply_with_alpha = false,
 		bool progressive = false) 
 		: filename_(filename)
+		, frame_factory_(frame_factory)
 		, delta_(0)
 		, format_desc_(frame_factory->get_video_format_desc())
 		, speed_(speed)
 		, progressive_(progressive)
 		, last_frame_(core::basic_frame::empty())
+		, loader_(print())
 	{
 		start_offset_x_ = 0;
 		start_offset_y_ = 0;
 
-		auto bitmap = load_image(filename_);
-		FreeImage_FlipVertical(bitmap.get());
+		bitmap_ = load_image(filename_);
+		FreeImage_FlipVertical(bitmap_.get());
 
-		width_  = FreeImage_GetWidth(bitmap.get());
-		height_ = FreeImage_GetHeight(bitmap.get());
+		width_  = FreeImage_GetWidth(bitmap_.get());
+		height_ = FreeImage_GetHeight(bitmap_.get());
 
 		bool vertical = width_ == format_desc_.width;
 		bool horizontal = height_ == format_desc_.height;
@@ -139,15 +177,13 @@ struct image_scroll_producer : public core::frame_producer
 				start_offset_x_ = format_desc_.width - (width_ % format_desc_.width) + width_ + format_desc_.width;
 		}
 
-		auto bytes = FreeImage_GetBits(bitmap.get());
+		auto bytes = FreeImage_GetBits(bitmap_.get());
 		int count = width_*height_*4;
 		image_view<bgra_pixel> original_view(bytes, width_, height_);
 
 		if (premultiply_with_alpha)
 			premultiply(original_view);
 
-		boost::scoped_array<uint8_t> blurred_copy;
-
 		if (motion_blur_px > 0)
 		{
 			double angle = 3.14159265 / 2; // Up
@@ -159,119 +195,181 @@ struct image_scroll_producer : public core::frame_producer
 			else if (horizontal && speed  > 0)
 				angle = 0.0; // Right
 
-			blurred_copy.reset(new uint8_t[count]);
-			image_view<bgra_pixel> blurred_view(blurred_copy.get(), width_, height_);
+			blurred_copy_.reset(new uint8_t[count]);
+			image_view<bgra_pixel> blurred_view(blurred_copy_.get(), width_, height_);
 			tweener_t blur_tweener = get_tweener(L"easeInQuad");
 			blur(original_view, blurred_view, angle, motion_blur_px, blur_tweener);
-			bytes = blurred_copy.get();
-			bitmap.reset();
+			bytes = blurred_copy_.get();
+			bitmap_.reset();
 		}
 
-		if (vertical)
+		bytes_ = bytes;
+
+		const int tile_extent = vertical ? format_desc_.height : format_desc_.width;
+		const int image_extent = vertical ? height_ : width_;
+
+		num_tiles_ = (image_extent + tile_extent - 1) / tile_extent;
+
+		// Cut the first visible tiles here, so that the first frame does not
+		// wait for them on the render thread.
+		if(num_tiles_ > 0)
+			get_visible_tiles(position());
+
+		CASPAR_LOG(info) << print() << L" Initialized";
+	}
+	
+	~image_scroll_producer()
+	{
+		loader_.clear();
+	}
+
+	// Cuts tile n out of the decoded image. The tiles are numbered in the
+	// order they are drawn, tile n is placed n + 1 frames before the scroll
+	// position.
+	safe_ptr<core::basic_frame> create_tile(int n)
+	{
+		core::pixel_format_desc desc;
+		desc.pix_fmt = core::pixel_format::bgra;
+
+		if (width_ == format_desc_.width)
 		{
-			int n = 1;
+			desc.planes.push_back(core::pixel_format_desc::plane(width_, format_desc_.height, 4));
+			auto frame = frame_factory_->create_frame(reinterpret_cast<void*>(rand()), desc);
+
+			// Counted from the bottom of the image, the top tile is padded at the top.
+			const int size  = static_cast<int>(frame->image_data().size());
+			const int count = static_cast<int>(width_*height_*4) - n*size;
 
-			while(count > 0)
+			if(count >= size)
+				std::copy_n(bytes_ + count - size, size, frame->image_data().begin());
+			else
 			{
-				core::pixel_format_desc desc;
-				desc.pix_fmt = core::pixel_format::bgra;
-				desc.planes.push_back(core::pixel_format_desc::plane(width_, format_desc_.height, 4));
-				auto frame = frame_factory->create_frame(reinterpret_cast<void*>(rand()), desc);
-
-				if(count >= static_cast<int>(frame->image_data().size()))
-				{	
-					std::copy_n(bytes + count - frame->image_data().size(), frame->image_data().size(), frame->image_data().begin());
-					count -= frame->image_data().size();
-				}
-				else
-				{
-					fast_memclr(frame->image_data().begin(), frame->image_data().size());	
-					std::copy_n(bytes, count, frame->image_data().begin() + format_desc_.size - count);
-					count = 0;
-				}
-
-				frame->commit();
-				frames_.push_back(frame);
-
-				// Set the relative position to the other image fragments
-				frame->get_frame_transform().fill_translation[1] = - n++;
+				fast_memclr(frame->image_data().begin(), size);	
+				std::copy_n(bytes_, count, frame->image_data().begin() + size - count);
 			}
 
+			frame->commit();
+			frame->get_frame_transform().fill_translation[1] = - (n + 1);
+
+			return frame;
 		}
-		else if (horizontal)
+		else
 		{
-			int i = 0;
-			while(count > 0)
-			{
-				core::pixel_format_desc desc;
-				desc.pix_fmt = core::pixel_format::bgra;
-				desc.planes.push_back(core::pixel_format_desc::plane(format_desc_.width, height_, 4));
-				auto frame = frame_factory->create_frame(reinterpret_cast<void*>(rand()), desc);
-				if(count >= static_cast<int>(frame->image_data().size()))
-				{	
-					for(size_t y = 0; y < height_; ++y)
-						std::copy_n(bytes + i * format_desc_.width*4 + y * width_*4, format_desc_.width*4, frame->image_data().begin() + y * format_desc_.width*4);
-					
-					++i;
-					count -= frame->image_data().size();
-				}
-				else
-				{
-					fast_memclr(frame->image_data().begin(), frame->image_data().size());	
-					int width2 = width_ % format_desc_.width;
-					for(size_t y = 0; y < height_; ++y)
-						std::copy_n(bytes + i * format_desc_.width*4 + y * width_*4, width2*4, frame->image_data().begin() + y * format_desc_.width*4);
-
-					count = 0;
-				}
-			
-				frame->commit();
-				frames_.push_back(frame);
-			}
+			desc.planes.push_back(core::pixel_format_desc::plane(format_desc_.width, height_, 4));
+			auto frame = frame_factory_->create_frame(reinterpret_cast<void*>(rand()), desc);
+
+			// Counted from the right of the image, the leftmost tile is padded to the right.
+			const size_t i = num_tiles_ - 1 - n;
+			const size_t width = std::min(format_desc_.width, width_ - i * format_desc_.width);
+
+			if(width < format_desc_.width)
+				fast_memclr(frame->image_data().begin(), frame->image_data().size());	
+
+			for(size_t y = 0; y < height_; ++y)
+				std::copy_n(bytes_ + i * format_desc_.width*4 + y * width_*4, width*4, frame->image_data().begin() + y * format_desc_.width*4);
+
+			frame->commit();
+			frame->get_frame_transform().fill_translation[0] = - (n + 1);
+
+			return frame;
+		}
+	}
+
+	// Scroll position in tiles along the scroll axis.
+	double position() const
+	{
+		if (width_ == format_desc_.width)
+			return static_cast<double>(start_offset_y_) / static_cast<double>(format_desc_.height)
+				+ delta_ / static_cast<double>(format_desc_.height);
+		else
+			return static_cast<double>(start_offset_x_) / static_cast<double>(format_desc_.width)
+				+ delta_ / static_cast<double>(format_desc_.width);
+	}
+
+	// Enough tiles to cover the distance scrolled during one frame at the
+	// current speed.
+	int look_ahead() const
+	{
+		const int tile_extent = width_ == format_desc_.width ? format_desc_.height : format_desc_.width;
+
+		return 1 + static_cast<int>(std::ceil(std::abs(speed_) * format_desc_.field_count / tile_extent));
+	}
+
+	// Tile n covers [position - n - 1, position - n) along the scroll axis, so it
+	// overlaps the screen when position - 2 < n < position. Tiles further away
+	// than the look ahead are released, the ones within it are cut in the
+	// background.
+	std::vector<safe_ptr<core::basic_frame>> get_visible_tiles(double position)
+	{
+		const int first = std::max(0, static_cast<int>(std::floor(position)) - 1);
+		const int last  = std::min(num_tiles_ - 1, static_cast<int>(std::ceil(position)) - 1);
+
+		const int look_ahead = this->look_ahead();
+		const int keep_first = first - look_ahead;
+		const int keep_last  = last + look_ahead;
+
+		auto it = tiles_.begin();
+		while(it != tiles_.end())
+		{
+			if(it->first < keep_first || it->first > keep_last)
+				it = tiles_.erase(it);
+			else
+				++it;
+		}
 
-			std::reverse(frames_.begin(), frames_.end());
+		for(int n = std::max(0, keep_first); n <= std::min(num_tiles_ - 1, keep_last); ++n)
+		{
+			if(tiles_.find(n) != tiles_.end())
+				continue;
 
-			// Set the relative positions of the image fragments.
-			for (size_t n = 0; n < frames_.size(); ++n)
+			auto t = std::make_shared<tile>();
+			t->future = loader_.begin_invoke([=]
 			{
-				double translation = - (static_cast<double>(n) + 1.0);
-				frames_[n]->get_frame_transform().fill_translation[0] = translation;
-			}
+				return create_tile(n);
+			});
+
+			tiles_[n] = t;
 		}
 
-		CASPAR_LOG(info) << print() << L" Initialized";
+		std::vector<safe_ptr<core::basic_frame>> result;
+
+		for(int n = first; n <= last; ++n)
+			result.push_back(tiles_[n]->get());
+
+		return result;
 	}
-	
+
 	// frame_producer
 
 	safe_ptr<core::basic_frame> render_frame(bool allow_eof)
 	{
-		if(frames_.empty())
+		if(num_tiles_ == 0)
 			return core::basic_frame::eof();
 		
-		auto result = make_safe<core::basic_frame>(frames_);
-		auto& fill_translation = result->get_frame_transform().fill_translation;
-
 		if (width_ == format_desc_.width)
 		{
 			if (static_cast<size_t>(std::abs(delta_)) >= height_ + format_desc_.height && allow_eof)
 				return core::basic_frame::eof();
 
-			fill_translation[1] = 
-				static_cast<double>(start_offset_y_) / static_cast<double>(format_desc_.height)
-				+ delta_ / static_cast<double>(format_desc_.height);
+			const double position = this->position();
+
+			auto result = make_safe<core::basic_frame>(get_visible_tiles(position));
+			result->get_frame_transform().fill_translation[1] = position;
+
+			return result;
 		}
 		else
 		{
 			if (static_cast<size_t>(std::abs(delta_)) >= width_ + format_desc_.width && allow_eof)
 				return core::basic_frame::eof();
 
-			fill_translation[0] = 
-				static_cast<double>(start_offset_x_) / static_cast<double>(format_desc_.width)
-				+ (delta_) / static_cast<double>(format_desc_.width);
-		}
+			const double position = this->position();
 
-		return result;
+			auto result = make_safe<core::basic_frame>(get_visible_tiles(position));
+			result->get_frame_transform().fill_translation[0] = position;
+
+			return result;
+		}
 	}
 
 	safe_ptr<core::basic_frame> render_frame(bool allow_eof, bool advance_delta)
@@ -291,8 +389,21 @@ struct image_scroll_producer : public core::frame_producer
 		delta_ += speed_;
 	}
 
+	void apply_requested_speed()
+	{
+		tbb::spin_mutex::scoped_lock lock(requested_speed_mutex_);
+
+		if (requested_speed_)
+		{
+			speed_ = *requested_speed_;
+			requested_speed_.reset();
+		}
+	}
+
 	virtual safe_ptr<core::basic_frame> receive(int) override
 	{
+		apply_requested_speed();
+
 		if (format_desc_.field_mode == core::field_mode::progressive || progressive_)
 		{
 			return last_frame_ = render_frame(true, true);
@@ -321,6 +432,13 @@ struct image_scroll_producer : public core::frame_producer
 	{
 		return last_frame_;
 	}
+
+	virtual boost::unique_future<std::wstring> call(const std::wstring& param) override
+	{
+		boost::promise<std::wstring> promise;
+		promise.set_value(do_call(param));
+		return promise.get_future();
+	}
 		
 	virtual std::wstring print() const override
 	{
@@ -353,6 +471,31 @@ struct image_scroll_producer : public core::frame_producer
 	{
 		return monitor_subject_;
 	}
+
+	// image_scroll_producer
+
+	// SPEED [pixels per field] changes the scroll speed, the tiles kept ahead
+	// of the screen follow it from the next frame.
+	std::wstring do_call(const std::wstring& param)
+	{
+		std::vector<std::wstring> params;
+		boost::split(params, param, boost::is_any_of(L" "), boost::token_compress_on);
+
+		if(params.size() != 2 || !boost::iequals(params[0], L"SPEED"))
+			BOOST_THROW_EXCEPTION(invalid_argument());
+
+		auto speed = -boost::lexical_cast<double>(params[1]);
+
+		if(speed == 0.0)
+			BOOST_THROW_EXCEPTION(invalid_argument() << msg_info("Speed can not be 0."));
+
+		{
+			tbb::spin_mutex::scoped_lock lock(requested_speed_mutex_);
+			requested_speed_ = speed;
+		}
+
+		return boost::lexical_cast<std::wstring>(-speed);
+	}
 };
 
 safe_ptr<core::frame_producer> create_scroll_producer(
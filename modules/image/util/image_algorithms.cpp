@@ -23,8 +23,215 @@
 #include <stdint.h>
 #include "../util/image_algorithms.h"
 
+#include <intrin.h>
+
+#include <tbb/parallel_for.h>
+
+#include <algorithm>
+
 namespace caspar { namespace image {
 
+namespace {
+
+// The weighted taps of a blur as offsets in pixels from the destination pixel.
+// The pixel itself is the last tap.
+struct blur_taps
+{
+	std::vector<int>		offsets;
+	std::vector<uint8_t>	weights;
+	int						trail_length;
+	int						total_weight;
+	int						min_offset;
+	int						max_offset;
+};
+
+// Same as the generic blur, including that the trail stops at the first tap
+// outside of the image.
+inline void blur_pixel(
+	const bgra_pixel* src, 
+	int count, 
+	int n, 
+	const blur_taps& taps, 
+	bgra_pixel& dst)
+{
+	rgba_weighting w;
+
+	for (int i = 0; i < taps.trail_length; ++i)
+	{
+		const int other = n + taps.offsets[i];
+
+		if (other < 0 || other >= count)
+			break;
+
+		w.add_pixel(src[other], taps.weights[i]);
+	}
+
+	w.add_pixel(src[n], 255);
+	w.store_result(dst);
+}
+
+// Blurs the four pixels at n, where every tap is known to be inside the image.
+// The taps are processed in pairs so that one madd weights two taps of a
+// channel at once. The division by the total weight is done in single
+// precision, with half added to make the truncation match integer division.
+inline void blur_pixels(
+	const bgra_pixel* src, 
+	int n, 
+	const blur_taps& taps, 
+	const __m128 inv_total_weight,
+	bgra_pixel* dst)
+{
+	const __m128i zero = _mm_setzero_si128();
+
+	__m128i acc0 = zero;
+	__m128i acc1 = zero;
+	__m128i acc2 = zero;
+	__m128i acc3 = zero;
+
+	for (size_t i = 0; i < taps.offsets.size(); i += 2)
+	{
+		const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + n + taps.offsets[i]));
+		const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + n + taps.offsets[i + 1]));
+		const __m128i w = _mm_set1_epi32(taps.weights[i] | (taps.weights[i + 1] << 16));
+
+		const __m128i a_lo = _mm_unpacklo_epi8(a, zero);
+		const __m128i a_hi = _mm_unpackhi_epi8(a, zero);
+		const __m128i b_lo = _mm_unpacklo_epi8(b, zero);
+		const __m128i b_hi = _mm_unpackhi_epi8(b, zero);
+
+		acc0 = _mm_add_epi32(acc0, _mm_madd_epi16(_mm_unpacklo_epi16(a_lo, b_lo), w));
+		acc1 = _mm_add_epi32(acc1, _mm_madd_epi16(_mm_unpackhi_epi16(a_lo, b_lo), w));
+		acc2 = _mm_add_epi32(acc2, _mm_madd_epi16(_mm_unpacklo_epi16(a_hi, b_hi), w));
+		acc3 = _mm_add_epi32(acc3, _mm_madd_epi16(_mm_unpackhi_epi16(a_hi, b_hi), w));
+	}
+
+	const __m128 half = _mm_set1_ps(0.5f);
+
+	const __m128i r0 = _mm_cvttps_epi32(_mm_mul_ps(_mm_add_ps(_mm_cvtepi32_ps(acc0), half), inv_total_weight));
+	const __m128i r1 = _mm_cvttps_epi32(_mm_mul_ps(_mm_add_ps(_mm_cvtepi32_ps(acc1), half), inv_total_weight));
+	const __m128i r2 = _mm_cvttps_epi32(_mm_mul_ps(_mm_add_ps(_mm_cvtepi32_ps(acc2), half), inv_total_weight));
+	const __m128i r3 = _mm_cvttps_epi32(_mm_mul_ps(_mm_add_ps(_mm_cvtepi32_ps(acc3), half), inv_total_weight));
+
+	_mm_storeu_si128(
+		reinterpret_cast<__m128i*>(dst + n), 
+		_mm_packus_epi16(_mm_packs_epi32(r0, r1), _mm_packs_epi32(r2, r3)));
+}
+
+}
+
+void blur(
+	const image_view<bgra_pixel>& src,
+	image_view<bgra_pixel>& dst,
+	const std::vector<std::pair<int, int>>& motion_trail_coordinates, 
+	caspar::tweener_t& tweener)
+{
+	int blur_px = motion_trail_coordinates.size();
+	auto tweened_weights_y = get_tweened_values<uint8_t>(tweener, blur_px + 2, 255, 0);
+	tweened_weights_y.pop_back();
+	tweened_weights_y.erase(tweened_weights_y.begin());
+
+	blur_taps taps;
+	taps.trail_length	= blur_px;
+	taps.total_weight	= 255;
+	taps.min_offset		= 0;
+	taps.max_offset		= 0;
+
+	for (int i = 0; i < blur_px; ++i)
+	{
+		const int offset = motion_trail_coordinates[i].first + src.width() * motion_trail_coordinates[i].second;
+
+		taps.offsets.push_back(offset);
+		taps.weights.push_back(tweened_weights_y[i]);
+		taps.total_weight	+= tweened_weights_y[i];
+		taps.min_offset		= std::min(taps.min_offset, offset);
+		taps.max_offset		= std::max(taps.max_offset, offset);
+	}
+
+	taps.offsets.push_back(0);
+	taps.weights.push_back(255);
+
+	// Pad to whole pairs with a tap that does not contribute.
+	if (taps.offsets.size() % 2 != 0)
+	{
+		taps.offsets.push_back(0);
+		taps.weights.push_back(0);
+	}
+
+	const bgra_pixel*	src_pixels	= src.begin();
+	bgra_pixel*			dst_pixels	= dst.begin();
+	const int			count		= src.width() * src.height();
+
+	const int interior_begin	= -taps.min_offset;
+	const int interior_end		= count - taps.max_offset;
+	const __m128 inv_total_weight = _mm_set1_ps(1.0f / static_cast<float>(taps.total_weight));
+
+	tbb::parallel_for(tbb::blocked_range<int>(0, count, 16384), [&](const tbb::blocked_range<int>& r)
+	{
+		const int vector_end = std::min(r.end(), interior_end);
+
+		int n = r.begin();
+
+		while (n < r.end())
+		{
+			if (n >= interior_begin && n + 4 <= vector_end)
+			{
+				blur_pixels(src_pixels, n, taps, inv_total_weight, dst_pixels);
+				n += 4;
+			}
+			else
+			{
+				blur_pixel(src_pixels, count, n, taps, dst_pixels[n]);
+				++n;
+			}
+		}
+	});
+}
+
+void premultiply(image_view<bgra_pixel>& view_to_modify)
+{
+	auto pixels = view_to_modify.begin();
+	const int count = view_to_modify.width() * view_to_modify.height();
+
+	tbb::parallel_for(tbb::blocked_range<int>(0, count, 16384), [&](const tbb::blocked_range<int>& r)
+	{
+		const __m128i zero			= _mm_setzero_si128();
+		const __m128i alpha_shuffle	= _mm_setr_epi8(3, 3, 3, -1, 7, 7, 7, -1, 11, 11, 11, -1, 15, 15, 15, -1);
+		const __m128i alpha_255		= _mm_set1_epi32(static_cast<int>(0xFF000000));
+		const __m128i one			= _mm_set1_epi16(1);
+
+		int n = r.begin();
+
+		for (; n + 4 <= r.end(); n += 4)
+		{
+			auto address = reinterpret_cast<__m128i*>(pixels + n);
+
+			const __m128i px = _mm_loadu_si128(address);
+
+			// Each color is multiplied by the alpha and the alpha by 255.
+			const __m128i alpha = _mm_or_si128(_mm_shuffle_epi8(px, alpha_shuffle), alpha_255);
+
+			__m128i lo = _mm_mullo_epi16(_mm_unpacklo_epi8(px, zero), _mm_unpacklo_epi8(alpha, zero));
+			__m128i hi = _mm_mullo_epi16(_mm_unpackhi_epi8(px, zero), _mm_unpackhi_epi8(alpha, zero));
+
+			// x / 255 for x <= 255 * 255, truncated like the integer division.
+			lo = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(lo, one), _mm_srli_epi16(lo, 8)), 8);
+			hi = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(hi, one), _mm_srli_epi16(hi, 8)), 8);
+
+			_mm_storeu_si128(address, _mm_packus_epi16(lo, hi));
+		}
+
+		for (; n < r.end(); ++n)
+		{
+			auto& pixel = pixels[n];
+			const int alpha = pixel.a();
+
+			pixel.r() = static_cast<uint8_t>(pixel.r() * alpha / 255);
+			pixel.g() = static_cast<uint8_t>(pixel.g() * alpha / 255);
+			pixel.b() = static_cast<uint8_t>(pixel.b() * alpha / 255);
+		}
+	});
+}
+
 std::vector<std::pair<int, int>> get_line_points(int num_pixels, double angle_radians)
 {
 	std::vector<std::pair<int, int>> line_points;
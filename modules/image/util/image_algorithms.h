@@ -21,9 +21,12 @@
 
 #pragma once
 
+#include "image_view.h"
+
 #include <common/utility/tweener.h>
 
 #include <cmath>
+#include <vector>
 #include <boost/foreach.hpp>
 
 namespace caspar { namespace image {
@@ -141,6 +144,19 @@ void blur(
 	}
 }
 
+/**
+ * Blur a BGRA image. Gives the same result as the generic version but
+ * processes four pixels at a time with SSE and splits the image over the
+ * available cores. Pixels whose whole motion trail is inside the image take
+ * the vectorized path, the ones near the edges fall back to the generic
+ * weighting.
+ */
+void blur(
+	const image_view<bgra_pixel>& src,
+	image_view<bgra_pixel>& dst,
+	const std::vector<std::pair<int, int>>& motion_trail_coordinates, 
+	caspar::tweener_t& tweener);
+
 /**
  * Calculate relative x-y coordinates of a straight line with a given angle and
  * a given number of points.
@@ -212,4 +228,13 @@ void premultiply(SrcDstView& view_to_modify)
 	});
 }
 
+/**
+ * Premultiply a BGRA image in place. Gives the same result as the generic
+ * version but processes four pixels at a time with SSE and splits the image
+ * over the available cores.
+ *
+ * @param view_to_modify The image view to premultiply in place.
+ */
+void premultiply(image_view<bgra_pixel>& view_to_modify);
+
 }}
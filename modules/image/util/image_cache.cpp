@@ -0,0 +1,293 @@
+/*
+* Copyright 2026 Sveriges Television AB http://casparcg.com/
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "image_cache.h"
+
+#include "image_loader.h"
+
+#include <common/concurrency/executor.h>
+#include <common/exception/exceptions.h>
+#include <common/log/log.h>
+#include <common/utility/string.h>
+
+#include <boost/algorithm/string/case_conv.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/exception/errinfo_file_name.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/foreach.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/thread/future.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <algorithm>
+#include <ctime>
+#include <list>
+#include <map>
+#include <vector>
+
+namespace caspar { namespace image {
+
+struct image_cache::implementation : boost::noncopyable
+{
+	typedef boost::shared_future<std::shared_ptr<FIBITMAP>> pending_load;
+
+	struct entry
+	{
+		std::wstring				key;
+		std::time_t					write_time;
+		std::shared_ptr<FIBITMAP>	bitmap;
+		size_t						size;
+	};
+
+	mutable boost::mutex											mutex_;
+	std::list<entry>												lru_; // Most recently used first.
+	std::map<std::wstring, std::list<entry>::iterator>				entries_;
+	std::map<std::wstring, std::pair<std::time_t, pending_load>>	pending_;
+	size_t															budget_;
+	size_t															size_;
+	int64_t															hits_;
+	int64_t															misses_;
+	int64_t															evictions_;
+	int64_t															prefetches_;
+
+	std::vector<std::shared_ptr<executor>>							workers_;
+
+	implementation()
+		: budget_(0)
+		, size_(0)
+		, hits_(0)
+		, misses_(0)
+		, evictions_(0)
+		, prefetches_(0)
+	{
+		const int num_workers = std::max(1, std::min(4, static_cast<int>(boost::thread::hardware_concurrency()) / 2));
+
+		for (int n = 0; n < num_workers; ++n)
+			workers_.push_back(std::make_shared<executor>(L"image_cache" + boost::lexical_cast<std::wstring>(n)));
+	}
+
+	~implementation()
+	{
+		BOOST_FOREACH(auto& worker, workers_)
+			worker->clear();
+
+		workers_.clear();
+	}
+
+	executor& worker()
+	{
+		auto least_busy = std::min_element(workers_.begin(), workers_.end(), [](const std::shared_ptr<executor>& lhs, const std::shared_ptr<executor>& rhs)
+		{
+			return lhs->size() < rhs->size();
+		});
+
+		return **least_busy;
+	}
+
+	void set_budget(size_t bytes)
+	{
+		boost::lock_guard<boost::mutex> lock(mutex_);
+
+		budget_ = bytes;
+		evict();
+	}
+
+	std::shared_ptr<FIBITMAP> get(const std::wstring& filename)
+	{
+		if (!boost::filesystem::is_regular_file(filename))
+			BOOST_THROW_EXCEPTION(file_not_found() << boost::errinfo_file_name(narrow(filename)));
+
+		const auto key			= boost::to_lower_copy(boost::filesystem::absolute(filename).make_preferred().wstring());
+		const auto write_time	= boost::filesystem::last_write_time(filename);
+
+		boost::promise<std::shared_ptr<FIBITMAP>> promise;
+
+		{
+			boost::unique_lock<boost::mutex> lock(mutex_);
+
+			auto it = entries_.find(key);
+
+			if (it != entries_.end() && it->second->write_time == write_time)
+			{
+				++hits_;
+				lru_.splice(lru_.begin(), lru_, it->second);
+				return it->second->bitmap;
+			}
+
+			// Another producer or the prefetcher is already decoding the same file.
+			auto pending = pending_.find(key);
+
+			if (pending != pending_.end() && pending->second.first == write_time)
+			{
+				++hits_;
+				auto load = pending->second.second;
+				lock.unlock();
+
+				return load.get();
+			}
+
+			++misses_;
+			pending_[key] = std::make_pair(write_time, pending_load(promise.get_future()));
+		}
+
+		try
+		{
+			auto bitmap = load_image(filename);
+			FreeImage_FlipVertical(bitmap.get());
+
+			{
+				boost::lock_guard<boost::mutex> lock(mutex_);
+
+				remove_pending(key, write_time);
+				insert(key, write_time, bitmap);
+			}
+
+			promise.set_value(bitmap);
+
+			return bitmap;
+		}
+		catch(...)
+		{
+			{
+				boost::lock_guard<boost::mutex> lock(mutex_);
+
+				remove_pending(key, write_time);
+			}
+
+			promise.set_exception(boost::current_exception());
+
+			throw;
+		}
+	}
+
+	void prefetch(const std::wstring& filename)
+	{
+		{
+			boost::lock_guard<boost::mutex> lock(mutex_);
+
+			if (budget_ == 0)
+				return;
+
+			++prefetches_;
+		}
+
+		worker().begin_invoke([=]
+		{
+			try
+			{
+				get(filename);
+			}
+			catch(...)
+			{
+				CASPAR_LOG_CURRENT_EXCEPTION();
+			}
+		});
+	}
+
+	void clear()
+	{
+		boost::lock_guard<boost::mutex> lock(mutex_);
+
+		lru_.clear();
+		entries_.clear();
+		size_ = 0;
+	}
+
+	boost::property_tree::wptree info() const
+	{
+		boost::lock_guard<boost::mutex> lock(mutex_);
+
+		boost::property_tree::wptree info;
+		info.add(L"image-cache.entries",		entries_.size());
+		info.add(L"image-cache.size",			size_);
+		info.add(L"image-cache.budget",			budget_);
+		info.add(L"image-cache.hits",			hits_);
+		info.add(L"image-cache.misses",			misses_);
+		info.add(L"image-cache.evictions",		evictions_);
+		info.add(L"image-cache.prefetches",		prefetches_);
+		info.add(L"image-cache.pending",		pending_.size());
+		return info;
+	}
+
+	// The following expect mutex_ to be held.
+
+	void remove_pending(const std::wstring& key, std::time_t write_time)
+	{
+		auto pending = pending_.find(key);
+
+		if (pending != pending_.end() && pending->second.first == write_time)
+			pending_.erase(pending);
+	}
+
+	void insert(const std::wstring& key, std::time_t write_time, const std::shared_ptr<FIBITMAP>& bitmap)
+	{
+		auto it = entries_.find(key);
+
+		if (it != entries_.end())
+		{
+			size_ -= it->second->size;
+			lru_.erase(it->second);
+			entries_.erase(it);
+		}
+
+		entry e;
+		e.key			= key;
+		e.write_time	= write_time;
+		e.bitmap		= bitmap;
+		e.size			= FreeImage_GetPitch(bitmap.get()) * FreeImage_GetHeight(bitmap.get());
+
+		if (e.size > budget_)
+			return;
+
+		lru_.push_front(e);
+		entries_[key] = lru_.begin();
+		size_ += e.size;
+
+		evict();
+	}
+
+	void evict()
+	{
+		while (size_ > budget_ && !lru_.empty())
+		{
+			size_ -= lru_.back().size;
+			entries_.erase(lru_.back().key);
+			lru_.pop_back();
+			++evictions_;
+		}
+	}
+};
+
+image_cache::image_cache() : impl_(new implementation()){}
+void image_cache::set_budget(size_t bytes){impl_->set_budget(bytes);}
+std::shared_ptr<FIBITMAP> image_cache::get(const std::wstring& filename){return impl_->get(filename);}
+void image_cache::prefetch(const std::wstring& filename){impl_->prefetch(filename);}
+executor& image_cache::worker(){return impl_->worker();}
+void image_cache::clear(){impl_->clear();}
+boost::property_tree::wptree image_cache::info() const{return impl_->info();}
+
+image_cache& get_image_cache()
+{
+	// First called from init() before any producers exist.
+	static image_cache cache;
+	return cache;
+}
+
+}}
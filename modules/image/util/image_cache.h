@@ -0,0 +1,72 @@
+/*
+* Copyright 2026 Sveriges Television AB http://casparcg.com/
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <common/concurrency/executor.h>
+#include <common/memory/safe_ptr.h>
+
+#include <boost/noncopyable.hpp>
+#include <boost/property_tree/ptree_fwd.hpp>
+
+#include <FreeImage.h>
+
+#include <memory>
+#include <string>
+
+namespace caspar { namespace image {
+
+// Process wide cache of decoded images, keyed by path and modification time.
+// Cached bitmaps are 32 bit, premultiplied and flipped to top-down row order.
+// They are shared between producers and must not be modified.
+class image_cache : boost::noncopyable
+{
+public:
+	image_cache();
+
+	// A budget of 0 disables caching, images are then decoded on every get().
+	void set_budget(size_t bytes);
+
+	std::shared_ptr<FIBITMAP> get(const std::wstring& filename);
+	void prefetch(const std::wstring& filename);
+
+	// Gets the image on one of the decoding threads and passes it to func on
+	// the same thread, so that whatever is done with a large image does not
+	// block the caller either.
+	template<typename Func>
+	auto get_async(const std::wstring& filename, Func&& func) -> boost::unique_future<decltype(func(std::shared_ptr<FIBITMAP>()))>
+	{
+		return worker().begin_invoke([=]
+		{
+			return func(get(filename));
+		});
+	}
+	void clear();
+
+	boost::property_tree::wptree info() const;
+private:
+	executor& worker();
+
+	struct implementation;
+	safe_ptr<implementation> impl_;
+};
+
+image_cache& get_image_cache();
+
+}}
@@ -36,7 +36,7 @@
 
 namespace caspar { namespace image {
 
-std::shared_ptr<FIBITMAP> load_image(const std::wstring& filename)
+FREE_IMAGE_FORMAT probe_image(const std::wstring& filename)
 {
 	if(!boost::filesystem::exists(filename))
 		BOOST_THROW_EXCEPTION(file_not_found() << boost::errinfo_file_name(narrow(filename)));
@@ -48,6 +48,13 @@ std::shared_ptr<FIBITMAP> load_image(const std::wstring& filename)
 		
 	if(fif == FIF_UNKNOWN || !FreeImage_FIFSupportsReading(fif)) 
 		BOOST_THROW_EXCEPTION(invalid_argument() << msg_info("Unsupported image format."));
+
+	return fif;
+}
+
+std::shared_ptr<FIBITMAP> load_image(const std::wstring& filename)
+{
+	auto fif = probe_image(filename);
 		
 	auto bitmap = std::shared_ptr<FIBITMAP>(FreeImage_LoadU(fif, filename.c_str(), 0), FreeImage_Unload);
 		  
@@ -28,6 +28,10 @@
 
 namespace caspar { namespace image {
 
+// Reads the format from the file header without decoding the image. Throws
+// like load_image if the file is missing or its format can not be read.
+FREE_IMAGE_FORMAT probe_image(const std::wstring& filename);
+
 std::shared_ptr<FIBITMAP> load_image(const std::string& filename);
 std::shared_ptr<FIBITMAP> load_image(const std::wstring& filename);
 std::shared_ptr<FIBITMAP> load_png_from_memory(const void* memory_location, size_t size);
@@ -0,0 +1,350 @@
+/*
+* Copyright 2026 Sveriges Television AB http://casparcg.com/
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "png_encoder.h"
+
+#include <common/env.h>
+#include <common/exception/exceptions.h>
+#include <common/utility/string.h>
+
+#include <boost/exception/errinfo_file_name.hpp>
+#include <boost/filesystem/fstream.hpp>
+
+#include <tbb/parallel_for.h>
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+namespace caspar { namespace image {
+
+namespace {
+
+// Enough input per block to keep deflate efficient, the same as pigz.
+const size_t	block_size			= 128 * 1024;
+const size_t	dictionary_size		= 32 * 1024;
+
+struct deflated_block
+{
+	std::vector<uint8_t>	data;
+	uLong					adler;
+};
+
+void bgra_to_rgba(const uint8_t* source, uint8_t* dest, int width)
+{
+	for (int x = 0; x < width; ++x, source += 4, dest += 4)
+	{
+		dest[0] = source[2];
+		dest[1] = source[1];
+		dest[2] = source[0];
+		dest[3] = source[3];
+	}
+}
+
+uint8_t paeth_predictor(int a, int b, int c)
+{
+	int p	= a + b - c;
+	int pa	= std::abs(p - a);
+	int pb	= std::abs(p - b);
+	int pc	= std::abs(p - c);
+
+	if (pa <= pb && pa <= pc)
+		return static_cast<uint8_t>(a);
+	else if (pb <= pc)
+		return static_cast<uint8_t>(b);
+	else
+		return static_cast<uint8_t>(c);
+}
+
+// Writes the filter type byte followed by the filtered row. prev is null
+// for the first row of the image.
+void filter_row(png_filter::type filter, const uint8_t* row, const uint8_t* prev, uint8_t* dest, int bytes)
+{
+	*dest++ = static_cast<uint8_t>(filter);
+
+	switch (filter)
+	{
+	case png_filter::none:
+		std::copy(row, row + bytes, dest);
+		break;
+	case png_filter::sub:
+		std::copy(row, row + 4, dest);
+		for (int i = 4; i < bytes; ++i)
+			dest[i] = static_cast<uint8_t>(row[i] - row[i - 4]);
+		break;
+	case png_filter::up:
+		for (int i = 0; i < bytes; ++i)
+			dest[i] = static_cast<uint8_t>(row[i] - (prev ? prev[i] : 0));
+		break;
+	case png_filter::average:
+		for (int i = 0; i < bytes; ++i)
+		{
+			int a = i >= 4 ? row[i - 4] : 0;
+			int b = prev ? prev[i] : 0;
+			dest[i] = static_cast<uint8_t>(row[i] - ((a + b) >> 1));
+		}
+		break;
+	case png_filter::paeth:
+		for (int i = 0; i < bytes; ++i)
+		{
+			int a = i >= 4 ? row[i - 4] : 0;
+			int b = prev ? prev[i] : 0;
+			int c = i >= 4 && prev ? prev[i - 4] : 0;
+			dest[i] = static_cast<uint8_t>(row[i] - paeth_predictor(a, b, c));
+		}
+		break;
+	}
+}
+
+// The usual heuristic, the filter giving the smallest sum of the residuals
+// seen as signed bytes tends to compress best.
+void filter_row_adaptive(const uint8_t* row, const uint8_t* prev, uint8_t* dest, int bytes, std::vector<uint8_t>& scratch)
+{
+	scratch.resize(bytes + 1);
+
+	uint64_t best_sum = ~0ull;
+
+	for (int filter = png_filter::none; filter <= png_filter::paeth; ++filter)
+	{
+		filter_row(static_cast<png_filter::type>(filter), row, prev, scratch.data(), bytes);
+
+		uint64_t sum = 0;
+		for (int i = 1; i <= bytes; ++i)
+			sum += std::abs(static_cast<int8_t>(scratch[i]));
+
+		if (sum < best_sum)
+		{
+			best_sum = sum;
+			std::copy(scratch.begin(), scratch.end(), dest);
+		}
+	}
+}
+
+// Deflates one block as raw deflate data ending on a byte boundary, so that
+// the blocks can simply be concatenated. The last block finishes the stream.
+deflated_block deflate_block(const uint8_t* begin, const uint8_t* end, const uint8_t* dictionary, size_t dictionary_length, int level, bool last)
+{
+	z_stream stream = {};
+
+	if (deflateInit2(&stream, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+		BOOST_THROW_EXCEPTION(caspar_exception() << msg_info("Could not initialize deflate."));
+
+	if (dictionary_length > 0)
+		deflateSetDictionary(&stream, dictionary, static_cast<uInt>(dictionary_length));
+
+	deflated_block block;
+	block.adler = adler32(adler32(0, nullptr, 0), begin, static_cast<uInt>(end - begin));
+	block.data.resize(deflateBound(&stream, static_cast<uLong>(end - begin)) + 16);
+
+	stream.next_in		= const_cast<Bytef*>(begin);
+	stream.avail_in		= static_cast<uInt>(end - begin);
+
+	int result;
+
+	do
+	{
+		if (stream.total_out == block.data.size())
+			block.data.resize(block.data.size() * 2);
+
+		stream.next_out		= block.data.data() + stream.total_out;
+		stream.avail_out	= static_cast<uInt>(block.data.size() - stream.total_out);
+
+		result = deflate(&stream, last ? Z_FINISH : Z_SYNC_FLUSH);
+	}
+	while (stream.avail_out == 0 || (last && result != Z_STREAM_END));
+
+	block.data.resize(stream.total_out);
+	deflateEnd(&stream);
+
+	return block;
+}
+
+void put_uint32(std::vector<uint8_t>& dest, uint32_t value)
+{
+	dest.push_back(static_cast<uint8_t>(value >> 24));
+	dest.push_back(static_cast<uint8_t>(value >> 16));
+	dest.push_back(static_cast<uint8_t>(value >> 8));
+	dest.push_back(static_cast<uint8_t>(value));
+}
+
+// zlib treats a null buffer as a request for the initial value.
+uLong update_crc(uLong crc, const uint8_t* data, size_t length)
+{
+	return length > 0 ? crc32(crc, data, static_cast<uInt>(length)) : crc;
+}
+
+void write_chunk(boost::filesystem::ofstream& file, const char* type, const uint8_t* prefix, size_t prefix_length, const std::vector<uint8_t>& data, const uint8_t* suffix, size_t suffix_length)
+{
+	std::vector<uint8_t> header;
+	put_uint32(header, static_cast<uint32_t>(prefix_length + data.size() + suffix_length));
+	header.insert(header.end(), type, type + 4);
+
+	uLong crc = crc32(0, reinterpret_cast<const Bytef*>(type), 4);
+	crc = update_crc(crc, prefix, prefix_length);
+	crc = update_crc(crc, data.data(), data.size());
+	crc = update_crc(crc, suffix, suffix_length);
+
+	std::vector<uint8_t> footer;
+	put_uint32(footer, static_cast<uint32_t>(crc));
+
+	file.write(reinterpret_cast<const char*>(header.data()), header.size());
+	file.write(reinterpret_cast<const char*>(prefix), prefix_length);
+	file.write(reinterpret_cast<const char*>(data.data()), data.size());
+	file.write(reinterpret_cast<const char*>(suffix), suffix_length);
+	file.write(reinterpret_cast<const char*>(footer.data()), footer.size());
+}
+
+}
+
+png_filter::type get_png_filter(const std::wstring& name)
+{
+	if (name == L"none")
+		return png_filter::none;
+	else if (name == L"sub")
+		return png_filter::sub;
+	else if (name == L"up")
+		return png_filter::up;
+	else if (name == L"average")
+		return png_filter::average;
+	else if (name == L"paeth")
+		return png_filter::paeth;
+	else if (name == L"adaptive")
+		return png_filter::adaptive;
+
+	BOOST_THROW_EXCEPTION(invalid_argument() << msg_info("Unknown png filter.") << arg_name_info("filter") << arg_value_info(narrow(name)));
+}
+
+png_options get_configured_png_options()
+{
+	png_options options;
+	options.compression_level	= std::max(0, std::min(9, env::properties().get(L"configuration.image.png-compression-level", options.compression_level)));
+	options.filter				= get_png_filter(env::properties().get(L"configuration.image.png-filter", std::wstring(L"adaptive")));
+
+	return options;
+}
+
+void write_png(
+		const uint8_t* bgra,
+		int width,
+		int height,
+		int stride,
+		const boost::filesystem::path& output_file,
+		const png_options& options)
+{
+	const int		row_bytes		= width * 4;
+	const size_t	filtered_stride	= row_bytes + 1;
+	const int		block_rows		= static_cast<int>(std::max<size_t>(1, block_size / filtered_stride));
+	const int		num_blocks		= (height + block_rows - 1) / block_rows;
+
+	// Rows are filtered against the previous row of the image, so every block
+	// converts the row before it as well.
+	std::vector<uint8_t> filtered(filtered_stride * height);
+
+	tbb::parallel_for(0, num_blocks, [&](int block)
+	{
+		const int begin	= block * block_rows;
+		const int end	= std::min(height, begin + block_rows);
+
+		std::vector<uint8_t> row(row_bytes);
+		std::vector<uint8_t> prev(row_bytes);
+		std::vector<uint8_t> scratch;
+
+		if (begin > 0)
+			bgra_to_rgba(bgra + (begin - 1) * stride, prev.data(), width);
+
+		for (int y = begin; y < end; ++y)
+		{
+			bgra_to_rgba(bgra + y * stride, row.data(), width);
+
+			auto dest		= filtered.data() + y * filtered_stride;
+			auto prev_row	= y > 0 ? prev.data() : nullptr;
+
+			if (options.filter == png_filter::adaptive)
+				filter_row_adaptive(row.data(), prev_row, dest, row_bytes, scratch);
+			else
+				filter_row(options.filter, row.data(), prev_row, dest, row_bytes);
+
+			std::swap(row, prev);
+		}
+	});
+
+	std::vector<deflated_block> blocks(num_blocks);
+
+	tbb::parallel_for(0, num_blocks, [&](int block)
+	{
+		auto begin		= filtered.data() + block * block_rows * filtered_stride;
+		auto end		= filtered.data() + std::min<size_t>(filtered.size(), (block + 1) * block_rows * filtered_stride);
+		auto dictionary	= std::max(filtered.data(), begin - dictionary_size);
+
+		blocks[block] = deflate_block(begin, end, dictionary, begin - dictionary, options.compression_level, block == num_blocks - 1);
+	});
+
+	uLong adler = adler32(0, nullptr, 0);
+
+	for (int block = 0; block < num_blocks; ++block)
+	{
+		auto length = std::min<size_t>(filtered.size() - block * block_rows * filtered_stride, block_rows * filtered_stride);
+		adler = adler32_combine(adler, blocks[block].adler, static_cast<z_off_t>(length));
+	}
+
+	boost::filesystem::ofstream file(output_file, std::ios::out | std::ios::binary | std::ios::trunc);
+
+	if (!file)
+		BOOST_THROW_EXCEPTION(io_error() << msg_info("Could not open file for writing.") << boost::errinfo_file_name(narrow(output_file.wstring())));
+
+	static const uint8_t signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	file.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+
+	std::vector<uint8_t> header;
+	put_uint32(header, static_cast<uint32_t>(width));
+	put_uint32(header, static_cast<uint32_t>(height));
+	header.push_back(8);	// Bit depth.
+	header.push_back(6);	// RGBA.
+	header.push_back(0);	// Deflate.
+	header.push_back(0);	// Adaptive filtering.
+	header.push_back(0);	// Not interlaced.
+	write_chunk(file, "IHDR", nullptr, 0, header, nullptr, 0);
+
+	// The zlib header announces the compression level as one of four classes.
+	const int level_class = options.compression_level < 2 ? 0 : options.compression_level < 6 ? 1 : options.compression_level == 6 ? 2 : 3;
+	const int zlib_header = (0x78 << 8) | (level_class << 6);
+	const int check_bits = (31 - zlib_header % 31) % 31;
+	const uint8_t stream_header[] = { 0x78, static_cast<uint8_t>((level_class << 6) | check_bits) };
+
+	std::vector<uint8_t> trailer;
+	put_uint32(trailer, static_cast<uint32_t>(adler));
+
+	// One IDAT per block, together they form a single zlib stream.
+	for (int block = 0; block < num_blocks; ++block)
+	{
+		const bool first	= block == 0;
+		const bool last		= block == num_blocks - 1;
+
+		write_chunk(file, "IDAT", first ? stream_header : nullptr, first ? sizeof(stream_header) : 0, blocks[block].data, last ? trailer.data() : nullptr, last ? trailer.size() : 0);
+	}
+
+	write_chunk(file, "IEND", nullptr, 0, std::vector<uint8_t>(), nullptr, 0);
+
+	if (!file)
+		BOOST_THROW_EXCEPTION(io_error() << msg_info("Could not write file.") << boost::errinfo_file_name(narrow(output_file.wstring())));
+}
+
+}}
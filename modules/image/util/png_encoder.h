@@ -0,0 +1,71 @@
+/*
+* Copyright 2026 Sveriges Television AB http://casparcg.com/
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <boost/filesystem/path.hpp>
+
+#include <cstdint>
+#include <string>
+
+namespace caspar { namespace image {
+
+struct png_filter
+{
+	enum type
+	{
+		none = 0,
+		sub,
+		up,
+		average,
+		paeth,
+		adaptive	// Chooses the best of the above per row, slowest.
+	};
+};
+
+png_filter::type get_png_filter(const std::wstring& name);
+
+struct png_options
+{
+	int					compression_level;	// 0 (stored) to 9 (best).
+	png_filter::type	filter;
+
+	// The zlib and libpng defaults, which FreeImage used to write with.
+	png_options()
+		: compression_level(6)
+		, filter(png_filter::adaptive)
+	{
+	}
+};
+
+// From configuration.image.png-compression-level and png-filter.
+png_options get_configured_png_options();
+
+// Writes a top-down BGRA image as an 8 bit RGBA PNG file. Rows are filtered
+// and deflated in parallel blocks, each block primed with the end of the
+// previous one, and the blocks are joined into a single zlib stream.
+void write_png(
+		const uint8_t* bgra,
+		int width,
+		int height,
+		int stride,
+		const boost::filesystem::path& output_file,
+		const png_options& options = png_options());
+
+}}
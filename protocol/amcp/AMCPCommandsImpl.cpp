@@ -51,7 +51,10 @@
 #include <core/producer/media_info/media_info_repository.h>
 #include <core/mixer/mixer.h>
 #include <core/mixer/gpu/ogl_device.h>
+#include <core/mixer/audio/audio_util.h>
 #include <core/consumer/output.h>
+#include <core/consumer/benchmark/benchmark_consumer.h>
+#include <core/frame_trace.h>
 
 #include <modules/bluefish/bluefish.h>
 #include <modules/decklink/decklink.h>
@@ -70,6 +73,8 @@
 #include <fstream>
 #include <memory>
 #include <cctype>
+#include <cmath>
+#include <iomanip>
 #include <io.h>
 
 #include <boost/date_time/posix_time/posix_time.hpp>
@@ -86,6 +91,8 @@
 #include <boost/archive/iterators/insert_linebreaks.hpp>
 #include <boost/archive/iterators/transform_width.hpp>
 #include <boost/format.hpp>
+#include <boost/timer.hpp>
+#include <boost/thread/thread.hpp>
 
 #include <tbb/concurrent_unordered_map.h>
 #include <core/producer/layer_events.h>
@@ -394,6 +401,151 @@ bool ChannelGridCommand::DoExecute()
 	return true;
 }
 
+// Runs a private channel with the requested layers against a free running
+// benchmark consumer and replies with the measured throughput. Runs on the
+// background queue, so other commands are not held back while it runs.
+bool BenchmarkCommand::DoExecute()
+{	
+	try
+	{
+		auto format_desc = GetChannels().empty()
+				? video_format_desc::get(video_format::x1080i5000)
+				: GetChannels().front()->get_video_format_desc();
+
+		if(_parameters.has(L"FORMAT"))
+			format_desc = video_format_desc::get(_parameters.get(L"FORMAT"));
+
+		if(format_desc.format == video_format::invalid)
+			BOOST_THROW_EXCEPTION(invalid_argument() << msg_info("Invalid video format."));
+
+		int num_layers	= std::max(1, _parameters.get(L"LAYERS", 1));
+		int frames		= std::max(1, _parameters.get(L"FRAMES", 500));
+		int timeout		= _parameters.get(L"TIMEOUT", 60);
+		int route		= _parameters.get(L"ROUTE", 0);
+
+		std::wstring producer_name;
+		auto producer_it = std::find(_parameters.begin(), _parameters.end(), L"PRODUCER");
+		if(producer_it != _parameters.end() && producer_it + 1 != _parameters.end())
+			producer_name = _parameters.at_original(producer_it - _parameters.begin() + 1);
+
+		auto memory_start = get_process_memory_bytes();
+		auto memory_peak = memory_start;
+
+		auto channel = make_safe<video_channel>(
+				GetChannels().size() + 1, 
+				format_desc, 
+				make_safe_ptr(GetOglDevice()), 
+				default_channel_layout_repository().get_by_name(L"STEREO"));
+
+		for(int layer = 1; layer <= num_layers; ++layer)
+		{
+			auto frame_factory = channel->mixer()->get_frame_factory(layer);
+			auto producer = frame_producer::empty();
+
+			if(route > 0)
+				producer = create_channel_producer(frame_factory, GetChannels().at(route - 1));
+			else if(!producer_name.empty())
+				producer = create_producer(frame_factory, producer_name);
+			else
+			{
+				std::wstringstream color;
+				color << L"#FF" << std::hex << std::uppercase << std::setw(6) << std::setfill(L'0') << ((layer * 0x3F1F0F) & 0xFFFFFF);
+				producer = create_producer(frame_factory, color.str());
+			}
+
+			channel->stage()->load(layer, producer);
+			channel->stage()->play(layer);
+		}
+
+		if(_parameters.has(L"GRID"))
+		{
+			int n = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(num_layers))));
+			double delta = 1.0/static_cast<double>(n);
+
+			std::vector<stage::transform_tuple_t> transforms;
+
+			for(int layer = 1; layer <= num_layers; ++layer)
+			{
+				double x = ((layer - 1) % n) * delta;
+				double y = ((layer - 1) / n) * delta;
+
+				transforms.push_back(stage::transform_tuple_t(layer, [=](frame_transform transform) -> frame_transform
+				{
+					transform.fill_translation[0]	= x;
+					transform.fill_translation[1]	= y;
+					transform.fill_scale[0]			= delta;
+					transform.fill_scale[1]			= delta;
+					return transform;
+				}, 0, L"linear"));
+			}
+
+			channel->stage()->apply_transforms(transforms);
+		}
+
+		boost::property_tree::wptree consumer_config;
+		consumer_config.add(L"clock", false);
+		consumer_config.add(L"checksum", _parameters.has(L"CHECKSUM"));
+		consumer_config.add(L"frames", frames);
+		auto consumer = create_benchmark_consumer(consumer_config);
+
+		auto cpu_time_start = get_process_cpu_time_millis();
+		boost::timer wall_timer;
+
+		channel->output()->add(consumer);
+
+		// The consumer removes itself after the requested number of frames.
+		boost::property_tree::wptree delay_info;
+		auto deadline = boost::get_system_time() + boost::posix_time::seconds(timeout);
+
+		while(!channel->output()->empty())
+		{
+			if(boost::get_system_time() > deadline)
+				BOOST_THROW_EXCEPTION(timed_out() << msg_info("Benchmark did not finish in time."));
+
+			delay_info = channel->delay_info();
+			memory_peak = std::max(memory_peak, get_process_memory_bytes());
+			boost::this_thread::sleep(boost::posix_time::milliseconds(50));
+		}
+
+		auto wall_time	= static_cast<int64_t>(wall_timer.elapsed() * 1000.0);
+		auto cpu_time	= get_process_cpu_time_millis() - cpu_time_start;
+
+		boost::property_tree::wptree info;
+		info.add(L"benchmark.format", format_desc.name);
+		info.add(L"benchmark.layers", num_layers);
+		info.add(L"benchmark.producer", route > 0 ? L"route://" + boost::lexical_cast<std::wstring>(route) : producer_name.empty() ? L"color" : producer_name);
+		info.add(L"benchmark.wall-time-millis", wall_time);
+		info.add(L"benchmark.cpu-time-millis", cpu_time);
+		info.add(L"benchmark.peak-memory-bytes", memory_peak);
+		info.add(L"benchmark.memory-delta-bytes", memory_peak - memory_start);
+		info.add_child(L"benchmark.consumer", consumer->info());
+		info.add_child(L"benchmark.delay", delay_info);
+
+		std::wstringstream reply_string;
+		boost::property_tree::xml_writer_settings<std::wstring> w(' ', 3);
+
+		reply_string << L"201 BENCHMARK OK\r\n";
+		boost::property_tree::write_xml(reply_string, info, w);
+		reply_string << L"\r\n";
+
+		SetReplyString(reply_string.str());
+
+		return true;
+	}
+	catch(file_not_found&)
+	{
+		CASPAR_LOG_CURRENT_EXCEPTION();
+		SetReplyString(TEXT("404 BENCHMARK ERROR\r\n"));
+		return false;
+	}
+	catch(...)
+	{
+		CASPAR_LOG_CURRENT_EXCEPTION();
+		SetReplyString(TEXT("502 BENCHMARK FAILED\r\n"));
+		return false;
+	}
+}
+
 bool CallCommand::DoExecute()
 {	
 	//Perform loading of the clip
@@ -1088,7 +1240,10 @@ safe_ptr<core::frame_producer> RouteCommand::TryCreateProducer(AMCPCommand& comm
 
 		// Find the source layer (if one is given)
 		if (is_channel_layer_spec)
-			pFP = create_layer_producer(command.GetChannel()->mixer()->get_frame_factory(command.GetLayerIndex()), (*src_channel)->stage(), src_layer_index);
+		{
+			int destination_layer = *src_channel == command.GetChannel() ? command.GetLayerIndex() : -1;
+			pFP = create_layer_producer(command.GetChannel()->mixer()->get_frame_factory(command.GetLayerIndex()), (*src_channel)->stage(), src_layer_index, destination_layer);
+		}
 		else 
 			pFP = create_channel_producer(command.GetChannel()->mixer()->get_frame_factory(command.GetLayerIndex()), *src_channel);
 	}
@@ -2564,6 +2719,137 @@ bool GlCommand::DoExecuteInfo()
 	return true;
 }
 
+bool TraceCommand::DoExecute()
+{
+	try
+	{
+		if (_parameters.empty())
+			return DoExecuteInfo();
+
+		std::wstring command = _parameters.at(0);
+
+		if (command == TEXT("ON") || command == TEXT("OFF"))
+		{
+			GetChannel()->tracer()->enable(command == TEXT("ON"));
+			SetReplyString(TEXT("202 TRACE OK\r\n"));
+			return true;
+		}
+		else if (command == TEXT("RESET"))
+		{
+			GetChannel()->tracer()->reset();
+			SetReplyString(TEXT("202 TRACE OK\r\n"));
+			return true;
+		}
+		else if (command == TEXT("EXPORT"))
+			return DoExecuteExport();
+	}
+	catch(...)
+	{
+		CASPAR_LOG_CURRENT_EXCEPTION();
+		SetReplyString(TEXT("501 TRACE FAILED\r\n"));
+		return false;
+	}
+
+	SetReplyString(TEXT("403 TRACE ERROR\r\n"));
+	return false;
+}
+
+bool TraceCommand::DoExecuteInfo()
+{
+	std::wstringstream reply_string;
+	boost::property_tree::xml_writer_settings<std::wstring> w(' ', 3);
+
+	auto info = GetChannel()->tracer()->info();
+
+	reply_string << L"201 TRACE OK\r\n";
+	boost::property_tree::write_xml(reply_string, info, w);
+	reply_string << L"\r\n";
+
+	SetReplyString(reply_string.str());
+
+	return true;
+}
+
+bool TraceCommand::DoExecuteExport()
+{
+	auto filename = _parameters.size() > 1
+			? _parameters.at_original(1)
+			: L"trace-" + boost::lexical_cast<std::wstring>(GetChannelIndex() + 1) + L".json";
+
+	try
+	{
+		GetChannel()->tracer()->write_chrome_trace(filename);
+	}
+	catch(invalid_argument&)
+	{
+		CASPAR_LOG_CURRENT_EXCEPTION();
+		SetReplyString(TEXT("403 TRACE ERROR\r\n"));
+		return false;
+	}
+
+	SetReplyString(TEXT("202 TRACE OK\r\n"));
+	return true;
+}
+
+bool ImageCommand::DoExecute()
+{
+	try
+	{
+		std::wstring command = _parameters.at(0);
+
+		if (command == TEXT("PREFETCH"))
+			return DoExecutePrefetch();
+		else if (command == TEXT("INFO"))
+			return DoExecuteInfo();
+		else if (command == TEXT("CLEAR"))
+		{
+			image::clear_image_cache();
+			SetReplyString(TEXT("202 IMAGE OK\r\n"));
+			return true;
+		}
+	}
+	catch(...)
+	{
+		CASPAR_LOG_CURRENT_EXCEPTION();
+		SetReplyString(TEXT("501 IMAGE FAILED\r\n"));
+		return false;
+	}
+
+	SetReplyString(TEXT("403 IMAGE ERROR\r\n"));
+	return false;
+}
+
+bool ImageCommand::DoExecutePrefetch()
+{
+	if (_parameters.size() < 2)
+	{
+		SetReplyString(TEXT("402 IMAGE ERROR\r\n"));
+		return false;
+	}
+
+	bool found_all = true;
+
+	for (size_t n = 1; n < _parameters.size(); ++n)
+		found_all = image::prefetch_image(_parameters.at_original(n)) && found_all;
+
+	SetReplyString(found_all ? TEXT("202 IMAGE OK\r\n") : TEXT("404 IMAGE ERROR\r\n"));
+	return found_all;
+}
+
+bool ImageCommand::DoExecuteInfo()
+{
+	std::wstringstream reply_string;
+	boost::property_tree::xml_writer_settings<std::wstring> w(' ', 3);
+
+	reply_string << L"201 IMAGE OK\r\n";
+	boost::property_tree::write_xml(reply_string, image::image_cache_info(), w);
+	reply_string << L"\r\n";
+
+	SetReplyString(reply_string.str());
+
+	return true;
+}
+
 bool KillCommand::DoExecute()
 {
 	GetShutdownServerNow()(false); // False for not attempting to restart.
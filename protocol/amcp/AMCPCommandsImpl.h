@@ -51,6 +51,12 @@ class DiagnosticsCommand : public AMCPCommandBase<false, AddToQueue, 0>
 	bool DoExecute();
 };
 
+class BenchmarkCommand : public AMCPCommandBase<false, AddToBackgroundQueue, 0>
+{
+	std::wstring print() const { return L"BenchmarkCommand";}
+	bool DoExecute();
+};
+
 class CallCommand : public AMCPCommandBase<true, AddToQueue, 1>
 {
 	std::wstring print() const { return L"CallCommand";}
@@ -277,6 +283,22 @@ class GlCommand : public AMCPCommandBase<false, AddToQueue, 0>
 	bool DoExecuteGc();
 };
 
+class TraceCommand : public AMCPCommandBase<true, AddToQueue, 0>
+{
+	std::wstring print() const { return L"TraceCommand";}
+	bool DoExecute();
+	bool DoExecuteInfo();
+	bool DoExecuteExport();
+};
+
+class ImageCommand : public AMCPCommandBase<false, AddToQueue, 1>
+{
+	std::wstring print() const { return L"ImageCommand";}
+	bool DoExecute();
+	bool DoExecutePrefetch();
+	bool DoExecuteInfo();
+};
+
 class RestartCommand : public AMCPCommandBase<false, AddToQueue, 0>
 {
 	std::wstring print() const { return L"RestartCommand";}
@@ -38,6 +38,11 @@
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/algorithm/string/predicate.hpp>
+#include <boost/foreach.hpp>
+
+#include <cwctype>
+#include <limits>
+#include <unordered_map>
 
 #if defined(_MSC_VER)
 #pragma warning (push, 1) // TODO: Legacy code, just disable warnings
@@ -54,6 +59,146 @@ inline std::shared_ptr<core::video_channel> GetChannelSafe(unsigned int index, c
 	return index < channels.size() ? std::shared_ptr<core::video_channel>(channels[index]) : nullptr;
 }
 
+namespace {
+
+inline wchar_t ascii_upper(wchar_t c)
+{
+	return c >= L'a' && c <= L'z' ? c - (L'a' - L'A') : c;
+}
+
+// Case insensitive hashing and comparison so that command names can be
+// looked up without creating an upper case copy of every incoming token.
+struct case_insensitive_hash
+{
+	std::size_t operator()(const std::wstring& str) const
+	{
+		std::size_t hash = 2166136261U;
+
+		BOOST_FOREACH(auto c, str)
+			hash = (hash ^ static_cast<std::size_t>(ascii_upper(c))) * 16777619U;
+
+		return hash;
+	}
+};
+
+struct case_insensitive_equal
+{
+	bool operator()(const std::wstring& lhs, const std::wstring& rhs) const
+	{
+		if (lhs.size() != rhs.size())
+			return false;
+
+		for (std::size_t n = 0; n < lhs.size(); ++n)
+		{
+			if (ascii_upper(lhs[n]) != ascii_upper(rhs[n]))
+				return false;
+		}
+
+		return true;
+	}
+};
+
+typedef AMCPCommandPtr (*command_creator)(const std::vector<safe_ptr<core::video_channel>>& channels);
+
+template<typename T>
+AMCPCommandPtr create_command(const std::vector<safe_ptr<core::video_channel>>&)
+{
+	return std::make_shared<T>();
+}
+
+template<typename T>
+AMCPCommandPtr create_command_with_channels(const std::vector<safe_ptr<core::video_channel>>& channels)
+{
+	return std::make_shared<T>(channels);
+}
+
+typedef std::unordered_map<std::wstring, command_creator, case_insensitive_hash, case_insensitive_equal> command_table;
+
+command_table create_command_table()
+{
+	command_table table;
+
+	table[L"MIXER"]			= &create_command<MixerCommand>;
+	table[L"DIAG"]			= &create_command<DiagnosticsCommand>;
+	table[L"BENCHMARK"]		= &create_command<BenchmarkCommand>;
+	table[L"CHANNEL_GRID"]	= &create_command<ChannelGridCommand>;
+	table[L"CALL"]			= &create_command<CallCommand>;
+	table[L"SWAP"]			= &create_command<SwapCommand>;
+	table[L"ROUTE"]			= &create_command<RouteCommand>;
+	table[L"LOAD"]			= &create_command<LoadCommand>;
+	table[L"LOADBG"]		= &create_command<LoadbgCommand>;
+	table[L"ADD"]			= &create_command<AddCommand>;
+	table[L"REMOVE"]		= &create_command<RemoveCommand>;
+	table[L"PAUSE"]			= &create_command<PauseCommand>;
+	table[L"RESUME"]		= &create_command<ResumeCommand>;
+	table[L"PLAY"]			= &create_command<PlayCommand>;
+	table[L"STOP"]			= &create_command<StopCommand>;
+	table[L"CLEAR"]			= &create_command<ClearCommand>;
+	table[L"PRINT"]			= &create_command<PrintCommand>;
+	table[L"LOG"]			= &create_command<LogCommand>;
+	table[L"CG"]			= &create_command<CGCommand>;
+	table[L"DATA"]			= &create_command<DataCommand>;
+	table[L"CINF"]			= &create_command<CinfCommand>;
+	table[L"INFO"]			= &create_command_with_channels<InfoCommand>;
+	table[L"SHORTINFO"]		= &create_command_with_channels<ShortInfoCommand>;
+	table[L"CLS"]			= &create_command<ClsCommand>;
+	table[L"TLS"]			= &create_command<TlsCommand>;
+	table[L"VERSION"]		= &create_command<VersionCommand>;
+	table[L"BYE"]			= &create_command<ByeCommand>;
+	table[L"SET"]			= &create_command<SetCommand>;
+	table[L"GL"]			= &create_command<GlCommand>;
+	table[L"TRACE"]			= &create_command<TraceCommand>;
+	table[L"IMAGE"]			= &create_command<ImageCommand>;
+	table[L"THUMBNAIL"]		= &create_command<ThumbnailCommand>;
+	table[L"KILL"]			= &create_command<KillCommand>;
+	table[L"RESTART"]		= &create_command<RestartCommand>;
+	table[L"CLEARCUE"]		= &create_command_with_channels<ClearCueCommand>;
+
+	return table;
+}
+
+// Initialized before main() since function local statics are not thread safe
+// and several AMCP servers may parse concurrently.
+const command_table g_commands = create_command_table();
+
+// Parses a decimal integer, accepting the same input as boost::lexical_cast<int>
+// without throwing on failure.
+bool parse_int(const wchar_t* begin, const wchar_t* end, int& result)
+{
+	bool negative = false;
+
+	if (begin != end && (*begin == L'-' || *begin == L'+'))
+		negative = *begin++ == L'-';
+
+	if (begin == end)
+		return false;
+
+	long long value = 0;
+
+	for (; begin != end; ++begin)
+	{
+		if (*begin < L'0' || *begin > L'9')
+			return false;
+
+		value = value * 10 + (*begin - L'0');
+
+		if (value > static_cast<long long>(std::numeric_limits<int>::max()) + 1)
+			return false;
+	}
+
+	if (negative)
+		value = -value;
+
+	if (value > std::numeric_limits<int>::max() || value < std::numeric_limits<int>::min())
+		return false;
+
+	result = static_cast<int>(value);
+
+	return true;
+}
+
+}
+
 AMCPProtocolStrategy::AMCPProtocolStrategy(
 		const std::wstring& name,
 		const std::vector<safe_ptr<core::video_channel>>& channels,
@@ -70,6 +215,8 @@ AMCPProtocolStrategy::AMCPProtocolStrategy(
 	AMCPCommandQueuePtr pGeneralCommandQueue(new AMCPCommandQueue(L"General Queue for " + name));
 	commandQueues_.push_back(pGeneralCommandQueue);
 
+	backgroundCommandQueue_.reset(new AMCPCommandQueue(L"Background Queue for " + name));
+
 
 	std::shared_ptr<core::video_channel> pChannel;
 	unsigned int index = -1;
@@ -91,46 +238,32 @@ AMCPProtocolStrategy::~AMCPProtocolStrategy() {
 
 void AMCPProtocolStrategy::Parse(const TCHAR* pData, int charCount, ClientInfoPtr pClientInfo)
 {
-	size_t pos;
-	size_t oldLength = pClientInfo->currentMessage_.length();
+	auto& buffer = pClientInfo->currentMessage_;
+	size_t oldLength = buffer.length();
 
-	if(pClientInfo->currentMessage_.capacity() < (oldLength + charCount))
-		pClientInfo->currentMessage_.reserve(oldLength + 8192 * 4);
+	if(buffer.capacity() < (oldLength + charCount))
+		buffer.reserve(oldLength + 8192 * 4);
 
-	pClientInfo->currentMessage_.append(pData, charCount);
+	buffer.append(pData, charCount);
 
-	while(true) {
-		pos = pClientInfo->currentMessage_.find(
-				MessageDelimiter,
-				oldLength > MessageDelimiter.size() - 1
-						? oldLength - (MessageDelimiter.size() - 1)
-						: 0);
-		if(pos != std::wstring::npos)
-		{
-			std::wstring message = pClientInfo->currentMessage_.substr(0,pos);
+	// Messages are consumed in place and the buffer is compacted once, instead
+	// of copying the unprocessed remainder after every message.
+	size_t messageStart = 0;
+	size_t searchStart = oldLength > MessageDelimiter.size() - 1
+			? oldLength - (MessageDelimiter.size() - 1)
+			: 0;
+	size_t pos;
 
-			//This is where a complete message gets taken care of
-			if(message.length() > 0) {
-				ProcessMessage(message, pClientInfo);
-			}
+	while((pos = buffer.find(MessageDelimiter, searchStart)) != std::wstring::npos)
+	{
+		//This is where a complete message gets taken care of
+		if(pos > messageStart)
+			ProcessMessage(buffer.substr(messageStart, pos - messageStart), pClientInfo);
 
-			std::size_t nextStartPos = pos + MessageDelimiter.length();
-			if(nextStartPos < pClientInfo->currentMessage_.length())
-			{
-				pClientInfo->currentMessage_ = pClientInfo->currentMessage_.substr(nextStartPos);
-				oldLength = 0;
-			}
-			else
-			{
-				pClientInfo->currentMessage_.clear();
-				break;
-			}
-		}
-		else
-		{
-			break;
-		}
+		messageStart = searchStart = pos + MessageDelimiter.length();
 	}
+
+	buffer.erase(0, messageStart);
 }
 
 void AMCPProtocolStrategy::ProcessMessage(const std::wstring& message, ClientInfoPtr& pClientInfo)
@@ -185,6 +318,7 @@ void AMCPProtocolStrategy::ProcessMessage(const std::wstring& message, ClientInf
 AMCPCommandPtr AMCPProtocolStrategy::InterpretCommandString(const std::wstring& message, MessageParserState* pOutState)
 {
 	std::vector<std::wstring> tokens;
+	tokens.reserve(16);
 	unsigned int currentToken = 0;
 	std::wstring commandSwitch;
 
@@ -224,12 +358,8 @@ AMCPCommandPtr AMCPProtocolStrategy::InterpretCommandString(const std::wstring&
 				pCommand->SetOglDevice(ogl_);
 				pCommand->SetShutdownServerNow(shutdown_server_now_);
 				//Set scheduling
-				if(commandSwitch.size() > 0) {
-					transform(commandSwitch.begin(), commandSwitch.end(), commandSwitch.begin(), toupper);
-
-					if(commandSwitch == TEXT("/APP"))
-						pCommand->SetScheduling(AddToQueue);
-				}
+				if(boost::iequals(commandSwitch, TEXT("/APP")))
+					pCommand->SetScheduling(AddToQueue);
 
 				if(pCommand->NeedChannel())
 					state = GetChannel;
@@ -261,23 +391,30 @@ AMCPCommandPtr AMCPProtocolStrategy::InterpretCommandString(const std::wstring&
 			{
 //				assert(pCommand != 0);
 
-				std::wstring str = boost::trim_copy(tokens[currentToken]);
-				std::vector<std::wstring> split;
-				boost::split(split, str, boost::is_any_of("-"));
+				// <channel>[-<layer>[-...]]
+				const std::wstring& str = tokens[currentToken];
+				const wchar_t* begin = str.c_str();
+				const wchar_t* end = begin + str.size();
+
+				while(begin != end && std::iswspace(*begin))
+					++begin;
+
+				while(end != begin && std::iswspace(*(end - 1)))
+					--end;
+
+				const wchar_t* channelEnd = std::find(begin, end, L'-');
+				const wchar_t* layerEnd = channelEnd != end ? std::find(channelEnd + 1, end, L'-') : end;
 					
 				int channelIndex = -1;
 				int layerIndex = -1;
-				try
-				{
-					channelIndex = boost::lexical_cast<int>(split[0]) - 1;
 
-					if(split.size() > 1)
-						layerIndex = boost::lexical_cast<int>(split[1]);
-				}
-				catch(...)
-				{
+				if(!parse_int(begin, channelEnd, channelIndex))
+					goto ParseFinnished;
+
+				--channelIndex;
+
+				if(channelEnd != end && !parse_int(channelEnd + 1, layerEnd, layerIndex))
 					goto ParseFinnished;
-				}
 
 				std::shared_ptr<core::video_channel> pChannel = GetChannelSafe(channelIndex, channels_);
 				if(pChannel == 0) {
@@ -322,6 +459,9 @@ bool AMCPProtocolStrategy::QueueCommand(AMCPCommandPtr pCommand) {
 		else
 			return false;
 	}
+	else if(pCommand->GetScheduling() == AddToBackgroundQueue) {
+		backgroundCommandQueue_->AddCommand(pCommand);
+	}
 	else {
 		commandQueues_[0]->AddCommand(pCommand);
 	}
@@ -330,46 +470,9 @@ bool AMCPProtocolStrategy::QueueCommand(AMCPCommandPtr pCommand) {
 
 AMCPCommandPtr AMCPProtocolStrategy::CommandFactory(const std::wstring& str)
 {
-	std::wstring s = str;
-	transform(s.begin(), s.end(), s.begin(), toupper);
-	
-	if	   (s == TEXT("MIXER"))			return std::make_shared<MixerCommand>();
-	else if(s == TEXT("DIAG"))			return std::make_shared<DiagnosticsCommand>();
-	else if(s == TEXT("CHANNEL_GRID"))	return std::make_shared<ChannelGridCommand>();
-	else if(s == TEXT("CALL"))			return std::make_shared<CallCommand>();
-	else if(s == TEXT("SWAP"))			return std::make_shared<SwapCommand>();
-	else if(s == TEXT("ROUTE"))			return std::make_shared<RouteCommand>();
-	else if(s == TEXT("LOAD"))			return std::make_shared<LoadCommand>();
-	else if(s == TEXT("LOADBG"))		return std::make_shared<LoadbgCommand>();
-	else if(s == TEXT("ADD"))			return std::make_shared<AddCommand>();
-	else if(s == TEXT("REMOVE"))		return std::make_shared<RemoveCommand>();
-	else if(s == TEXT("PAUSE"))			return std::make_shared<PauseCommand>();
-	else if(s == TEXT("RESUME"))		return std::make_shared<ResumeCommand>();
-	else if(s == TEXT("PLAY"))			return std::make_shared<PlayCommand>();
-	else if(s == TEXT("STOP"))			return std::make_shared<StopCommand>();
-	else if(s == TEXT("CLEAR"))			return std::make_shared<ClearCommand>();
-	else if(s == TEXT("PRINT"))			return std::make_shared<PrintCommand>();
-	else if(s == TEXT("LOG"))			return std::make_shared<LogCommand>();
-	else if(s == TEXT("CG"))			return std::make_shared<CGCommand>();
-	else if(s == TEXT("DATA"))			return std::make_shared<DataCommand>();
-	else if(s == TEXT("CINF"))			return std::make_shared<CinfCommand>();
-	else if(s == TEXT("INFO"))			return std::make_shared<InfoCommand>(channels_);
-	else if(s == TEXT("SHORTINFO"))		return std::make_shared<ShortInfoCommand>(channels_);
-	else if(s == TEXT("CLS"))			return std::make_shared<ClsCommand>();
-	else if(s == TEXT("TLS"))			return std::make_shared<TlsCommand>();
-	else if(s == TEXT("VERSION"))		return std::make_shared<VersionCommand>();
-	else if(s == TEXT("BYE"))			return std::make_shared<ByeCommand>();
-	else if(s == TEXT("SET"))			return std::make_shared<SetCommand>();
-	else if(s == TEXT("GL"))			return std::make_shared<GlCommand>();
-	else if(s == TEXT("THUMBNAIL"))		return std::make_shared<ThumbnailCommand>();
-	//else if(s == TEXT("MONITOR"))
-	//{
-	//	result = AMCPCommandPtr(new MonitorCommand());
-	//}
-	else if(s == TEXT("KILL"))			return std::make_shared<KillCommand>();
-	else if(s == TEXT("RESTART"))		return std::make_shared<RestartCommand>();
-	else if(s == TEXT("CLEARCUE"))		return std::make_shared<ClearCueCommand>(channels_);
-	return nullptr;
+	auto it = g_commands.find(str);
+
+	return it != g_commands.end() ? it->second(channels_) : nullptr;
 }
 
 std::size_t AMCPProtocolStrategy::TokenizeMessage(const std::wstring& message, std::vector<std::wstring>* pTokenVector)
@@ -377,70 +480,61 @@ std::size_t AMCPProtocolStrategy::TokenizeMessage(const std::wstring& message, s
 	//split on whitespace but keep strings within quotationmarks
 	//treat \ as the start of an escape-sequence: the following char will indicate what to actually put in the string
 
-	std::wstring currentToken;
+	const wchar_t* it = message.c_str();
+	const wchar_t* end = it + message.size();
+	bool inQuote = false;
 
-	char inQuote = 0;
-	bool getSpecialCode = false;
+	// Tokens are built in place and runs of ordinary characters are appended
+	// in one go.
+	pTokenVector->push_back(std::wstring());
 
-	for(unsigned int charIndex=0; charIndex<message.size(); ++charIndex)
+	while(it != end)
 	{
-		if(getSpecialCode)
+		const wchar_t* runEnd = std::find_if(it, end, [inQuote](wchar_t c)
+		{
+			return c == TEXT('\\') || c == TEXT('\"') || (c == TEXT(' ') && !inQuote);
+		});
+
+		pTokenVector->back().append(it, runEnd);
+		it = runEnd;
+
+		if(it == end)
+			break;
+
+		switch(*it++)
 		{
+		case TEXT('\\'):
+			if(it == end)
+				break;
+
 			//insert code-handling here
-			switch(message[charIndex])
+			switch(*it++)
 			{
 			case TEXT('\\'):
-				currentToken += TEXT("\\");
+				pTokenVector->back() += TEXT('\\');
 				break;
 			case TEXT('\"'):
-				currentToken += TEXT("\"");
+				pTokenVector->back() += TEXT('\"');
 				break;
 			case TEXT('n'):
-				currentToken += TEXT("\n");
+				pTokenVector->back() += TEXT('\n');
 				break;
 			default:
 				break;
-			};
-			getSpecialCode = false;
-			continue;
-		}
-
-		if(message[charIndex]==TEXT('\\'))
-		{
-			getSpecialCode = true;
-			continue;
-		}
-
-		if(message[charIndex]==' ' && inQuote==false)
-		{
-			if(currentToken.size()>0)
-			{
-				pTokenVector->push_back(currentToken);
-				currentToken.clear();
 			}
-			continue;
-		}
-
-		if(message[charIndex]==TEXT('\"'))
-		{
-			inQuote ^= 1;
-
-			if(currentToken.size()>0)
-			{
-				pTokenVector->push_back(currentToken);
-				currentToken.clear();
-			}
-			continue;
+			break;
+		case TEXT('\"'):
+			inQuote = !inQuote;
+			// fall through
+		default: // unquoted space
+			if(!pTokenVector->back().empty())
+				pTokenVector->push_back(std::wstring());
+			break;
 		}
-
-		currentToken += message[charIndex];
 	}
 
-	if(currentToken.size()>0)
-	{
-		pTokenVector->push_back(currentToken);
-		currentToken.clear();
-	}
+	if(pTokenVector->back().empty())
+		pTokenVector->pop_back();
 
 	return pTokenVector->size();
 }
@@ -80,6 +80,7 @@ private:
 	safe_ptr<core::ogl_device> ogl_;
 	std::function<void (bool)> shutdown_server_now_;
 	std::vector<AMCPCommandQueuePtr> commandQueues_;
+	AMCPCommandQueuePtr backgroundCommandQueue_;
 	static const std::wstring MessageDelimiter;
 };
 
@@ -127,14 +127,28 @@ void write_osc_bundle_element_start(byte_vector& destination, const byte_vector&
 #endif
 }
 
+struct update
+{
+	core::monitor::interned_path	path;
+	byte_vector						data;
+};
+
+struct destination
+{
+	udp::endpoint									endpoint;
+	std::shared_ptr<core::monitor::path_filter>		subscriptions;
+};
+
 struct client::impl : public std::enable_shared_from_this<client::impl>, core::monitor::sink
 {
 	std::shared_ptr<boost::asio::io_service>		service_;
 	udp::socket socket_;
 	tbb::spin_mutex									endpoints_mutex_;
 	std::map<udp::endpoint, int>					reference_counts_by_endpoint_;
+	std::map<udp::endpoint, std::shared_ptr<core::monitor::path_filter>>	subscriptions_by_endpoint_;
+	core::monitor::path_filter						subscriptions_;
 
-	std::unordered_map<std::string, byte_vector>	updates_;
+	std::unordered_map<std::string, update>			updates_;
 	boost::mutex									updates_mutex_;								
 	boost::condition_variable						updates_cond_;
 
@@ -160,15 +174,33 @@ public:
 	}
 
 	std::shared_ptr<void> get_subscription_token(
-			const boost::asio::ip::udp::endpoint& endpoint)
+			const boost::asio::ip::udp::endpoint& endpoint,
+			const std::vector<std::string>& patterns)
 	{
-		tbb::spin_mutex::scoped_lock lock(endpoints_mutex_);
+		std::shared_ptr<core::monitor::path_filter> endpoint_subscriptions;
+
+		{
+			tbb::spin_mutex::scoped_lock lock(endpoints_mutex_);
+
+			++reference_counts_by_endpoint_[endpoint];
+
+			auto& filter = subscriptions_by_endpoint_[endpoint];
 
-		++reference_counts_by_endpoint_[endpoint];
+			if (!filter)
+				filter = std::make_shared<core::monitor::path_filter>();
+
+			endpoint_subscriptions = filter;
+		}
+
+		BOOST_FOREACH(auto& pattern, patterns)
+		{
+			endpoint_subscriptions->subscribe(pattern);
+			subscriptions_.subscribe(pattern);
+		}
 
 		std::weak_ptr<impl> weak_self = shared_from_this();
 
-		return std::shared_ptr<void>(nullptr, [weak_self, endpoint] (void*)
+		return std::shared_ptr<void>(nullptr, [weak_self, endpoint, patterns] (void*)
 		{
 			auto strong = weak_self.lock();
 
@@ -177,23 +209,53 @@ public:
 
 			auto& self = *strong;
 
-			tbb::spin_mutex::scoped_lock lock(self.endpoints_mutex_);
+			std::shared_ptr<core::monitor::path_filter> endpoint_subscriptions;
+
+			{
+				tbb::spin_mutex::scoped_lock lock(self.endpoints_mutex_);
+
+				endpoint_subscriptions = self.subscriptions_by_endpoint_[endpoint];
+
+				int reference_count_after =
+					--self.reference_counts_by_endpoint_[endpoint];
+
+				if (reference_count_after == 0)
+				{
+					self.reference_counts_by_endpoint_.erase(endpoint);
+					self.subscriptions_by_endpoint_.erase(endpoint);
+				}
+			}
 
-			int reference_count_after =
-				--self.reference_counts_by_endpoint_[endpoint];
+			BOOST_FOREACH(auto& pattern, patterns)
+			{
+				if (endpoint_subscriptions)
+					endpoint_subscriptions->unsubscribe(pattern);
 
-			if (reference_count_after == 0)
-				self.reference_counts_by_endpoint_.erase(endpoint);
+				self.subscriptions_.unsubscribe(pattern);
+			}
 		});
 	}
+
+	// The union of the subscriptions of all the endpoints, each endpoint is
+	// filtered separately when the messages are sent.
+	bool is_subscribed(const core::monitor::interned_path& path) override
+	{
+		return subscriptions_.matches(path);
+	}
 private:
 	void propagate(const core::monitor::message& msg)
 	{
+		// Producers that do not check is_subscribed() still emit everything.
+		if (!subscriptions_.matches(msg.interned()))
+			return;
+
 		boost::lock_guard<boost::mutex> lock(updates_mutex_);
 
 		try 
 		{
-			write_osc_event(updates_[msg.path()], msg);
+			auto& update = updates_[msg.path()];
+			update.path = msg.interned();
+			write_osc_event(update.data, msg);
 		}
 		catch(...)
 		{
@@ -205,13 +267,11 @@ private:
 	}
 
 	template<typename T>
-	void do_send(
-			const T& buffers, const std::vector<udp::endpoint>& destinations)
+	void do_send(const T& buffers, const udp::endpoint& endpoint)
 	{
 		boost::system::error_code ec;
 
-		BOOST_FOREACH(const auto& endpoint, destinations)
-			socket_.send_to(buffers, endpoint, 0, ec);
+		socket_.send_to(buffers, endpoint, 0, ec);
 	}
 
 	void run()
@@ -223,8 +283,8 @@ private:
 		{
 			is_running_ = true;
 
-			std::unordered_map<std::string, byte_vector> updates;
-			std::vector<udp::endpoint> destinations;
+			std::unordered_map<std::string, update> updates;
+			std::vector<destination> destinations;
 			const byte_vector bundle_header = write_osc_bundle_start();
 			std::vector<byte_vector> element_headers;
 
@@ -245,45 +305,62 @@ private:
 				{
 					tbb::spin_mutex::scoped_lock lock(endpoints_mutex_);
 
-					BOOST_FOREACH(const auto& endpoint, reference_counts_by_endpoint_)
-						destinations.push_back(endpoint.first);
+					BOOST_FOREACH(const auto& endpoint, subscriptions_by_endpoint_)
+					{
+						destination dest;
+						dest.endpoint = endpoint.first;
+						dest.subscriptions = endpoint.second;
+						destinations.push_back(dest);
+					}
 				}
 
 				if (destinations.empty())
 					continue;
 
-				std::vector<boost::asio::const_buffers_1> buffers;
 				element_headers.resize(
 						std::max(element_headers.size(), updates.size()));
 
 				int i = 0;
-				int datagram_size = bundle_header.size();
-				buffers.push_back(boost::asio::buffer(bundle_header));
 
 				BOOST_FOREACH(const auto& slot, updates)
+					write_osc_bundle_element_start(element_headers[i++], slot.second.data);
+
+				// Each endpoint only receives the messages it has subscribed
+				// to, so the bundles are built separately for each of them.
+				BOOST_FOREACH(const auto& dest, destinations)
 				{
-					write_osc_bundle_element_start(element_headers[i], slot.second);
-					const auto& headers = element_headers;
+					std::vector<boost::asio::const_buffers_1> buffers;
 
-					auto size_of_element = headers[i].size() + slot.second.size();
-	
-					if (datagram_size + size_of_element >= SAFE_DATAGRAM_SIZE)
+					i = 0;
+					int datagram_size = bundle_header.size();
+					buffers.push_back(boost::asio::buffer(bundle_header));
+
+					BOOST_FOREACH(const auto& slot, updates)
 					{
-						do_send(buffers, destinations);
-						buffers.clear();
-						buffers.push_back(boost::asio::buffer(bundle_header));
-						datagram_size = bundle_header.size();
-					}
+						const auto& header = element_headers[i++];
 
-					buffers.push_back(boost::asio::buffer(headers[i]));
-					buffers.push_back(boost::asio::buffer(slot.second));
+						if (!dest.subscriptions->matches(slot.second.path))
+							continue;
 
-					datagram_size += size_of_element;
-					++i;
-				}
+						auto size_of_element = header.size() + slot.second.data.size();
+	
+						if (datagram_size + size_of_element >= SAFE_DATAGRAM_SIZE && buffers.size() > 1)
+						{
+							do_send(buffers, dest.endpoint);
+							buffers.clear();
+							buffers.push_back(boost::asio::buffer(bundle_header));
+							datagram_size = bundle_header.size();
+						}
+
+						buffers.push_back(boost::asio::buffer(header));
+						buffers.push_back(boost::asio::buffer(slot.second.data));
+
+						datagram_size += size_of_element;
+					}
 			
-				if (!buffers.empty())
-					do_send(buffers, destinations);
+					if (buffers.size() > 1)
+						do_send(buffers, dest.endpoint);
+				}
 			}
 		}
 		catch (...)
@@ -316,7 +393,14 @@ client::~client()
 std::shared_ptr<void> client::get_subscription_token(
 			const boost::asio::ip::udp::endpoint& endpoint)
 {
-	return impl_->get_subscription_token(endpoint);
+	return impl_->get_subscription_token(endpoint, std::vector<std::string>(1, "/"));
+}
+
+std::shared_ptr<void> client::get_subscription_token(
+			const boost::asio::ip::udp::endpoint& endpoint,
+			const std::vector<std::string>& patterns)
+{
+	return impl_->get_subscription_token(endpoint, patterns);
 }
 
 safe_ptr<core::monitor::sink> client::sink()
@@ -28,6 +28,9 @@
 #include <boost/asio/ip/udp.hpp>
 #include <boost/noncopyable.hpp>
 
+#include <string>
+#include <vector>
+
 namespace caspar { namespace protocol { namespace osc {
 
 class client
@@ -57,6 +60,21 @@ public:
 	std::shared_ptr<void> get_subscription_token(
 			const boost::asio::ip::udp::endpoint& endpoint);
 
+	/**
+	 * Like above but only subscribes to messages matching the given path
+	 * patterns, see core::monitor::path_filter. Each endpoint only receives
+	 * the messages matching its own patterns. Messages that no endpoint has
+	 * subscribed to are not built by the producers in the first place.
+	 *
+	 * @param endpoint The UDP endpoint to send OSC messages to.
+	 * @param patterns The path patterns to subscribe to.
+	 *
+	 * @return The token. It is ok for the token to outlive the client
+	 */
+	std::shared_ptr<void> get_subscription_token(
+			const boost::asio::ip::udp::endpoint& endpoint,
+			const std::vector<std::string>& patterns);
+
 	~client();
 
 	// Methods
@@ -421,6 +421,7 @@ int main(int argc, char* argv[])
 		}
 		Sleep(500);
 		CASPAR_LOG(info) << "Successfully shutdown CasparCG Server.";
+		caspar::log::flush();
 
 		if (wait_for_keypress)
 			system("pause");
@@ -35,6 +35,8 @@
 #include <core/video_channel.h>
 #include <core/producer/stage.h>
 #include <core/consumer/output.h>
+#include <core/consumer/benchmark/benchmark_consumer.h>
+#include <core/parameters/parameters.h>
 #include <core/thumbnail_generator.h>
 #include <core/producer/media_info/media_info.h>
 #include <core/producer/media_info/media_info_repository.h>
@@ -153,6 +155,8 @@ struct server::implementation : boost::noncopyable
 		image::init();		  
 		CASPAR_LOG(info) << L"Initialized image module.";
 
+		core::register_consumer_factory([](const core::parameters& params){return core::create_benchmark_consumer(params);});
+
 		setup_channels(env::properties());
 		CASPAR_LOG(info) << L"Initialized channels.";
 
@@ -268,8 +272,12 @@ struct server::implementation : boost::noncopyable
 					on_consumer(ffmpeg::create_consumer(xml_consumer.second));						
 				else if (name == L"stream")					
 					on_consumer(ffmpeg::create_streaming_consumer(xml_consumer.second));						
+				else if (name == L"renditions")
+					on_consumer(ffmpeg::create_multi_rendition_consumer(xml_consumer.second));
 				else if (name == L"system-audio")
 					on_consumer(oal::create_consumer());
+				else if (name == L"benchmark")
+					on_consumer(core::create_benchmark_consumer(xml_consumer.second));
 				else if (name != L"<xmlcomment>")
 					CASPAR_LOG(warning) << "Invalid consumer: " << widen(name);	
 			}
@@ -333,14 +341,24 @@ struct server::implementation : boost::noncopyable
 						predefined_client.second.get<std::wstring>(L"address");
 				const auto port =
 						predefined_client.second.get<unsigned short>(L"port");
+				std::vector<std::string> patterns;
+
+				BOOST_FOREACH(auto& path, predefined_client.second.get_child(L"subscriptions", wptree()))
+					patterns.push_back(narrow(path.second.get_value<std::wstring>()));
+
+				if (patterns.empty())
+					patterns.push_back("/");
+
 				predefined_osc_subscriptions_.push_back(
 						osc_client_.get_subscription_token(udp::endpoint(
 								address_v4::from_string(narrow(address)),
-								port)));
+								port), patterns));
 			}
 		}
 
-		if (primary_amcp_server_)
+		// Every path is sent to AMCP clients, so no message can be skipped at
+		// the source while one of them is connected.
+		if (primary_amcp_server_ && !pt.get(L"configuration.osc.disable-send-to-amcp-clients", false))
 			primary_amcp_server_->add_lifecycle_factory(
 					[=] (const std::string& ipv4_address)
 							-> std::shared_ptr<void>